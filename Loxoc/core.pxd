@@ -3,6 +3,7 @@ from libcpp.vector cimport vector
 from libcpp.string cimport string
 from libcpp.map cimport map
 from libcpp.pair cimport pair
+from libcpp.memory cimport shared_ptr
 
 cdef extern from "<variant>" namespace "std" nogil:
     cdef cppclass variant:
@@ -57,6 +58,38 @@ cdef extern from "../src/util.h":
 
 cpdef void set_mod_path(str path)
 
+cdef extern from "../src/JobSystem.h":
+    cdef cppclass job_system:
+        @staticmethod
+        job_system& get()
+        void set_worker_count(size_t count) except +
+        size_t get_worker_count()
+        @staticmethod
+        void self_test() except +
+
+cpdef void set_worker_count(size_t count)
+cpdef size_t get_worker_count()
+cpdef void self_test_job_system()
+
+cdef extern from "../src/GLProgram.h":
+    cdef struct program_cache_stats:
+        size_t hits
+        size_t misses
+        size_t rejected
+        size_t stored
+
+    cdef cppclass gl_program:
+        @staticmethod
+        void set_binary_cache_directory(string path)
+        @staticmethod
+        string get_binary_cache_directory()
+        @staticmethod
+        program_cache_stats get_binary_cache_stats()
+
+cpdef void set_program_cache_dir(str path)
+cpdef str get_program_cache_dir()
+cpdef dict get_program_cache_stats()
+
 cdef extern from "../src/Texture.h":
     cpdef enum class TextureFiltering:
         NEAREST,
@@ -72,8 +105,42 @@ cdef extern from "../src/Texture.h":
         texture() except +
         texture(string file_path, TextureWraping wrap, TextureFiltering filtering) except +
         int width, height, number_of_channels
+        size_t memory_bytes
         void bind()
 
+    cdef struct texture_cache_stats:
+        size_t hits
+        size_t misses
+        size_t evictions
+        size_t textures
+        size_t memory_bytes
+
+    cdef struct texture_cache_entry:
+        string file_path
+        int width, height, number_of_channels
+        size_t memory_bytes
+        int users
+
+    cdef cppclass texture_cache:
+        @staticmethod
+        RC[texture*]* get(string file_path, TextureWraping wrap, TextureFiltering filtering) except +
+        @staticmethod
+        void set_budget(size_t bytes)
+        @staticmethod
+        size_t get_budget()
+        @staticmethod
+        size_t collect_unused()
+        @staticmethod
+        texture_cache_stats get_stats()
+        @staticmethod
+        vector[texture_cache_entry] get_entries()
+
+cpdef void set_texture_cache_budget(size_t bytes)
+cpdef size_t get_texture_cache_budget()
+cpdef size_t collect_unused_textures()
+cpdef dict get_texture_cache_stats()
+cpdef list get_texture_memory()
+
 cdef class Texture:
     cdef RC[texture*]* c_class
 
@@ -95,6 +162,8 @@ cdef extern from "../src/Shader.h":
         ShaderType type
         unsigned int shader_handle
         from_file(string filepath, ShaderType type) except +
+        @staticmethod
+        RC[shader*]* shared_from_file(string filepath, ShaderType type) except +
  
 cdef class Shader:
     cdef RC[shader*]* c_class
@@ -730,12 +799,29 @@ cdef extern from "../src/Mesh.h":
     cdef cppclass vertex:
         pass
 
+    cpdef enum class GeometryResidency:
+        KEEP,
+        POSITIONS_ONLY,
+        DISCARD
+
     cdef cppclass mesh:
         mesh() except +
         mesh(const mesh& rhs) except +
         mesh(string name, RC[material*]* mesh_material, vector[vertex]* vertices, vector[tup3ui]* faces, vec3 transform) except +
         @staticmethod
         RC[model*]* from_file(string file_path, bint animated) except +
+        @staticmethod
+        void set_vertex_quantization(bint enabled)
+        @staticmethod
+        bint get_vertex_quantization()
+        @staticmethod
+        void set_default_residency(GeometryResidency policy)
+        @staticmethod
+        GeometryResidency get_default_residency()
+        GeometryResidency residency
+        void set_residency(GeometryResidency policy)
+        size_t get_cpu_bytes()
+        size_t get_gpu_bytes()
         string name
         RC[material*]* mesh_material
         vector[tup3ui]* faces
@@ -793,6 +879,13 @@ cdef extern from "../src/Model.h":
         RC[mesh_dict*]* mesh_data
         bint animated
         bint use_default_material_properties
+        @staticmethod
+        void set_lod_selection(const vector[float]& screen_sizes, float hysteresis)
+        @staticmethod
+        vector[float] get_lod_screen_sizes()
+
+cpdef void set_lod_selection(list screen_sizes, float hysteresis = *)
+cpdef list get_lod_screen_sizes()
 
 cdef class Model:
     cdef:
@@ -806,6 +899,109 @@ cdef class Model:
     @staticmethod
     cdef Model from_cpp_ptr(RC[model*]* cppinst)
 
+cdef extern from "../src/AsyncLoader.h":
+    cdef cppclass model_load:
+        bint ready()
+        RC[model*]* get() except +
+        string file_path
+
+    cdef cppclass async_loader:
+        @staticmethod
+        async_loader& get()
+        shared_ptr[model_load] load(string file_path, bint animated) except +
+        size_t pending_uploads()
+        double upload_budget_ms
+
+cdef class ModelLoad:
+    cdef:
+        shared_ptr[model_load] c_class
+        object _callback
+        Model _model
+
+cdef void _dispatch_model_loads()
+
+cpdef void set_upload_budget(double milliseconds)
+cpdef double get_upload_budget()
+
+cdef extern from "../src/CookedModel.h":
+    cdef cppclass cooked_model:
+        @staticmethod
+        string path_for(string file_path)
+        @staticmethod
+        string cook(string file_path, string cooked_path) except +
+
+cpdef str cook_model(str file_path, str cooked_path = *)
+cpdef void set_vertex_quantization(bint enabled)
+cpdef bint get_vertex_quantization()
+cpdef void set_geometry_residency(GeometryResidency policy)
+cpdef GeometryResidency get_geometry_residency()
+
+cdef extern from "../src/MeshOptimizer.h":
+    cdef cppclass mesh_optimizer:
+        @staticmethod
+        void set_import_optimization(bint enable, bint log)
+        @staticmethod
+        bint get_import_optimization()
+        @staticmethod
+        void self_test() except +
+
+cpdef void set_mesh_optimization(bint enabled, bint log = *)
+cpdef bint get_mesh_optimization()
+cpdef void self_test_mesh_optimizer()
+
+cdef extern from "../src/MeshSimplifier.h":
+    cdef cppclass mesh_simplifier:
+        @staticmethod
+        void set_lod_generation(size_t levels, float reduction, float max_error)
+        @staticmethod
+        size_t get_lod_generation()
+
+cpdef void set_lod_generation(size_t levels, float reduction = *, float max_error = *)
+cpdef size_t get_lod_generation()
+
+cdef extern from "../src/LightClusters.h":
+    cdef cppclass light_clusters:
+        @staticmethod
+        void self_test() except +
+
+cpdef void self_test_light_clusters()
+
+cdef extern from "../src/Skeleton.h":
+    cdef cppclass skeleton:
+        @staticmethod
+        double benchmark(size_t joint_count, size_t iterations)
+
+cpdef double benchmark_skeleton(size_t joints = *, size_t iterations = *)
+
+cdef extern from "../src/AnimationStage.h":
+    cdef cppclass animation_stage:
+        @staticmethod
+        vector[double] benchmark(size_t animator_count, size_t joint_count, size_t max_threads, size_t frames) except +
+
+cpdef list benchmark_animation(size_t animators = *, size_t joints = *, size_t max_threads = *, size_t frames = *)
+
+cdef extern from "../src/GeometryArena.h":
+    cdef struct geometry_arena_stats:
+        size_t arenas
+        size_t allocations
+        size_t vertex_capacity_bytes
+        size_t vertex_used_bytes
+        size_t index_capacity_bytes
+        size_t index_used_bytes
+        size_t free_ranges
+        size_t largest_free_bytes
+        size_t grows
+        size_t defragmentations
+
+    cdef cppclass geometry_arena:
+        @staticmethod
+        void defragment_all()
+        @staticmethod
+        geometry_arena_stats get_stats()
+
+cpdef dict get_geometry_arena_stats()
+cpdef void defragment_geometry()
+
 
 
 cdef extern from "../src/Object3d.h":
@@ -835,6 +1031,10 @@ cdef extern from "../src/Object3d.h":
 
         inline matrix4x4 get_model_matrix()
 
+        object3d* parent
+        void set_parent(object3d* new_parent) except +
+        void play_animation(const string& name, float speed, float start_time) except +
+
 
 cdef class Object3D:
     cdef:
@@ -843,14 +1043,23 @@ cdef class Object3D:
         public Material _material
         Vec3 _position, _scale
         Quaternion _rotation
+        Object3D _parent
+        list _children
     
     cpdef void set_uniform(self, str name, value:UniformValueType)
     cpdef void add_collider(self, Collider collider)
     cpdef void remove_collider(self, Collider collider)
-    cpdef void play_animation(self, str animation_name)
+    cpdef void play_animation(self, str animation_name, float speed = *, float start_time = *)
 
     cpdef Matrix4x4 get_model_matrix(self)
 
+cdef extern from "../src/Frustum.h":
+    cdef cppclass frustum:
+        @staticmethod
+        void self_test() except +
+
+cpdef void self_test_frustum()
+
 cdef extern from "../src/Camera.h":
 
     cdef cppclass camera:
@@ -862,6 +1071,7 @@ cdef extern from "../src/Camera.h":
         float focal_length
         float fov
         matrix4x4 projection, view
+        frustum view_frustum
         double * deltatime
         long long * time_ns
         long long * time
@@ -970,7 +1180,32 @@ cdef class Text:
         Font _font
         Material _material
 
+cdef extern from "../src/RenderQueue.h":
+    cdef struct render_stats:
+        size_t draw_calls
+        size_t program_binds
+        size_t program_binds_skipped
+        size_t texture_binds
+        size_t texture_binds_skipped
+        size_t vao_binds
+        size_t vao_binds_skipped
+        size_t instanced_draw_calls
+        size_t instances
+        size_t objects_culled
+        size_t meshes_culled
+        size_t emitters_culled
+        size_t triangles
+        size_t full_detail_triangles
+        size_t bone_palette_uploads
+        size_t bone_palette_uploads_skipped
+        size_t poses
+        size_t poses_shared
+
 cdef extern from "../src/Window.h":
+    cdef struct scene_ray_hit:
+        object3d* object
+        float distance
+
     cdef cppclass window:
         window() except +
         window(string title, camera* cam, int width, int height, bint fullscreen, vec3 * ambient_light) except +
@@ -979,6 +1214,8 @@ cdef extern from "../src/Window.h":
         int width, height
         bint resizeable
         void update() except +
+        @staticmethod
+        void self_test_frame() except +
         void lock_mouse(bint lock) except +
         inline void set_fullscreen(bint value)
 
@@ -986,6 +1223,11 @@ cdef extern from "../src/Window.h":
         void remove_object(object3d* obj)
         void add_object_list(vector[object3d*] objs)
         void remove_object_list(vector[object3d*] objs)
+        void refit_object(object3d* obj)
+        vector[object3d*] query_aabb(const vec3& min, const vec3& max)
+        vector[object3d*] query_sphere(const vec3& center, float radius)
+        vector[object3d*] query_frustum(const frustum& view)
+        vector[scene_ray_hit] raycast(const vec3& origin, const vec3& direction, float max_distance)
 
         void add_object2d(object2d* obj)
         void remove_object2d(object2d* obj)
@@ -1024,12 +1266,15 @@ cdef extern from "../src/Window.h":
         long long time
         vec3 * ambient_light
         skybox* sky_box
+        render_stats get_render_stats()
 
 cdef class Window:
     cdef:
         window* c_class
         Vec3 _ambient_light
         SkyBox _sky_box
+        # Object3D by c_class address, to hand query results back to python.
+        dict _objects
     
 
     cpdef void update(self)
@@ -1040,6 +1285,12 @@ cdef class Window:
     cpdef void remove_object(self, Object3D obj)
     cpdef void add_object_list(self, list[Object3D] objs)
     cpdef void remove_object_list(self, list[Object3D] objs)
+    cpdef void refit_object(self, Object3D obj)
+    cpdef list query_aabb(self, Vec3 min, Vec3 max)
+    cpdef list query_sphere(self, Vec3 center, float radius)
+    cpdef list query_frustum(self, Camera cam)
+    cpdef list raycast(self, Vec3 origin, Vec3 direction, float max_distance = *)
+    cdef list _wrap_objects(self, vector[object3d*] objs)
 
     # obj2ds
 
@@ -1,5 +1,5 @@
 from enum import Enum
-from typing import Generator
+from typing import Generator, Callable
 import math
 
 UniformValueType = int | float | Matrix2x2 | Matrix2x3 | Matrix2x4 | Matrix3x2 | Matrix3x3 | Matrix3x4 | Matrix4x2 | Matrix4x3 | Matrix4x4 | Vec2 | Vec3 | Vec4
@@ -11,6 +11,161 @@ Includes:
 `int` , `float` , :class:`Matrix2x2` , :class:`Matrix2x3` , :class:`Matrix2x4` , :class:`Matrix3x2` , :class:`Matrix3x3` , :class:`Matrix3x4` , :class:`Matrix4x2` , :class:`Matrix4x3` , :class:`Matrix4x4` , :class:`Vec2` , :class:`Vec3` , :class:`Vec4`
 """
 
+def set_worker_count(count: int) -> None:
+    """
+    Sets how many worker threads the engine uses for animation, particle, transform and light work each frame.  Rendering always stays on the main thread.  `0` runs everything on the main thread in a fixed order, which makes runs repeatable for tests.  Defaults to one less than the number of hardware threads.  Do not call it while :meth:`Window.update` is running.
+    """
+
+def get_worker_count() -> int:
+    """
+    Returns how many worker threads the engine uses, see :func:`set_worker_count` .
+    """
+
+def self_test_job_system() -> None:
+    """
+    Checks the worker threads without a :class:`Window` : parallel work has to cover every item exactly once with 0, 1, 2 and 4 workers and jobs have to run after the jobs they depend on.  Then steps particles, animations and a parent child hierarchy for a few seconds of frames through the same simulation code :meth:`Window.update` runs, on a window without SDL or GL, and checks that two runs with `0` workers and one with `3` end byte identical.  It changes the worker count while it runs, see :func:`set_worker_count` , so do not call it while :meth:`Window.update` is running.  Raises `RuntimeError` describing the first mismatch.
+    """
+
+def set_program_cache_dir(path: str) -> None:
+    """
+    Sets the directory linked shader programs are saved to, so later launches load them instead of compiling.  Entries are tied to the GPU driver and recompiled automatically when it changes.  An empty string turns the cache off.  Call it before creating any :class:`Material` .  Defaults to `loxoc_program_cache` inside the system temp directory.
+    """
+
+def get_program_cache_dir() -> str:
+    """
+    Returns the directory linked shader programs are cached in, see :func:`set_program_cache_dir` .
+    """
+
+def get_program_cache_stats() -> dict[str, int]:
+    """
+    Counters of the shader program cache since launch: `hits` were loaded from disk, `misses` had to be compiled, `rejected` counts cached programs the driver refused (they are compiled and replaced) and `stored` how many were written.
+    """
+
+def set_upload_budget(milliseconds: float) -> None:
+    """
+    How much time each :meth:`Window.update` may spend creating the GPU resources of models loaded by :meth:`Model.from_file_async` .  At least one resource is created per frame while any are waiting.  Defaults to `2.0` .
+    """
+
+def get_upload_budget() -> float:
+    """
+    Returns the per frame upload budget in milliseconds, see :func:`set_upload_budget` .
+    """
+
+def cook_model(file_path: str, cooked_path: str = "") -> str:
+    """
+    Imports the 3D asset file and writes it as a cooked model to `cooked_path` , which defaults to `file_path` with `.cooked` appended.  :meth:`Model.from_file` and :meth:`Model.from_file_async` load the cooked file instead of the asset whenever it is not older than the asset, which skips the import and uploads the mesh data straight from the file.  Textures are referenced by path, not copied.  Needs no :class:`Window` , returns the path written to.
+    """
+
+def set_vertex_quantization(enabled: bool) -> None:
+    """
+    Lets models loaded after this call store their vertices quantized on the GPU: 10-10-10-2 normals, half float texture coordinates and 16 bit bone weights.  Static meshes take 20 instead of 32 bytes per vertex, animated ones 32 instead of 52.  Texture coordinates far outside of `0..1` lose precision.  Cooked models keep the choice they were cooked with.  Defaults to `False` .
+    """
+
+def get_vertex_quantization() -> bool:
+    """
+    Returns whether vertex quantization is enabled, see :func:`set_vertex_quantization` .
+    """
+
+def set_geometry_residency(policy: GeometryResidency) -> None:
+    """
+    What the meshes of models loaded after this call keep on the CPU once they were uploaded, see :class:`GeometryResidency` .  Defaults to `GeometryResidency.KEEP` .
+    """
+
+def get_geometry_residency() -> GeometryResidency:
+    """
+    Returns the residency policy of later loads, see :func:`set_geometry_residency` .
+    """
+
+def set_mesh_optimization(enabled: bool, log: bool = False) -> None:
+    """
+    Whether models loaded after this call get their meshes optimized on import: identical vertices are merged, triangles are reordered for the GPU's vertex cache and to draw outward facing parts first, and vertices are stored in the order they are drawn.  With `log` each mesh prints its average cache miss ratio (ACMR) and transformed vertex ratio (ATVR) before and after.  Defaults to `True` .
+    """
+
+def get_mesh_optimization() -> bool:
+    """
+    Returns whether meshes are optimized on import, see :func:`set_mesh_optimization` .
+    """
+
+def self_test_mesh_optimizer() -> None:
+    """
+    Runs the import time mesh optimization on a small scattered grid without a :class:`Window` and checks that welding finds the shared vertices, that the vertex cache does no worse than before, that every triangle survives with its winding and that two runs give byte identical buffers.  Raises `RuntimeError` describing the first mismatch.
+    """
+
+def set_lod_generation(levels: int, reduction: float = 0.5, max_error: float = 0.02) -> None:
+    """
+    Has models loaded after this call generate up to `levels` simplified levels of detail per mesh, each with `reduction` times the triangles of the one before.  Simplification stops where it would move the surface by more than `max_error` times the mesh's size, and keeps open borders and texture seams in place.  Cooked models keep the levels they were cooked with.  Defaults to 0 levels, which turns generation off.
+    """
+
+def get_lod_generation() -> int:
+    """
+    Returns how many levels of detail loads generate, see :func:`set_lod_generation` .
+    """
+
+def self_test_light_clusters() -> None:
+    """
+    Checks the CPU side of clustered lighting without a :class:`Window` : known point and spot lights have to land in the clusters they touch and nowhere else, the SSE2 and scalar overlap tests have to agree and a full light index list has to drop whole clusters cleanly.  Raises `RuntimeError` describing the first mismatch.
+    """
+
+def self_test_frustum() -> None:
+    """
+    Checks view frustum culling without a :class:`Window` : known spheres and boxes have to come out inside, outside or intersecting, and the SSE2 and scalar plane tests have to agree on random volumes seen by random cameras, huge ones included.  Raises `RuntimeError` describing the first mismatch.
+    """
+
+def benchmark_skeleton(joints: int = 100, iterations: int = 1000) -> float:
+    """
+    Poses a synthetic skeleton of `joints` animated joints `iterations` times and returns the average nanoseconds per pose, the cost an animated :class:`Model` adds to every frame.
+    """
+
+def benchmark_animation(animators: int = 500, joints: int = 60, max_threads: int = 16, frames: int = 100) -> list[float]:
+    """
+    Runs the per frame animation stage over `animators` independently playing skeletons of `joints` joints, with 1 up to `max_threads` threads, and returns the average nanoseconds per frame for each thread count.  Needs no :class:`Window` .  It changes the worker count while it runs, see :func:`set_worker_count` , so do not call it while :meth:`Window.update` is running.
+    """
+
+def set_lod_selection(screen_sizes: list[float], hysteresis: float = 0.1) -> None:
+    """
+    Every frame each :class:`Object3D` picks a level of detail from how big its model's bounding sphere appears on screen.  Objects smaller than `screen_sizes[i]` times the screen height draw at level `i + 1` .  An object only changes level once its size is past a threshold by the `hysteresis` fraction, so objects at a threshold do not flicker between levels.  Defaults to `[0.5, 0.25, 0.125, 0.0625]` .  The triangles this saves show up in :attr:`Window.render_stats` .
+    """
+
+def get_lod_screen_sizes() -> list[float]:
+    """
+    Returns the screen size thresholds of :func:`set_lod_selection` .
+    """
+
+def get_geometry_arena_stats() -> dict[str, int]:
+    """
+    Meshes share one vertex and one index buffer per vertex format, so drawing them never switches vertex arrays.  Returns the occupancy of these buffers: the number of `arenas` and mesh `allocations` , `vertex_capacity_bytes` , `vertex_used_bytes` , `index_capacity_bytes` and `index_used_bytes` , how many `free_ranges` there are and the `largest_free_bytes` of them, plus how many buffer `grows` and `defragmentations` ran since launch.
+    """
+
+def defragment_geometry() -> None:
+    """
+    Moves all meshes to the front of their shared buffers and shrinks the buffers to fit.  Happens on its own once more than half of a buffer is left empty by freed meshes, call this after unloading a level to do it right away.
+    """
+
+def set_texture_cache_budget(bytes: int) -> None:
+    """
+    Textures loaded from files are shared by path, wrapping and filtering, so an image is only decoded and uploaded once.  Once the cached textures use more than `bytes` of video memory, the least recently loaded ones that no :class:`Material` , :class:`Sprite` or :class:`Texture` uses anymore are released.  Defaults to 512 MiB.
+    """
+
+def get_texture_cache_budget() -> int:
+    """
+    Returns the texture cache budget in bytes, see :func:`set_texture_cache_budget` .
+    """
+
+def collect_unused_textures() -> int:
+    """
+    Releases every cached texture that nothing uses anymore regardless of the budget and returns how many were released.
+    """
+
+def get_texture_cache_stats() -> dict[str, int]:
+    """
+    Counters of the texture cache since launch: `hits` and `misses` of texture loads, `evictions`, plus the `textures` currently cached and their estimated `memory_bytes` .
+    """
+
+def get_texture_memory() -> list[dict]:
+    """
+    One entry per cached texture with its `file_path` , `width` , `height` , `channels` , estimated `memory_bytes` and how many `users` reference it.
+    """
+
 class ShaderType(Enum):
     """
     The shader type of a :class:`Shader` object.
@@ -147,6 +302,28 @@ class Mesh:
         :rtype: str
         """
 
+    @property
+    def residency(self) -> GeometryResidency:
+        """
+        What the mesh keeps of its geometry on the CPU after it was uploaded.  Setting it on an uploaded mesh drops what the new policy does not keep right away, dropped geometry can not come back.
+        """
+
+    @residency.setter
+    def residency(self, value:GeometryResidency) -> None:
+        ...
+
+    @property
+    def cpu_memory(self) -> int:
+        """
+        Bytes of geometry the mesh keeps on the CPU.
+        """
+
+    @property
+    def gpu_memory(self) -> int:
+        """
+        Bytes of the mesh's vertex and index buffers on the GPU.
+        """
+
 class MeshDict:
     """
     :class:`Loxoc.MeshDict` is a datastructure that acts like a statically typed dictionary storing each :class:`Mesh<Loxoc.Mesh>` by name.
@@ -277,6 +454,38 @@ class Model:
         Returns the :class:`Model` instance created from the provided file.  If the 3D asset contains animations, set `animated` to `True` .
         """
 
+    @staticmethod
+    def from_file_async(file_path:str, animated:bool = False, callback:Callable[[ModelLoad], None] | None = None) -> ModelLoad:
+        """
+        Starts loading the file on a background thread and returns immediately.  The file is parsed and its textures are decoded off the main thread, the GPU uploads are spread over the following :meth:`Window.update` calls, see :func:`set_upload_budget` .  `callback` is called with the :class:`ModelLoad` from :meth:`Window.update` once it finished.  The returned :class:`ModelLoad` can also be awaited.
+        """
+
+class ModelLoad:
+    """
+    A :class:`Model` being loaded by :meth:`Model.from_file_async` .
+    """
+
+    def done(self) -> bool:
+        """
+        Whether the load finished, successfully or not.
+        """
+
+    def result(self) -> Model:
+        """
+        Returns the loaded :class:`Model` , raising the error if loading failed.  If it is not done yet this waits for it and finishes its GPU uploads right away.
+        """
+
+    @property
+    def file_path(self) -> str:
+        """
+        The file being loaded.
+        """
+
+    def __await__(self) -> Generator[None, None, Model]:
+        """
+        Awaiting a load returns its :class:`Model` once it is done, :meth:`Window.update` has to keep running meanwhile.
+        """
+
     @property
     def use_default_material_properties(self) -> bool:
         """
@@ -293,7 +502,7 @@ class Model:
 
     def play_animation(self, animation:str) -> None:
         """
-        Plays the specified animation.
+        Plays the specified animation on every :class:`Object3D` of this model that has not played one of its own with :meth:`Object3D.play_animation` .
         """
     
 
@@ -382,12 +591,30 @@ class Object3D:
 
     def get_model_matrix(self) -> Matrix4x4:
         """
-        Returns an instance of the model matrix as a :class:`Matrix4x4` .
+        Returns an instance of the model matrix as a :class:`Matrix4x4` .  This is the world transform, it includes the transforms of the object's parents.
+        """
+
+    @property
+    def parent(self) -> Object3D | None:
+        """
+        The :class:`Object3D` this object is attached to.  The object's position, rotation and scale are relative to its parent, so it follows the parent around.  Set to `None` to detach it.
         """
 
-    def play_animation(self, animation_name: str) -> None:
+    @parent.setter
+    def parent(self, value:Object3D | None) -> None:
         """
-        Plays the specified animation by name of the model.
+        The :class:`Object3D` this object is attached to.  The object's position, rotation and scale are relative to its parent, so it follows the parent around.  Set to `None` to detach it.
+        """
+
+    @property
+    def children(self) -> list[Object3D]:
+        """
+        The :class:`Object3D` s attached to this object.
+        """
+
+    def play_animation(self, animation_name: str, speed: float = 1.0, start_time: float = 0.0) -> None:
+        """
+        Plays the specified animation by name of the model on this object only, `speed` times as fast and starting `start_time` seconds in.  Objects sharing a :class:`Model` animate independently once they played their own animation, until then they follow :meth:`Model.play_animation` .  Objects showing the same animation at the same time share one computed pose.
         """
 
     @property
@@ -439,7 +666,12 @@ class Shader:
     def __init__(self, source:str, shader_type:ShaderType) -> None:...
 
     @classmethod
-    def from_file(cls, filepath:str, type:ShaderType) -> Shader:...
+    def from_file(cls, filepath:str, type:ShaderType) -> Shader:
+        """
+        Loads a shader file.  Each file is only read once, every later call returns the same shader, and
+        materials made from identical shaders share one compiled program.  Compile errors are raised when
+        the shader is first used in a :class:`Material`.
+        """
 
 class Vec4:
     """
@@ -869,6 +1101,12 @@ class Window:
         Time since the launch of the window in seconds.
         """
 
+    @property
+    def render_stats(self) -> dict[str, int]:
+        """
+        Counters from the last frame's 3D draws: `draw_calls` and, for programs, textures and vertex arrays, how many binds were made (`*_binds`) and how many were skipped because the state was already bound (`*_binds_skipped`).  `instanced_draw_calls` and `instances` count the hardware instanced draws, objects sharing a :class:`Model` and :class:`Material` are drawn together.  `objects_culled`, `meshes_culled` and `emitters_culled` count what was outside the camera's view and skipped.  `triangles` is what was drawn at the selected levels of detail and `full_detail_triangles` what full detail would have drawn, see :func:`set_lod_selection` .  `bone_palette_uploads` counts the animated poses uploaded, one call each, and `bone_palette_uploads_skipped` the submeshes whose pose was already in their shader.  `poses` counts the skeletons posed and `poses_shared` the animated objects that reused the pose of another showing the same animation at the same time.
+        """
+
     def update(self) -> None:
         """
         Re-renders and refreshes the :attr:`Window.event` on the application :class:`Window` .
@@ -915,6 +1153,31 @@ class Window:
         Removes multiple :class:`Object3D` s from the scene.  Only :class:`Object3D` s which are in the scene will be rendered by the camera.
         """
 
+    def refit_object(self, obj: Object3D) -> None:
+        """
+        Updates the scene bounds of an :class:`Object3D` after it was moved, rotated or scaled.  :meth:`Window.update` does this for every object, call it to query against the new transform before the next frame.
+        """
+
+    def query_aabb(self, min: Vec3, max: Vec3) -> list[Object3D]:
+        """
+        Returns the :class:`Object3D` s in the scene whose bounds overlap the world space box from `min` to `max` .
+        """
+
+    def query_sphere(self, center: Vec3, radius: float) -> list[Object3D]:
+        """
+        Returns the :class:`Object3D` s in the scene whose bounds overlap the sphere, useful for finding what is near a point.
+        """
+
+    def query_frustum(self, cam: Camera) -> list[Object3D]:
+        """
+        Returns the :class:`Object3D` s in the scene whose bounds are at least partly in view of the :class:`Camera` .
+        """
+
+    def raycast(self, origin: Vec3, direction: Vec3, max_distance: float = math.inf) -> list[tuple[Object3D, float]]:
+        """
+        Returns the :class:`Object3D` s whose bounds the ray enters within `max_distance` along with the distance to each, nearest first.  These are bounding box hits, use the colliders of the returned objects for exact tests.
+        """
+
     # OBJECT2D
 
     def add_object2d(self, obj: Object2D) -> None:
@@ -1523,6 +1786,16 @@ class Quaternion:
         Returns a slerped :class:`Quaternion` between two :class:`Quaternion` by the provided ratio.
         """
 
+class GeometryResidency(Enum):
+    """
+    What a :class:`Mesh` keeps of its geometry on the CPU once it was uploaded.  `KEEP` keeps everything, `POSITIONS_ONLY` keeps the vertex positions colliders are built from, `DISCARD` keeps nothing, the mesh can only be rendered then.  Cooking a model needs `KEEP` .
+
+    .. #pragma: ignore_inheritance
+    """
+    KEEP: 'GeometryResidency'
+    POSITIONS_ONLY: 'GeometryResidency'
+    DISCARD: 'GeometryResidency'
+
 class TextureFiltering(Enum):
     """
     The texture filtering setting for a :class:`Texture` .
@@ -1550,7 +1823,13 @@ class Texture:
     @classmethod
     def from_file(cls, file_path:str, wrap:TextureWraping = TextureWraping.REPEAT, filtering:TextureFiltering = TextureFiltering.LINEAR) -> Texture:
         """
-        Create a :class:`Texture` from the specified file.
+        Create a :class:`Texture` from the specified file.  Loading the same file with the same settings again returns the already uploaded texture, see :func:`set_texture_cache_budget` .
+        """
+
+    @property
+    def memory_bytes(self) -> int:
+        """
+        Estimated video memory used by the texture including its mipmaps.
         """
 
 class Sprite:
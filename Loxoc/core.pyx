@@ -1,6 +1,6 @@
 # distutils: language = c++
 from cython.parallel cimport prange
-from libc.math cimport M_PI
+from libc.math cimport M_PI, INFINITY
 from os import path
 from cpython.ref cimport Py_INCREF, Py_DECREF
 from cython.operator import dereference, preincrement, postincrement
@@ -24,6 +24,49 @@ import math
 cpdef void set_mod_path(str _path):
     c_set_mod_path(path.dirname(_path).encode())
 
+cpdef void set_worker_count(size_t count):
+    job_system.get().set_worker_count(count)
+
+cpdef size_t get_worker_count():
+    return job_system.get().get_worker_count()
+
+cpdef void self_test_job_system():
+    job_system.self_test()
+    window.self_test_frame()
+
+cpdef void set_program_cache_dir(str path):
+    gl_program.set_binary_cache_directory(path.encode())
+
+cpdef str get_program_cache_dir():
+    return gl_program.get_binary_cache_directory().decode()
+
+cpdef dict get_program_cache_stats():
+    return gl_program.get_binary_cache_stats()
+
+cpdef void set_texture_cache_budget(size_t bytes):
+    texture_cache.set_budget(bytes)
+
+cpdef size_t get_texture_cache_budget():
+    return texture_cache.get_budget()
+
+cpdef size_t collect_unused_textures():
+    return texture_cache.collect_unused()
+
+cpdef dict get_texture_cache_stats():
+    return texture_cache.get_stats()
+
+cpdef list get_texture_memory():
+    return [
+        {
+            "file_path": entry.file_path.decode(),
+            "width": entry.width,
+            "height": entry.height,
+            "channels": entry.number_of_channels,
+            "memory_bytes": entry.memory_bytes,
+            "users": entry.users
+        } for entry in texture_cache.get_entries()
+    ]
+
 cdef class Texture:
     @classmethod
     def from_file(cls, str file_path, TextureWraping wrap = TextureWraping.REPEAT, TextureFiltering filtering = TextureFiltering.LINEAR) -> Texture:
@@ -31,6 +74,10 @@ cdef class Texture:
         
 
 
+    @property
+    def memory_bytes(self) -> int:
+        return self.c_class.data.memory_bytes
+
     def __dealloc__(self):
         RC_collect(self.c_class)
 
@@ -45,7 +92,7 @@ ctypedef texture* texture_ptr
 
 cpdef Texture Texture_from_file(str file_path, TextureWraping wrap, TextureFiltering filtering):
     ret = Texture()
-    ret.c_class = new RC[texture_ptr](new texture(file_path.encode(), wrap, filtering))
+    ret.c_class = texture_cache.get(file_path.encode(), wrap, filtering)
 
     return ret
 
@@ -268,6 +315,22 @@ cdef class Mesh:
     def name(self) -> str:
         return bytes(self.c_class.data.name).decode()
 
+    @property
+    def residency(self) -> GeometryResidency:
+        return self.c_class.data.residency
+
+    @residency.setter
+    def residency(self, GeometryResidency value) -> None:
+        self.c_class.data.set_residency(value)
+
+    @property
+    def cpu_memory(self) -> int:
+        return self.c_class.data.get_cpu_bytes()
+
+    @property
+    def gpu_memory(self) -> int:
+        return self.c_class.data.get_gpu_bytes()
+
     @staticmethod
     cdef Mesh from_cpp(RC[mesh*]* cppinst):
         cdef:
@@ -303,6 +366,15 @@ cdef class Model:
     def from_file(str file_path, bint animated = False) -> Model:
         return model_from_file(file_path, animated)
 
+    @staticmethod
+    def from_file_async(str file_path, bint animated = False, callback = None) -> ModelLoad:
+        cdef ModelLoad load = ModelLoad.__new__(ModelLoad)
+        load.c_class = async_loader.get().load(file_path.encode(), animated)
+        load._callback = callback
+        if callback is not None:
+            _model_loads.append(load)
+        return load
+
     @property
     def use_default_material_properties(self) -> bint:
         return self.c_class.data.use_default_material_properties
@@ -348,6 +420,102 @@ cdef class Model:
     def __dealloc__(self):
         RC_collect(self.c_class)
 
+# loads with a callback, checked after every Window.update so callbacks run on the main thread.
+_model_loads = []
+
+cdef class ModelLoad:
+    def done(self) -> bool:
+        return self.c_class.get().ready()
+
+    def result(self) -> Model:
+        if self._model is None:
+            self._model = Model.from_cpp_ptr(self.c_class.get().get())
+        return self._model
+
+    @property
+    def file_path(self) -> str:
+        return self.c_class.get().file_path.decode()
+
+    def __await__(self):
+        import asyncio
+        while not self.c_class.get().ready():
+            yield from asyncio.sleep(0).__await__()
+        return self.result()
+
+cdef void _dispatch_model_loads():
+    global _model_loads
+    if not _model_loads:
+        return
+    cdef:
+        list pending = []
+        list finished = []
+        ModelLoad load
+    for load in _model_loads:
+        (finished if load.done() else pending).append(load)
+    _model_loads = pending
+    for load in finished:
+        load._callback(load)
+
+cpdef void set_upload_budget(double milliseconds):
+    async_loader.get().upload_budget_ms = milliseconds
+
+cpdef double get_upload_budget():
+    return async_loader.get().upload_budget_ms
+
+cpdef str cook_model(str file_path, str cooked_path = ""):
+    return cooked_model.cook(file_path.encode(), cooked_path.encode()).decode()
+
+cpdef void set_vertex_quantization(bint enabled):
+    mesh.set_vertex_quantization(enabled)
+
+cpdef bint get_vertex_quantization():
+    return mesh.get_vertex_quantization()
+
+cpdef void set_geometry_residency(GeometryResidency policy):
+    mesh.set_default_residency(policy)
+
+cpdef GeometryResidency get_geometry_residency():
+    return mesh.get_default_residency()
+
+cpdef void set_mesh_optimization(bint enabled, bint log = False):
+    mesh_optimizer.set_import_optimization(enabled, log)
+
+cpdef bint get_mesh_optimization():
+    return mesh_optimizer.get_import_optimization()
+
+cpdef void self_test_mesh_optimizer():
+    mesh_optimizer.self_test()
+
+cpdef void set_lod_generation(size_t levels, float reduction = 0.5, float max_error = 0.02):
+    mesh_simplifier.set_lod_generation(levels, reduction, max_error)
+
+cpdef size_t get_lod_generation():
+    return mesh_simplifier.get_lod_generation()
+
+cpdef void self_test_light_clusters():
+    light_clusters.self_test()
+
+cpdef void self_test_frustum():
+    frustum.self_test()
+
+cpdef double benchmark_skeleton(size_t joints = 100, size_t iterations = 1000):
+    return skeleton.benchmark(joints, iterations)
+
+cpdef list benchmark_animation(size_t animators = 500, size_t joints = 60, size_t max_threads = 16, size_t frames = 100):
+    return animation_stage.benchmark(animators, joints, max_threads, frames)
+
+cpdef void set_lod_selection(list screen_sizes, float hysteresis = 0.1):
+    model.set_lod_selection(screen_sizes, hysteresis)
+
+cpdef list get_lod_screen_sizes():
+    return model.get_lod_screen_sizes()
+
+cpdef dict get_geometry_arena_stats():
+    return geometry_arena.get_stats()
+
+cpdef void defragment_geometry():
+    geometry_arena.defragment_all()
+
 cdef class Object3D:
     def __init__(self, Model model_data, Vec3 position = None,
     Vec3 rotation = None, Vec3 scale = None,
@@ -356,6 +524,7 @@ cdef class Object3D:
         self._rotation = rotation.to_quaternion() if rotation else Vec3(0.0,0.0,0.0).to_quaternion()
         self._scale = scale if scale else Vec3(1.0, 1.0, 1.0)
         self._model_data = model_data
+        self._children = []
         # TODO propagate default material made in c++ to python frontend self._material
         if material:
             self._material = material
@@ -383,6 +552,23 @@ cdef class Object3D:
     cpdef Matrix4x4 get_model_matrix(self):
         return mat4x4_from_cpp(self.c_class.get_model_matrix())
 
+    @property
+    def parent(self) -> Object3D | None:
+        return self._parent
+
+    @parent.setter
+    def parent(self, Object3D value):
+        self.c_class.set_parent(value.c_class if value is not None else NULL)
+        if self._parent is not None:
+            self._parent._children.remove(self)
+        self._parent = value
+        if value is not None:
+            value._children.append(self)
+
+    @property
+    def children(self) -> list[Object3D]:
+        return list(self._children)
+
     cpdef void add_collider(self, Collider collider):
         collider.c_class.inc()
         self.c_class.colliders.push_back(collider.c_class)
@@ -404,8 +590,8 @@ cdef class Object3D:
         
         return False
 
-    cpdef void play_animation(self, str animation_name):
-        self._model_data.play_animation(animation_name)
+    cpdef void play_animation(self, str animation_name, float speed = 1.0, float start_time = 0.0):
+        self.c_class.play_animation(animation_name.encode(), speed, start_time)
 
     @property
     def position(self) -> Vec3:
@@ -480,9 +666,9 @@ cdef class Shader:
 
     @classmethod
     def from_file(cls, str filepath, ShaderType type) -> Shader:
-        with open(filepath, 'r') as fp:
-            src = fp.read()
-        return cls(src, type)
+        cdef Shader ret = cls.__new__(cls)
+        ret.c_class = shader.shared_from_file(filepath.encode(), type)
+        return ret
 
     @staticmethod
     cdef Shader from_cpp(RC[shader*]* cppinst):
@@ -1228,12 +1414,12 @@ cdef class Material:
 
     @diffuse_texture.setter
     def diffuse_texture(self, Texture value):
+        # textures can be shared through the texture cache, so swap the reference instead of writing into the old one.
+        value.c_class.inc()
         if self.c_class.data.diffuse_texture:
-            self.c_class.data.diffuse_texture.data[0] = value.c_class.data[0]
-        else:
-            self.c_class.data.diffuse_texture = value.c_class
-        if not self._diffuse_texture:
-            self._diffuse_texture = texture_from_cpp(self.c_class.data.diffuse_texture)
+            RC_collect(self.c_class.data.diffuse_texture)
+        self.c_class.data.diffuse_texture = value.c_class
+        self._diffuse_texture = value
 
     @property
     def specular_texture(self) -> Texture:
@@ -1241,12 +1427,12 @@ cdef class Material:
 
     @specular_texture.setter
     def specular_texture(self, Texture value):
+        # textures can be shared through the texture cache, so swap the reference instead of writing into the old one.
+        value.c_class.inc()
         if self.c_class.data.specular_texture:
-            self.c_class.data.specular_texture.data[0] = value.c_class.data[0]
-        else:
-            self.c_class.data.specular_texture = value.c_class
-        if not self._specular_texture:
-            self._specular_texture = texture_from_cpp(self.c_class.data.specular_texture)
+            RC_collect(self.c_class.data.specular_texture)
+        self.c_class.data.specular_texture = value.c_class
+        self._specular_texture = value
 
     @property
     def normals_texture(self) -> Texture:
@@ -1254,12 +1440,12 @@ cdef class Material:
 
     @normals_texture.setter
     def normals_texture(self, Texture value):
+        # textures can be shared through the texture cache, so swap the reference instead of writing into the old one.
+        value.c_class.inc()
         if self.c_class.data.normals_texture:
-            self.c_class.data.normals_texture.data[0] = value.c_class.data[0]
-        else:
-            self.c_class.data.normals_texture = value.c_class
-        if not self._normals_texture:
-            self._normals_texture = texture_from_cpp(self.c_class.data.normals_texture)
+            RC_collect(self.c_class.data.normals_texture)
+        self.c_class.data.normals_texture = value.c_class
+        self._normals_texture = value
     
     cpdef void set_uniform(self, str name, value:UniformValueType):
         _set_uniform(self, name, value)
@@ -1284,6 +1470,7 @@ cdef class Window:
 
     def __init__(self, str title, Camera cam, int width, int height, bint fullscreen = False, Vec3 ambient_light = None) -> None:
         self._ambient_light = ambient_light if ambient_light else Vec3(1.0, 1.0, 1.0)
+        self._objects = {}
         self.c_class = new window(title.encode(), cam.c_class, width, height, fullscreen, self._ambient_light.c_class)
     
     @property
@@ -1341,22 +1528,27 @@ cdef class Window:
     def time(self) -> int:
         return self.c_class.time
 
+    @property
+    def render_stats(self) -> dict:
+        return self.c_class.get_render_stats()
+
     def __dealloc__(self):
         del self.c_class
 
     cpdef void update(self):
         self.c_class.update()
+        _dispatch_model_loads()
 
     cpdef void lock_mouse(self, bint lock):
         self.c_class.lock_mouse(lock)
 
     cpdef void add_object(self, Object3D obj):
-        Py_INCREF(obj)
+        self._objects[<size_t>obj.c_class] = obj
         self.c_class.add_object(obj.c_class)
 
     cpdef void remove_object(self, Object3D obj):
         self.c_class.remove_object(obj.c_class)
-        Py_DECREF(obj)
+        self._objects.pop(<size_t>obj.c_class, None)
 
     cpdef void add_object_list(self, list[Object3D] objs):
         cdef:
@@ -1372,6 +1564,26 @@ cdef class Window:
         for obj in objs:
             self.remove_object(obj)
 
+    cpdef void refit_object(self, Object3D obj):
+        self.c_class.refit_object(obj.c_class)
+
+    cdef list _wrap_objects(self, vector[object3d*] objs):
+        cdef object3d* ob
+        return [self._objects[<size_t>ob] for ob in objs]
+
+    cpdef list query_aabb(self, Vec3 min, Vec3 max):
+        return self._wrap_objects(self.c_class.query_aabb(min.c_class[0], max.c_class[0]))
+
+    cpdef list query_sphere(self, Vec3 center, float radius):
+        return self._wrap_objects(self.c_class.query_sphere(center.c_class[0], radius))
+
+    cpdef list query_frustum(self, Camera cam):
+        return self._wrap_objects(self.c_class.query_frustum(cam.c_class.view_frustum))
+
+    cpdef list raycast(self, Vec3 origin, Vec3 direction, float max_distance = INFINITY):
+        cdef scene_ray_hit hit
+        return [(self._objects[<size_t>hit.object], hit.distance) for hit in self.c_class.raycast(origin.c_class[0], direction.c_class[0], max_distance)]
+
     cpdef void add_object2d(self, Object2D obj):
         Py_INCREF(obj)
         self.c_class.add_object2d(obj.c_class)
@@ -1801,7 +2013,9 @@ cdef class SpotLight:
 
     @cookie.setter
     def cookie(self, Texture value):
-        self._cookie.c_class[0] = value.c_class[0]
+        self.c_class.cookie = value.c_class
+        self.c_class.use_cookie = True
+        self._cookie = value
 
     @property
     def position(self) -> Vec3:
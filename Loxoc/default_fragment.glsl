@@ -1,23 +1,16 @@
 #version 330 core
 
 
+// std140 / buffer texture layouts, see UniformBuffer.h
 struct PointLight {
-    vec3 position;
-    vec3 color;
-	float radius;
-    float constant;
-    float linear;
-    float quadratic;
-    float intensity;
+    vec4 position; // xyz position, w radius
+    vec4 color; // rgb color, a intensity
+    vec4 attenuation; // constant, linear, quadratic
 };
 
 struct DirectionalLight {
-    mat4 rotation;
-    vec3 color;
-	vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    float intensity;
+    vec4 direction;
+    vec4 color; // rgb color, a intensity
 };
 
 struct Material {
@@ -28,31 +21,35 @@ struct Material {
 };
 
 struct SpotLight {
-    vec3 position;
-    mat4 rotation;
-    vec3 color;
-    float cutOff;
-    float outerCutOff;
-    float constant;
-    float linear;
-    float quadratic;
-    float intensity;
+    vec4 position;
+    vec4 direction;
+    vec4 color; // rgb color, a intensity
+    vec4 cone; // cos(cutOff), cos(outerCutOff)
+    vec4 attenuation; // constant, linear, quadratic
 };
 
 
 #define MAX_LIGHTS 15
 
-uniform PointLight point_lights[MAX_LIGHTS];
-uniform int total_point_lights;
-
-uniform DirectionalLight directional_lights[MAX_LIGHTS];
-uniform int total_directional_lights;
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 view_position;
+    vec4 ambient_light;
+};
 
-uniform SpotLight spot_lights[MAX_LIGHTS];
-uniform int total_spot_lights;
+layout(std140) uniform LightData {
+    DirectionalLight directional_lights[MAX_LIGHTS];
+    ivec4 light_counts; // point, directional, spot
+    ivec4 cluster_dims;
+    vec4 cluster_params; // slice scale, slice bias, tile size in pixels
+};
 
-uniform vec3 viewPos;
-uniform vec3 ambient_light;
+// Clustered point and spot lights, see LightClusters.h
+uniform samplerBuffer point_light_data; // 3 texels per light
+uniform samplerBuffer spot_light_data; // 5 texels per light
+uniform usamplerBuffer light_grid; // offset, point count | spot count << 16
+uniform usamplerBuffer light_index_list;
 
 uniform Material material;
 
@@ -63,8 +60,31 @@ in vec2 TexCoord;
 
 out vec4 FragColor;
 
-vec3 extractDirection(mat4 matrix) {
-    return normalize(vec3(matrix[2][0], matrix[2][1], matrix[2][2]));
+PointLight fetch_point_light(int index) {
+    int base = index * 3;
+    return PointLight(
+        texelFetch(point_light_data, base),
+        texelFetch(point_light_data, base + 1),
+        texelFetch(point_light_data, base + 2)
+    );
+}
+
+SpotLight fetch_spot_light(int index) {
+    int base = index * 5;
+    return SpotLight(
+        texelFetch(spot_light_data, base),
+        texelFetch(spot_light_data, base + 1),
+        texelFetch(spot_light_data, base + 2),
+        texelFetch(spot_light_data, base + 3),
+        texelFetch(spot_light_data, base + 4)
+    );
+}
+
+int cluster_index() {
+    float depth = -(view * vec4(FragPos, 1.0)).z;
+    int slice = clamp(int(floor(log(max(depth, 1e-4)) * cluster_params.x - cluster_params.y)), 0, cluster_dims.z - 1);
+    ivec2 tile = clamp(ivec2(gl_FragCoord.xy / cluster_params.zw), ivec2(0), cluster_dims.xy - 1);
+    return tile.x + cluster_dims.x * (tile.y + cluster_dims.y * slice);
 }
 
 vec4 LOXOC_default(vec4 base_color) {
@@ -72,36 +92,41 @@ vec4 LOXOC_default(vec4 base_color) {
     vec3 diffuse = vec3(0.0);
     vec3 specular = vec3(0.0);
     vec3 norm = normalize(Normal);
-    for(int i = 0; i < total_directional_lights; i++) { // DIRECTIONAL LIGHTS
+    for(int i = 0; i < light_counts.y; i++) { // DIRECTIONAL LIGHTS
         DirectionalLight current_l = directional_lights[i];
 
-        vec3 lightDir = extractDirection(current_l.rotation);
+        vec3 lightDir = current_l.direction.xyz;
         
         // Ambient
-        vec3 am_t = current_l.color * vec3(texture(material.diffuse_map, TexCoord));
+        vec3 am_t = current_l.color.rgb * vec3(texture(material.diffuse_map, TexCoord));
         ambient += am_t;
         
         // Diffuse 
         float diff = max(dot(norm, lightDir), 0.0);
-        vec3 dif_t = current_l.color * (diff * vec3(texture(material.diffuse_map, TexCoord)));
+        vec3 dif_t = current_l.color.rgb * (diff * vec3(texture(material.diffuse_map, TexCoord)));
         diffuse += dif_t;
         
         // Specular
         float specularStrength = 0.5;
-        vec3 viewDir    = normalize(viewPos - FragPos);
+        vec3 viewDir    = normalize(view_position.xyz - FragPos);
         vec3 halfwayDir = normalize(lightDir + viewDir);
         float spec = pow(max(dot(norm, halfwayDir), 0.0), material.shine);
-        vec3 sp_t = current_l.color * (spec * vec3(texture(material.specular_map, TexCoord)));
+        vec3 sp_t = current_l.color.rgb * (spec * vec3(texture(material.specular_map, TexCoord)));
         specular += sp_t;
     }
 
-    for(int i = 0; i < total_point_lights; i++) { // POINT LIGHTS
-		PointLight current_l = point_lights[i];
-		float l_distance = length(current_l.position - FragPos);
-        float attenuation = 1.0 / (current_l.constant + current_l.linear * l_distance + current_l.quadratic * (l_distance * l_distance));
-        vec3 color = current_l.color * current_l.intensity;
+    uvec2 cluster = texelFetch(light_grid, cluster_index()).rg;
+    int light_offset = int(cluster.x);
+    int cluster_point_lights = int(cluster.y & 0xFFFFu);
+    int cluster_spot_lights = int(cluster.y >> 16u);
+
+    for(int i = 0; i < cluster_point_lights; i++) { // POINT LIGHTS
+		PointLight current_l = fetch_point_light(int(texelFetch(light_index_list, light_offset + i).r));
+		float l_distance = length(current_l.position.xyz - FragPos);
+        float attenuation = 1.0 / (current_l.attenuation.x + current_l.attenuation.y * l_distance + current_l.attenuation.z * (l_distance * l_distance));
+        vec3 color = current_l.color.rgb * current_l.color.a;
 
-        vec3 lightDir = normalize(current_l.position - FragPos);
+        vec3 lightDir = normalize(current_l.position.xyz - FragPos);
 
         // Ambient
         vec3 am_t = color * vec3(texture(material.diffuse_map, TexCoord));
@@ -116,7 +141,7 @@ vec4 LOXOC_default(vec4 base_color) {
         
         // Specular
         float specularStrength = 0.5;
-        vec3 viewDir    = normalize(viewPos - FragPos);
+        vec3 viewDir    = normalize(view_position.xyz - FragPos);
         vec3 halfwayDir = normalize(lightDir + viewDir);
         float spec = pow(max(dot(norm, halfwayDir), 0.0), material.shine);
         vec3 sp_t = color * (spec * vec3(texture(material.specular_map, TexCoord)));
@@ -124,21 +149,22 @@ vec4 LOXOC_default(vec4 base_color) {
         specular += sp_t;
     }
 
-    for(int i = 0; i < total_spot_lights; i++) { // SPOT LIGHTS
-        SpotLight current_l = spot_lights[i];
+    light_offset += cluster_point_lights;
+    for(int i = 0; i < cluster_spot_lights; i++) { // SPOT LIGHTS
+        SpotLight current_l = fetch_spot_light(int(texelFetch(light_index_list, light_offset + i).r));
         
 
-        vec3 lightDir = normalize(current_l.position - FragPos);
+        vec3 lightDir = normalize(current_l.position.xyz - FragPos);
 
-        float theta = dot(lightDir, extractDirection(current_l.rotation));
-        float epsilon = current_l.cutOff - current_l.outerCutOff;
-        float intensity = clamp((theta - current_l.outerCutOff) / epsilon, 0.0, 1.0);
+        float theta = dot(lightDir, current_l.direction.xyz);
+        float epsilon = current_l.cone.x - current_l.cone.y;
+        float intensity = clamp((theta - current_l.cone.y) / epsilon, 0.0, 1.0);
 
-        float l_distance = length(current_l.position - FragPos);
-        float attenuation = 1.0 / (current_l.constant + current_l.linear * l_distance + current_l.quadratic * (l_distance * l_distance));
-        vec3 color = current_l.color * current_l.intensity;
+        float l_distance = length(current_l.position.xyz - FragPos);
+        float attenuation = 1.0 / (current_l.attenuation.x + current_l.attenuation.y * l_distance + current_l.attenuation.z * (l_distance * l_distance));
+        vec3 color = current_l.color.rgb * current_l.color.a;
     
-        if (theta > current_l.cutOff)
+        if (theta > current_l.cone.x)
         {       
             vec3 diffuse_tex_val = vec3(texture(material.diffuse_map, TexCoord));
             // Ambient
@@ -154,7 +180,7 @@ vec4 LOXOC_default(vec4 base_color) {
             
             // Specular
             float specularStrength = 0.5;
-            vec3 viewDir    = normalize(viewPos - FragPos);
+            vec3 viewDir    = normalize(view_position.xyz - FragPos);
             vec3 halfwayDir = normalize(lightDir + viewDir);
             float spec = pow(max(dot(norm, halfwayDir), 0.0), material.shine);
             vec3 sp_t = color * (spec * vec3(texture(material.specular_map, TexCoord)));
@@ -163,7 +189,7 @@ vec4 LOXOC_default(vec4 base_color) {
         }
     }
 
-    return vec4(max(ambient_light * base_color.xyz, ambient + diffuse + specular), base_color.w);
+    return vec4(max(ambient_light.xyz * base_color.xyz, ambient + diffuse + specular), base_color.w);
 }
 
 void main() {
@@ -4,15 +4,28 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
 
+#ifdef LOXOC_INSTANCED
+// one model matrix per instance, locations 5-8
+layout (location = 5) in mat4 instance_model;
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
+
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 view_position;
+    vec4 ambient_light;
+};
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoord;
 
 void main() {
+#ifdef LOXOC_INSTANCED
+    mat4 model = instance_model;
+#endif
     gl_Position = projection * view * model * vec4(aPos, 1.0);
     FragPos = vec3(model * vec4(aPos, 1.0));
     Normal = (model * vec4(aNormal, 0.0)).xyz;
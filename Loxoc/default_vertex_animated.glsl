@@ -7,8 +7,13 @@ layout(location = 3) in ivec4 aBoneIds;
 layout(location = 4) in vec4 aWeights;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 view_position;
+    vec4 ambient_light;
+};
 
 const int MAX_BONES = 100;
 const int MAX_BONE_INFLUENCE = 4;
@@ -15,19 +15,12 @@
 #include <map>
 #include "RC.h"
 #include "Material.h"
+#include "Skeleton.h"
 
 using std::vector;
 using std::string;
 using std::map;
 
-// Tree of assimp data to help decouple our animations from assimp
-struct assimp_node_data {
-    matrix4x4 transformation = matrix4x4(1.0f);
-    string name = "";
-    int children_size = 0;
-    vector<assimp_node_data> children;
-};
-
 // ANIMATION CLASS (animator class is below this)
 
 class animation {
@@ -36,6 +29,8 @@ public:
     float ticks_per_second = 0.0f;
     vector<bone> bones;
     vector<bone_info> bone_info_list;
+    // assimp_animation_tree with bones and bone infos resolved, what animators evaluate.
+    skeleton flat_skeleton;
 private:
     assimp_node_data assimp_animation_tree;
 public:
@@ -56,7 +51,7 @@ public:
         read_heirarchy_data(&assimp_animation_tree, scene->mRootNode);
         // assimp_animation_tree.transformation = matrix4x4(1.0f);
         read_missing_bones(animation, model);
-        dbg_vis_init();
+        flat_skeleton = skeleton(assimp_animation_tree, bones, this->bone_info_list);
     }
 
     animation(const aiScene* scene, const aiAnimation * animation, RC<model*>* model) {
@@ -68,7 +63,18 @@ public:
         read_heirarchy_data(&assimp_animation_tree, scene->mRootNode);
         // assimp_animation_tree.transformation = matrix4x4(1.0f);
         read_missing_bones(animation, model);
-        dbg_vis_init();
+        flat_skeleton = skeleton(assimp_animation_tree, bones, this->bone_info_list);
+    }
+    
+    // from parts that were already read, used by cooked models.
+    animation(float duration, float ticks_per_second, assimp_node_data tree, vector<bone> bones, vector<bone_info> bone_info_list):
+        duration(duration),
+        ticks_per_second(ticks_per_second),
+        bones(std::move(bones)),
+        bone_info_list(std::move(bone_info_list)),
+        assimp_animation_tree(std::move(tree))
+    {
+        flat_skeleton = skeleton(assimp_animation_tree, this->bones, this->bone_info_list);
     }
     
     ~animation(){}
@@ -272,6 +278,9 @@ public:
         debug_bones.push_back(mat.mat * glm::vec4(1.0f));
     }
     inline void dbg_render(const camera * cam, const matrix4x4 & model_mat) {
+        // built on first use, animations are constructed by loaders that may not own the GL context.
+        if (!this->debug_shader)
+            dbg_vis_init();
         glUseProgram(this->debug_shader);
 
         auto t_loc = glGetUniformLocation(debug_shader, "transform");
@@ -299,10 +308,13 @@ private:
 class animator {
 public:
     // attributes
-    vector<matrix4x4> final_bone_matricies;
+    // the pose update() and play() write, animation_stage poses into its own buffer instead.
+    vector<glm::mat4> final_bone_matricies;
     animation* current_animation = nullptr;
     float current_time = 0.0f;
     float delta_time = 0.0f;
+    // multiplies the clip's own ticks per second, negative plays it backwards.
+    float speed = 1.0f;
     bool show_debug = false;
 
     inline void render_debug(const camera * cam, const matrix4x4 & model_mat) {
@@ -313,64 +325,79 @@ public:
     // CONSTRUCTORS
 
     animator(animation* animation = nullptr) {
-        current_time = 0.0f;
-        current_animation = animation;
-        final_bone_matricies.reserve(100);
-
-        for (int i = 0; i < 100; i++)
-            final_bone_matricies.push_back(matrix4x4(1.0f));
+        play(animation);
     }
+    // palette may point at final_bone_matricies.
+    animator(const animator&) = delete;
+    animator& operator=(const animator&) = delete;
 
     // METHODS
 
     inline void update(float dt) {
-        // updates the current time of the animation and calls to calculate bone transforms
-        delta_time = dt;
-        if (current_animation) {
-            current_time = fmod(current_time + current_animation->ticks_per_second * dt, current_animation->duration);
-            // ensure that the current time is not exceeding the animation durration. mod so it loops back over.
-            calculate_bone_transform(current_animation->get_assimp_animation_tree(), matrix4x4(1.0f));
-        }
+        advance(dt);
+        pose();
     }
 
-    inline void set_uniforms(rc_material mater) {
-        for (int i = 0; i < final_bone_matricies.size(); i++) {
-            mater->data->set_uniform("final_bones_matrices[" + std::to_string(i) + "]", final_bone_matricies[i]);
+    inline void advance(float dt) {
+        // updates the current time of the animation, looping it over its duration.
+        delta_time = dt;
+        if (current_animation && current_animation->duration > 0.0f) {
+            current_time = fmod(current_time + current_animation->ticks_per_second * speed * dt, current_animation->duration);
+            if (current_time < 0.0f)
+                current_time += current_animation->duration;
         }
     }
 
-    inline void play(animation* animation) {
-        // plays the provided animation from the beginning
-        current_animation = animation;
-        current_time = 0.0f;
+    // poses the skeleton at current_time into final_bone_matricies and draws with it.
+    inline void pose() {
+        set_palette(final_bone_matricies.data(), final_bone_matricies.size());
+        pose_into(final_bone_matricies.data());
     }
 
-    inline void calculate_bone_transform(const assimp_node_data* node, matrix4x4 parent_transform) {
-        string node_name = node->name;
-        matrix4x4 bone_transform = node->transformation;
+    // poses the skeleton at current_time into out, which holds get_palette_size() matrices.
+    inline void pose_into(glm::mat4* out) {
+        if (current_animation)
+            current_animation->flat_skeleton.evaluate(current_animation->bones, cursors, current_time, joint_globals, out);
+    }
 
-        bone* bone = current_animation->find_bone(node_name);
+    // draws with count matrices at data, which have to stay valid until the next call.
+    inline void set_palette(const glm::mat4* data, size_t count) {
+        palette = data;
+        palette_count = count;
+    }
 
-        if (bone) {
-            bone->update(current_time);
-            bone_transform = bone->local_transform;
-        }
+    // how many matrices a pose of current_animation has.
+    inline size_t get_palette_size() const {
+        return final_bone_matricies.size();
+    }
 
-        // transform local bone space to the parent bone space to follow bone space heirarchy
-        matrix4x4 global_transformation = parent_transform * bone_transform;
-        // 
-        auto bone_info_list = current_animation->bone_info_list;
-        for (unsigned int i = 0; i < bone_info_list.size(); i++) {
-			if (bone_info_list[i].name == node_name) {
-                int index = bone_info_list[i].id;
-				matrix4x4 offset = bone_info_list[i].offset;
-				final_bone_matricies[index] = global_transformation * offset;
-				break;
-			}
-		}
+    // the pose as one array upload of the bones current_animation's meshes use.
+    inline void upload_palette(const material* mat, gl_state_tracker& state) const {
+        static const uniform_id bones_uniform = intern_uniform("final_bones_matrices");
+        state.upload_bone_palette(mat->get_uniform_location(bones_uniform), palette, palette_count);
+    }
 
-        for (int i = 0; i < node->children_size; i++) {
-            calculate_bone_transform(&node->children[i], global_transformation);
+    inline void play(animation* animation, float start_time = 0.0f) {
+        // plays the provided animation from start_time, in ticks
+        current_animation = animation;
+        current_time = 0.0f;
+        cursors.assign(animation ? animation->bones.size() : 0, bone_cursor());
+        // without an animation the shader still reads every bone, so they all rest at identity.
+        final_bone_matricies.assign(animation ? animation->flat_skeleton.palette_size : skeleton::MAX_BONES, glm::mat4(1.0f));
+        set_palette(final_bone_matricies.data(), final_bone_matricies.size());
+        if (animation && animation->duration > 0.0f) {
+            current_time = fmod(start_time, animation->duration);
+            if (current_time < 0.0f)
+                current_time += animation->duration;
         }
     }
+
+private:
+    // the pose drawn, final_bone_matricies or part of an animation_stage's frame buffer.
+    const glm::mat4* palette = nullptr;
+    size_t palette_count = 0;
+    // scratch for skeleton::evaluate, kept so poses do not allocate.
+    vector<glm::mat4> joint_globals;
+    // where this animator is in every channel of current_animation.
+    vector<bone_cursor> cursors;
 };
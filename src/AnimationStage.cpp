@@ -0,0 +1,90 @@
+#include "AnimationStage.h"
+#include "Animation.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+void animation_stage::run(vector<animator*>& animators, float dt, job_system& jobs) {
+    jobs.parallel_for(animators.size(), 256, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            animators[i]->advance(dt);
+    });
+
+    std::sort(animators.begin(), animators.end(), [](const animator* a, const animator* b) {
+        if (a->current_animation != b->current_animation)
+            return a->current_animation < b->current_animation;
+        return a->current_time < b->current_time;
+    });
+    this->posing.clear();
+    this->offsets.clear();
+    this->groups.assign(animators.size(), SIZE_MAX);
+    size_t total = 0, animated = 0;
+    for (size_t i = 0; i < animators.size(); i++) {
+        animator* player = animators[i];
+        if (!player->current_animation) {
+            // rests at identity in its own palette.
+            player->pose();
+            continue;
+        }
+        animated++;
+        const animator* last = this->posing.empty() ? nullptr : this->posing.back();
+        if (!last || last->current_animation != player->current_animation || last->current_time != player->current_time) {
+            this->posing.push_back(player);
+            this->offsets.push_back(total);
+            total += player->get_palette_size();
+        }
+        this->groups[i] = this->posing.size() - 1;
+    }
+
+    // sized before any animator points into it.
+    this->palettes.resize(total);
+    for (size_t i = 0; i < animators.size(); i++) {
+        size_t group = this->groups[i];
+        if (group != SIZE_MAX)
+            animators[i]->set_palette(this->palettes.data() + this->offsets[group], this->posing[group]->get_palette_size());
+    }
+    jobs.parallel_for(this->posing.size(), 4, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            this->posing[i]->pose_into(this->palettes.data() + this->offsets[i]);
+    });
+
+    this->poses = this->posing.size();
+    this->poses_shared = animated - this->posing.size();
+}
+
+vector<double> animation_stage::benchmark(size_t animator_count, size_t joint_count, size_t max_threads, size_t frames) {
+    // one clip of a second at 30 keys per second, every animator at its own time so none share.
+    const size_t key_count = 30;
+    assimp_node_data root;
+    vector<bone> channels;
+    vector<bone_info> bone_infos;
+    skeleton::synthetic_chain(joint_count, key_count, root, channels, bone_infos);
+    animation clip(static_cast<float>(key_count - 1), 30.0f, std::move(root), std::move(channels), std::move(bone_infos));
+
+    vector<std::unique_ptr<animator>> players;
+    vector<animator*> animators;
+    for (size_t i = 0; i < animator_count; i++) {
+        players.emplace_back(new animator());
+        players.back()->play(&clip, std::fmod(i * 0.37f, clip.duration));
+        animators.push_back(players.back().get());
+    }
+
+    job_system& jobs = job_system::get();
+    size_t workers = jobs.get_worker_count();
+    animation_stage stage;
+    vector<double> ret;
+    for (size_t threads = 1; threads <= max_threads; threads++) {
+        jobs.set_worker_count(threads - 1);
+        // a first run sizes the buffer and wakes the workers.
+        stage.run(animators, 1.0f / 60.0f, jobs);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t f = 0; f < frames; f++)
+            stage.run(animators, 1.0f / 60.0f, jobs);
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        ret.push_back(frames ? static_cast<double>(elapsed) / frames : 0.0);
+    }
+    jobs.set_worker_count(workers);
+    return ret;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "JobSystem.h"
+
+using std::vector;
+class animator;
+
+// Poses every animator drawn in a frame on the job_system before rendering, into one contiguous
+// buffer of bone palettes.  Needs no GL context, the window uploads the palettes afterwards.
+class animation_stage {
+public:
+    // advances every animator by dt and points each at its pose in palettes.  Animators showing the
+    // same clip at the same time share one pose, only the first of them evaluates it.
+    // animators must hold every animator once, it is reordered.
+    void run(vector<animator*>& animators, float dt, job_system& jobs);
+
+    // average nanoseconds per run for animator_count animators at different times of one clip on a
+    // chain of joint_count joints.  Entry i is run with i + 1 threads, the caller and i workers.
+    // Changes the job_system's worker count and restores it, so no jobs may be in flight.
+    static vector<double> benchmark(size_t animator_count, size_t joint_count, size_t max_threads, size_t frames);
+
+    // every pose of the last run back to back, animators point into it until the next run.
+    vector<glm::mat4> palettes;
+    size_t poses = 0;
+    size_t poses_shared = 0;
+private:
+    // the animators that evaluate a pose and where it starts in palettes.
+    vector<animator*> posing;
+    vector<size_t> offsets;
+    // per animator the index into posing of the pose it draws with.
+    vector<size_t> groups;
+};
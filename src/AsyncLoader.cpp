@@ -0,0 +1,115 @@
+#include "AsyncLoader.h"
+#include "Model.h"
+
+rc_model model_load::get() {
+    async_loader& loader = async_loader::get();
+    while (!this->ready()) {
+        if (loader.pending_uploads())
+            loader.pump(0.0);
+        else // still importing
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return this->future.get();
+}
+
+async_loader& async_loader::get() {
+    static async_loader instance;
+    return instance;
+}
+
+async_loader::~async_loader() {
+    {
+        std::lock_guard<std::mutex> lock(this->request_mutex);
+        this->running = false;
+    }
+    this->request_ready.notify_all();
+    if (this->importer.joinable())
+        this->importer.join();
+}
+
+std::shared_ptr<model_load> async_loader::load(const string& file_path, bool animated) {
+    auto load = std::make_shared<model_load>();
+    load->file_path = file_path;
+    load->future = load->promise.get_future().share();
+    {
+        std::lock_guard<std::mutex> lock(this->request_mutex);
+        // started on the first request so programs that never stream don't pay for the thread.
+        if (!this->importer.joinable())
+            this->importer = std::thread(&async_loader::import_main, this);
+        this->requests.push_back({load, animated});
+    }
+    this->request_ready.notify_one();
+    return load;
+}
+
+void async_loader::import_main() {
+    while (true) {
+        request req;
+        {
+            std::unique_lock<std::mutex> lock(this->request_mutex);
+            this->request_ready.wait(lock, [this]() {
+                return !this->running || !this->requests.empty();
+            });
+            if (!this->running)
+                return;
+            req = std::move(this->requests.front());
+            this->requests.pop_front();
+        }
+
+        std::shared_ptr<model_load> load = req.load;
+        gl_task_list gl_tasks;
+        rc_model result = nullptr;
+        try {
+            result = mesh::import_file(load->file_path, req.animated, gl_tasks);
+        } catch (...) {
+            load->promise.set_exception(std::current_exception());
+            continue;
+        }
+
+        // every task is queued on its own so the budget can spread a large model over several frames.
+        auto failed = std::make_shared<bool>(false);
+        std::lock_guard<std::mutex> lock(this->upload_mutex);
+        for (auto& task : gl_tasks) {
+            this->uploads.push_back([load, failed, task = std::move(task)]() {
+                if (*failed)
+                    return;
+                try {
+                    task();
+                } catch (...) {
+                    *failed = true;
+                    load->promise.set_exception(std::current_exception());
+                }
+            });
+        }
+        this->uploads.push_back([load, failed, result]() {
+            if (*failed)
+                return;
+            // flatten the node tree once so rendering never walks it, the VAOs exist by now.
+            result->data->get_draw_list();
+            load->promise.set_value(result);
+        });
+    }
+}
+
+void async_loader::pump(double budget_ms) {
+    auto start = std::chrono::steady_clock::now();
+    while (true) {
+        std::function<void()> upload;
+        {
+            std::lock_guard<std::mutex> lock(this->upload_mutex);
+            if (this->uploads.empty())
+                return;
+            upload = std::move(this->uploads.front());
+            this->uploads.pop_front();
+        }
+        upload();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() >= budget_ms)
+            return;
+    }
+}
+
+size_t async_loader::pending_uploads() {
+    std::lock_guard<std::mutex> lock(this->upload_mutex);
+    return this->uploads.size();
+}
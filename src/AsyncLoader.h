@@ -0,0 +1,67 @@
+#pragma once
+#include "Mesh.h"
+#include <future>
+#include <chrono>
+#include <thread>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+
+// A model being imported in the background, see async_loader::load.
+class model_load {
+public:
+    // true once the model is usable or the import failed.
+    inline bool ready() const {
+        return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+    // the imported model, rethrows what the import threw.  Has to be called on the GL thread,
+    // it runs the outstanding uploads right away instead of leaving them to later frames.
+    rc_model get();
+
+    string file_path;
+    std::shared_future<rc_model> future;
+private:
+    friend class async_loader;
+    std::promise<rc_model> promise;
+};
+
+// Imports models on a background thread so loading never stalls the frame.  Assimp parsing,
+// vertex conversion, bone weights and texture decoding happen there.  Creating the GL objects is
+// queued for the thread owning the context, which drains the queue with pump() under a time
+// budget, Window::update does so every frame.
+class async_loader {
+public:
+    static async_loader& get();
+    ~async_loader();
+
+    std::shared_ptr<model_load> load(const string& file_path, bool animated);
+
+    // runs queued uploads on the calling thread until budget_ms passed.  One upload always runs
+    // when any are queued so loading keeps moving on slow frames.
+    void pump(double budget_ms);
+    inline void pump() {
+        pump(upload_budget_ms);
+    }
+    size_t pending_uploads();
+
+    double upload_budget_ms = 2.0;
+private:
+    async_loader() {}
+    void import_main();
+
+    struct request {
+        std::shared_ptr<model_load> load;
+        bool animated;
+    };
+
+    std::thread importer;
+    std::mutex request_mutex;
+    std::condition_variable request_ready;
+    std::deque<request> requests;
+    bool running = true;
+
+    std::mutex upload_mutex;
+    std::deque<std::function<void()>> uploads;
+};
@@ -0,0 +1,418 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <glm/glm.hpp>
+#include "Frustum.h"
+
+using std::vector;
+
+struct aabb {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+
+    inline glm::vec3 center() const {
+        return (min + max) * 0.5f;
+    }
+
+    inline glm::vec3 extent() const {
+        return (max - min) * 0.5f;
+    }
+
+    // half the surface area, the cost used to pick tree siblings.
+    inline float perimeter() const {
+        glm::vec3 d = max - min;
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+
+    inline bool contains(const aabb& other) const {
+        return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+    }
+
+    inline bool overlaps(const aabb& other) const {
+        return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+    }
+
+    inline bool overlaps_sphere(const glm::vec3& point, float radius) const {
+        glm::vec3 closest = glm::clamp(point, min, max);
+        glm::vec3 d = closest - point;
+        return glm::dot(d, d) <= radius * radius;
+    }
+
+    // slab test, returns the entry distance or -1 when the ray misses within max_distance.
+    inline float raycast(const glm::vec3& origin, const glm::vec3& inv_direction, float max_distance) const {
+        glm::vec3 t0 = (min - origin) * inv_direction;
+        glm::vec3 t1 = (max - origin) * inv_direction;
+        glm::vec3 t_near = glm::min(t0, t1), t_far = glm::max(t0, t1);
+        float enter = std::max({t_near.x, t_near.y, t_near.z, 0.0f});
+        float exit = std::min({t_far.x, t_far.y, t_far.z, max_distance});
+        return enter <= exit ? enter : -1.0f;
+    }
+
+    inline static aabb combine(const aabb& a, const aabb& b) {
+        return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+    }
+
+    // bounds of this box after a model matrix, widened to stay axis aligned.
+    inline aabb transformed(const glm::mat4& model) const {
+        glm::vec3 c = glm::vec3(model * glm::vec4(center(), 1.0f));
+        glm::mat3 abs_basis = glm::mat3(model);
+        for (int i = 0; i < 3; i++)
+            abs_basis[i] = glm::abs(abs_basis[i]);
+        glm::vec3 e = abs_basis * extent();
+        return {c - e, c + e};
+    }
+};
+
+// Dynamic bounding volume hierarchy over fat AABBs.  Leaves are kept in a node pool and
+// addressed by proxy id, moving a proxy only reinserts it when it leaves its fat box.
+// The tree is rebalanced with rotations on the way up from every insert and remove.
+template<typename Data>
+class aabb_tree {
+public:
+    static constexpr int NULL_NODE = -1;
+
+    // how much leaf boxes are grown so small movements do not touch the tree.
+    float margin = 0.1f;
+
+    int insert(const aabb& box, Data data) {
+        int leaf = this->allocate_node();
+        this->nodes[leaf].tight = box;
+        this->nodes[leaf].box = this->fatten(box);
+        this->nodes[leaf].data = data;
+        this->nodes[leaf].height = 0;
+        this->insert_leaf(leaf);
+        this->proxy_count++;
+        return leaf;
+    }
+
+    void remove(int proxy) {
+        this->remove_leaf(proxy);
+        this->free_node(proxy);
+        this->proxy_count--;
+    }
+
+    // returns true when the proxy had to be reinserted.
+    bool move(int proxy, const aabb& box) {
+        tree_node& node = this->nodes[proxy];
+        node.tight = box;
+        if (node.box.contains(box))
+            return false;
+        this->remove_leaf(proxy);
+        this->nodes[proxy].box = this->fatten(box);
+        this->insert_leaf(proxy);
+        return true;
+    }
+
+    inline Data get_data(int proxy) const {
+        return this->nodes[proxy].data;
+    }
+
+    inline const aabb& get_fat_aabb(int proxy) const {
+        return this->nodes[proxy].box;
+    }
+
+    inline size_t size() const {
+        return this->proxy_count;
+    }
+
+    inline int height() const {
+        return this->root == NULL_NODE ? 0 : this->nodes[this->root].height;
+    }
+
+    template<typename F>
+    void query_aabb(const aabb& box, F&& callback) const {
+        this->traverse([&](const aabb& node_box) { return node_box.overlaps(box); }, [&](const tree_node& leaf) {
+            if (leaf.tight.overlaps(box))
+                callback(leaf.data);
+        });
+    }
+
+    template<typename F>
+    void query_sphere(const glm::vec3& center, float radius, F&& callback) const {
+        this->traverse([&](const aabb& node_box) { return node_box.overlaps_sphere(center, radius); }, [&](const tree_node& leaf) {
+            if (leaf.tight.overlaps_sphere(center, radius))
+                callback(leaf.data);
+        });
+    }
+
+    // callback(data, FrustumTest) gets INSIDE or INTERSECTS for every leaf not outside.
+    // Subtrees fully inside the frustum are collected without testing their children.
+    template<typename F>
+    void query_frustum(const frustum& view, F&& callback) const {
+        if (this->root == NULL_NODE)
+            return;
+        traversal_stack stack;
+        stack.push(this->root, false);
+        while (!stack.empty()) {
+            auto [index, inside] = stack.pop();
+            const tree_node& node = this->nodes[index];
+            FrustumTest result = FrustumTest::INSIDE;
+            if (!inside) {
+                const aabb& box = node.is_leaf() ? node.tight : node.box;
+                result = view.test_aabb(box.center(), box.extent());
+                if (result == FrustumTest::OUTSIDE)
+                    continue;
+            }
+            if (node.is_leaf()) {
+                callback(node.data, result);
+            } else {
+                bool child_inside = result == FrustumTest::INSIDE;
+                stack.push(node.child1, child_inside);
+                stack.push(node.child2, child_inside);
+            }
+        }
+    }
+
+    // callback(data, distance) for every leaf box the ray enters, in no particular order.
+    // The callback returns the new max distance, so returning the hit distance keeps only closer hits coming.
+    template<typename F>
+    void raycast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, F&& callback) const {
+        glm::vec3 dir = glm::normalize(direction);
+        glm::vec3 inv_direction = 1.0f / dir;
+        this->traverse([&](const aabb& node_box) { return node_box.raycast(origin, inv_direction, max_distance) >= 0.0f; }, [&](const tree_node& leaf) {
+            float hit = leaf.tight.raycast(origin, inv_direction, max_distance);
+            if (hit >= 0.0f)
+                max_distance = callback(leaf.data, hit);
+        });
+    }
+
+private:
+    struct tree_node {
+        aabb box; // fat box for leaves, union of the children otherwise
+        aabb tight; // leaves only, the box that was inserted
+        Data data = Data();
+        int parent = NULL_NODE; // next free node while in the free list
+        int child1 = NULL_NODE;
+        int child2 = NULL_NODE;
+        int height = -1; // -1 while free
+
+        inline bool is_leaf() const {
+            return child1 == NULL_NODE;
+        }
+    };
+
+    vector<tree_node> nodes;
+    int root = NULL_NODE;
+    int free_list = NULL_NODE;
+    size_t proxy_count = 0;
+
+    // one per query instead of a member, so const queries can nest from callbacks and run on
+    // several threads at once.  The tree is kept balanced, so the inline entries are enough for
+    // any realistic depth and the spill vector only allocates past them.
+    struct traversal_stack {
+        static constexpr size_t INLINE_ENTRIES = 64;
+        std::pair<int, bool> entries[INLINE_ENTRIES];
+        vector<std::pair<int, bool>> spill;
+        size_t count = 0;
+
+        inline void push(int index, bool inside) {
+            if (count < INLINE_ENTRIES)
+                entries[count] = {index, inside};
+            else
+                spill.push_back({index, inside});
+            count++;
+        }
+        inline std::pair<int, bool> pop() {
+            count--;
+            if (count < INLINE_ENTRIES)
+                return entries[count];
+            std::pair<int, bool> ret = spill.back();
+            spill.pop_back();
+            return ret;
+        }
+        inline bool empty() const {
+            return count == 0;
+        }
+    };
+
+    inline aabb fatten(const aabb& box) const {
+        return {box.min - glm::vec3(this->margin), box.max + glm::vec3(this->margin)};
+    }
+
+    template<typename NodeTest, typename LeafVisit>
+    void traverse(NodeTest&& node_test, LeafVisit&& leaf_visit) const {
+        if (this->root == NULL_NODE)
+            return;
+        traversal_stack stack;
+        stack.push(this->root, false);
+        while (!stack.empty()) {
+            int index = stack.pop().first;
+            const tree_node& node = this->nodes[index];
+            if (!node_test(node.box))
+                continue;
+            if (node.is_leaf()) {
+                leaf_visit(node);
+            } else {
+                stack.push(node.child1, false);
+                stack.push(node.child2, false);
+            }
+        }
+    }
+
+    int allocate_node() {
+        if (this->free_list == NULL_NODE) {
+            this->nodes.emplace_back();
+            return static_cast<int>(this->nodes.size() - 1);
+        }
+        int index = this->free_list;
+        this->free_list = this->nodes[index].parent;
+        this->nodes[index] = tree_node();
+        return index;
+    }
+
+    void free_node(int index) {
+        this->nodes[index].parent = this->free_list;
+        this->nodes[index].height = -1;
+        this->free_list = index;
+    }
+
+    void insert_leaf(int leaf) {
+        if (this->root == NULL_NODE) {
+            this->root = leaf;
+            this->nodes[leaf].parent = NULL_NODE;
+            return;
+        }
+
+        // walk down picking the child that grows the least.
+        aabb leaf_box = this->nodes[leaf].box;
+        int index = this->root;
+        while (!this->nodes[index].is_leaf()) {
+            const tree_node& node = this->nodes[index];
+            float area = node.box.perimeter();
+            float combined_area = aabb::combine(node.box, leaf_box).perimeter();
+
+            // cost of making a new parent for this node and the leaf
+            float cost = 2.0f * combined_area;
+            // minimum cost of pushing the leaf further down
+            float inheritance_cost = 2.0f * (combined_area - area);
+
+            auto descend_cost = [&](int child) {
+                const tree_node& c = this->nodes[child];
+                float grown = aabb::combine(leaf_box, c.box).perimeter();
+                return (c.is_leaf() ? grown : grown - c.box.perimeter()) + inheritance_cost;
+            };
+            float cost1 = descend_cost(node.child1);
+            float cost2 = descend_cost(node.child2);
+
+            if (cost < cost1 && cost < cost2)
+                break;
+            index = cost1 < cost2 ? node.child1 : node.child2;
+        }
+
+        int sibling = index;
+        int old_parent = this->nodes[sibling].parent;
+        int new_parent = this->allocate_node();
+        this->nodes[new_parent].parent = old_parent;
+        this->nodes[new_parent].box = aabb::combine(leaf_box, this->nodes[sibling].box);
+        this->nodes[new_parent].height = this->nodes[sibling].height + 1;
+        this->nodes[new_parent].child1 = sibling;
+        this->nodes[new_parent].child2 = leaf;
+        this->nodes[sibling].parent = new_parent;
+        this->nodes[leaf].parent = new_parent;
+
+        if (old_parent == NULL_NODE) {
+            this->root = new_parent;
+        } else if (this->nodes[old_parent].child1 == sibling) {
+            this->nodes[old_parent].child1 = new_parent;
+        } else {
+            this->nodes[old_parent].child2 = new_parent;
+        }
+
+        this->refit_ancestors(this->nodes[leaf].parent);
+    }
+
+    void remove_leaf(int leaf) {
+        if (leaf == this->root) {
+            this->root = NULL_NODE;
+            return;
+        }
+
+        int parent = this->nodes[leaf].parent;
+        int grand_parent = this->nodes[parent].parent;
+        int sibling = this->nodes[parent].child1 == leaf ? this->nodes[parent].child2 : this->nodes[parent].child1;
+
+        if (grand_parent == NULL_NODE) {
+            this->root = sibling;
+            this->nodes[sibling].parent = NULL_NODE;
+            this->free_node(parent);
+            return;
+        }
+
+        // the sibling takes the parent's place.
+        if (this->nodes[grand_parent].child1 == parent)
+            this->nodes[grand_parent].child1 = sibling;
+        else
+            this->nodes[grand_parent].child2 = sibling;
+        this->nodes[sibling].parent = grand_parent;
+        this->free_node(parent);
+
+        this->refit_ancestors(grand_parent);
+    }
+
+    void refit_ancestors(int index) {
+        while (index != NULL_NODE) {
+            index = this->balance(index);
+            tree_node& node = this->nodes[index];
+            const tree_node& child1 = this->nodes[node.child1];
+            const tree_node& child2 = this->nodes[node.child2];
+            node.height = 1 + std::max(child1.height, child2.height);
+            node.box = aabb::combine(child1.box, child2.box);
+            index = node.parent;
+        }
+    }
+
+    // Rotates the taller child of a up when the children's heights differ by more than one.
+    // Returns the index of the node now at a's position.
+    int balance(int a) {
+        tree_node& node_a = this->nodes[a];
+        if (node_a.is_leaf() || node_a.height < 2)
+            return a;
+
+        int b = node_a.child1;
+        int c = node_a.child2;
+        int difference = this->nodes[c].height - this->nodes[b].height;
+
+        if (difference > 1)
+            return this->rotate_up(a, c, b, false);
+        if (difference < -1)
+            return this->rotate_up(a, b, c, true);
+        return a;
+    }
+
+    // Moves child up into a's place, a keeps other and the shorter grandchild.
+    int rotate_up(int a, int child, int other, bool child_is_first) {
+        int f = this->nodes[child].child1;
+        int g = this->nodes[child].child2;
+
+        this->nodes[child].child1 = a;
+        this->nodes[child].parent = this->nodes[a].parent;
+        this->nodes[a].parent = child;
+
+        int parent = this->nodes[child].parent;
+        if (parent == NULL_NODE) {
+            this->root = child;
+        } else if (this->nodes[parent].child1 == a) {
+            this->nodes[parent].child1 = child;
+        } else {
+            this->nodes[parent].child2 = child;
+        }
+
+        // the taller grandchild stays with child, the shorter one replaces child under a.
+        int keep = this->nodes[f].height > this->nodes[g].height ? f : g;
+        int give = keep == f ? g : f;
+        this->nodes[child].child2 = keep;
+        if (child_is_first)
+            this->nodes[a].child1 = give;
+        else
+            this->nodes[a].child2 = give;
+        this->nodes[give].parent = a;
+
+        this->nodes[a].box = aabb::combine(this->nodes[other].box, this->nodes[give].box);
+        this->nodes[a].height = 1 + std::max(this->nodes[other].height, this->nodes[give].height);
+        this->nodes[child].box = aabb::combine(this->nodes[a].box, this->nodes[keep].box);
+        this->nodes[child].height = 1 + std::max(this->nodes[a].height, this->nodes[keep].height);
+        return child;
+    }
+};
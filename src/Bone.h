@@ -6,6 +6,8 @@
 #include "Quaternion.h"
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <cstdint>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -33,142 +35,130 @@ struct key_scale {
     float time_stamp = 0.0f;
 };
 
+// Where playback last was in each key track of a bone, so the next sample starts searching there.
+struct bone_cursor {
+    uint32_t position = 0;
+    uint32_t rotation = 0;
+    uint32_t scale = 0;
+};
+
 // The bone!
 
 class bone {
 public:
     string name;
     int id = -1;
-    matrix4x4 local_transform = matrix4x4(1.0f); // This is the transform matrix that all of the lerp'd keyframes are baked into
-    // it is the orientation of the bone in the animation at the current frame.
-private:
-    vector<key_position> positions;
-    vector<key_rotation> rotations;
-    vector<key_scale> scales;
-    int positions_size=0, rotations_size=0, scales_size=0;
-public:
+
+    // keys are stored as separate time and value arrays, the searches only touch the times.
+    // Each channel keeps its own tracks and is sampled on its own, channels have different key
+    // counts and times, so there is no layout that interpolates many of them in one pass.
+    vector<float> position_times;
+    vector<glm::vec3> position_values;
+    vector<float> rotation_times;
+    vector<glm::quat> rotation_values;
+    vector<float> scale_times;
+    vector<glm::vec3> scale_values;
+
     // constructors
     bone(const string& name, int id, const aiNodeAnim* channel):// aiNodeAnim is the animation data for a bone
         name(name),
-        id(id),
-        local_transform(1.0f)
+        id(id)
     {
-
         // POSITION
-        positions_size = channel->mNumPositionKeys;
-        for (int pos_i = 0; pos_i < positions_size; ++pos_i) {
+        position_times.reserve(channel->mNumPositionKeys);
+        position_values.reserve(channel->mNumPositionKeys);
+        for (unsigned int pos_i = 0; pos_i < channel->mNumPositionKeys; ++pos_i) {
             aiVector3D ai_pos = channel->mPositionKeys[pos_i].mValue;
-            float time_stamp = (float)channel->mPositionKeys[pos_i].mTime;
-            key_position data = {vec3(ai_pos.x, ai_pos.y, ai_pos.z), time_stamp};
-            positions.push_back(data);
+            position_times.push_back((float)channel->mPositionKeys[pos_i].mTime);
+            position_values.push_back(glm::vec3(ai_pos.x, ai_pos.y, ai_pos.z));
         }
 
         // ROTATION
-        rotations_size = channel->mNumRotationKeys;
-        for (int rot_i = 0; rot_i < rotations_size; ++rot_i) {
+        rotation_times.reserve(channel->mNumRotationKeys);
+        rotation_values.reserve(channel->mNumRotationKeys);
+        for (unsigned int rot_i = 0; rot_i < channel->mNumRotationKeys; ++rot_i) {
             aiQuaternion ai_rot = channel->mRotationKeys[rot_i].mValue;
-            float time_stamp = (float)channel->mRotationKeys[rot_i].mTime;
-            key_rotation data = {quaternion(ai_rot.w, ai_rot.x, ai_rot.y, ai_rot.z), time_stamp};
-            rotations.push_back(data);
+            rotation_times.push_back((float)channel->mRotationKeys[rot_i].mTime);
+            rotation_values.push_back(glm::quat(ai_rot.w, ai_rot.x, ai_rot.y, ai_rot.z));
         }
 
         // SCALE
-        scales_size = channel->mNumScalingKeys;
-        for (int scale_i = 0; scale_i < scales_size; ++scale_i) {
+        scale_times.reserve(channel->mNumScalingKeys);
+        scale_values.reserve(channel->mNumScalingKeys);
+        for (unsigned int scale_i = 0; scale_i < channel->mNumScalingKeys; ++scale_i) {
             aiVector3D ai_scale = channel->mScalingKeys[scale_i].mValue;
-            float time_stamp = (float)channel->mScalingKeys[scale_i].mTime;
-            key_scale data = {vec3(ai_scale.x, ai_scale.y, ai_scale.z), time_stamp};
-            scales.push_back(data);
+            scale_times.push_back((float)channel->mScalingKeys[scale_i].mTime);
+            scale_values.push_back(glm::vec3(ai_scale.x, ai_scale.y, ai_scale.z));
         }
     }
-    // METHODS
-
-    //// Helper Functions and Trunks
-
-    inline void update(float animation_time) {
-        // This function updates the whole bone transform.  Acts as a call trunk.
-        matrix4x4 translation = interpolate_position(animation_time);
-        matrix4x4 rotation = interpolate_rotation(animation_time);
-        matrix4x4 scale = interpolate_scale(animation_time);
-        local_transform = translation * rotation * scale;
-    }
-
-    inline int get_position_index(float animation_time) {
-        // itterates all positions untill it finds a keyframe with a higher timestamp than the current time
-        for (int i = 0; i < positions_size - 1; ++i) {
-            if (animation_time < positions[i + 1].time_stamp)
-                return i;
+    // from keyframes that were already read, used by cooked models.
+    bone(const string& name, int id, const vector<key_position>& positions, const vector<key_rotation>& rotations, const vector<key_scale>& scales):
+        name(name),
+        id(id)
+    {
+        for (const auto& key : positions) {
+            position_times.push_back(key.time_stamp);
+            position_values.push_back(key.position.axis);
+        }
+        for (const auto& key : rotations) {
+            rotation_times.push_back(key.time_stamp);
+            rotation_values.push_back(key.orientation.quat);
+        }
+        for (const auto& key : scales) {
+            scale_times.push_back(key.time_stamp);
+            scale_values.push_back(key.scale.axis);
         }
-        return positions_size-2;
     }
 
-    inline int get_rotation_index(float animation_time) {
-        // itterates all rotations untill it finds a keyframe with a higher timestamp than the current time
-        for (int i = 0; i < rotations_size - 1; ++i) {
-            if (animation_time < rotations[i + 1].time_stamp)
-                return i;
-        }
-        return rotations_size-2;
+    // METHODS
+
+    // the bone's local transform at animation_time.  cursor belongs to the playing animation
+    // instance, so any number of them can sample the same bone.
+    inline glm::mat4 sample(float animation_time, bone_cursor& cursor) const {
+        glm::mat4 ret = glm::translate(glm::mat4(1.0f), interpolate(position_times, position_values, animation_time, cursor.position));
+        ret *= glm::mat4_cast(glm::normalize(interpolate_rotation(animation_time, cursor.rotation)));
+        return glm::scale(ret, interpolate(scale_times, scale_values, animation_time, cursor.scale));
     }
 
-    inline int get_scale_index(float animation_time) {
-        // itterates all scales untill it finds a keyframe with a higher timestamp than the current time
-        for (int i = 0; i < scales_size - 1; ++i) {
-            if (animation_time < scales[i + 1].time_stamp)
-                return i;
+    // the key the interval around animation_time starts at, clamped to [0, size - 2].
+    // Forward playback moves the cursor along a key or two, seeks and loops fall back to a binary search.
+    static inline uint32_t find_key(const vector<float>& times, float animation_time, uint32_t& cursor) {
+        uint32_t last = static_cast<uint32_t>(times.size()) - 2;
+        uint32_t key = std::min(cursor, last);
+        if (animation_time >= times[key]) {
+            for (int step = 0; step < 4; step++) {
+                if (key == last || animation_time < times[key + 1])
+                    return cursor = key;
+                key++;
+            }
         }
-        return scales_size-2;
+        auto next = std::upper_bound(times.begin() + 1, times.end() - 1, animation_time);
+        return cursor = static_cast<uint32_t>(next - times.begin()) - 1;
     }
 
 private:
     // THE MEAT
 
-    inline float get_scale_factor(float prev_time_stamp, float next_time_stamp, float animation_time) {
+    static inline float get_scale_factor(float prev_time_stamp, float next_time_stamp, float animation_time) {
         // returns the time to reach the next frame as a ratio between 0.0 and 1.0
-        float scale_factor = 0.0f;
         float mid_way_len = animation_time - prev_time_stamp;// this is how far it has traveled between prev and next
         float transition_len = next_time_stamp - prev_time_stamp;
-        scale_factor = mid_way_len / transition_len;// creates a ratio ie: interpolates the distance to the next keyframe between 0.0 and 1.0
-        return scale_factor;
+        return mid_way_len / transition_len;// creates a ratio ie: interpolates the distance to the next keyframe between 0.0 and 1.0
     }
 
-    inline matrix4x4 interpolate_position(float animation_time) {
-        // interpolates the position between the prev and next keyframe position
-        if (positions_size == 1)
-            return matrix4x4(1.0f).translate(positions[0].position);
-        
-        int pos_0_i = get_position_index(animation_time);
-        int pos_1_i = pos_0_i + 1;
-        float scale_factor = get_scale_factor(positions[pos_0_i].time_stamp, positions[pos_1_i].time_stamp, animation_time);
-        vec3 final_position = positions[pos_0_i].position.lerp(positions[pos_1_i].position, scale_factor);
-        return matrix4x4(1.0f).translate(final_position);
+    static inline glm::vec3 interpolate(const vector<float>& times, const vector<glm::vec3>& values, float animation_time, uint32_t& cursor) {
+        if (values.size() <= 1)
+            return values.empty() ? glm::vec3(0.0f) : values[0];
+        uint32_t key = find_key(times, animation_time, cursor);
+        float scale_factor = get_scale_factor(times[key], times[key + 1], animation_time);
+        return glm::mix(values[key], values[key + 1], scale_factor);
     }
 
-    inline matrix4x4 interpolate_rotation(float animation_time) {
-        // interpolates the rotation between the prev and next keyframe rotation
-        if (rotations_size == 1) {
-            auto rot = rotations[0].orientation.get_normalized();
-            return matrix4x4(rot);
-        }
-
-        int rot_0_i = get_rotation_index(animation_time);
-        int rot_1_i = rot_0_i + 1;
-        float scale_factor = get_scale_factor(rotations[rot_0_i].time_stamp, rotations[rot_1_i].time_stamp, animation_time);
-        quaternion final_rot = rotations[rot_0_i].orientation.slerp(rotations[rot_1_i].orientation, scale_factor);
-        final_rot = final_rot.get_normalized();
-        return matrix4x4(final_rot);
-    }
-
-    inline matrix4x4 interpolate_scale(float animation_time) {
-        // interpolates the scale between the prev and next keyframe scale
-        if (scales_size == 1)
-            return matrix4x4(1.0f).scale(scales[0].scale);
-
-        int pos_0_i = get_scale_index(animation_time);
-        int pos_1_i = pos_0_i + 1;
-        float scale_factor = get_scale_factor(scales[pos_0_i].time_stamp, scales[pos_1_i].time_stamp, animation_time);
-        vec3 final_scale = scales[pos_0_i].scale.lerp(scales[pos_1_i].scale, scale_factor);
-        return matrix4x4(1.0f).scale(final_scale);
+    inline glm::quat interpolate_rotation(float animation_time, uint32_t& cursor) const {
+        if (rotation_values.size() <= 1)
+            return rotation_values.empty() ? glm::quat(1.0f, 0.0f, 0.0f, 0.0f) : rotation_values[0];
+        uint32_t key = find_key(rotation_times, animation_time, cursor);
+        float scale_factor = get_scale_factor(rotation_times[key], rotation_times[key + 1], animation_time);
+        return glm::slerp(rotation_values[key], rotation_values[key + 1], scale_factor);
     }
-
 };
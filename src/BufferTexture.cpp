@@ -0,0 +1,35 @@
+#include "BufferTexture.h"
+#include <algorithm>
+
+buffer_texture::buffer_texture(GLenum internal_format) : internal_format(internal_format) {
+    glGenBuffers(1, &this->gl_buffer);
+    glGenTextures(1, &this->gl_texture);
+    // a texture buffer needs a data store before it can be sampled.
+    this->update(nullptr, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, this->gl_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, this->internal_format, this->gl_buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+buffer_texture::~buffer_texture() {
+    if (this->gl_texture)
+        glDeleteTextures(1, &this->gl_texture);
+    if (this->gl_buffer)
+        glDeleteBuffers(1, &this->gl_buffer);
+}
+
+void buffer_texture::update(const void* data, size_t size) {
+    glBindBuffer(GL_TEXTURE_BUFFER, this->gl_buffer);
+    if (size > this->capacity || this->capacity == 0)
+        this->capacity = std::max({size, this->capacity * 2, static_cast<size_t>(256)});
+    // orphan the old storage so the driver does not stall on the previous frame.
+    glBufferData(GL_TEXTURE_BUFFER, this->capacity, nullptr, GL_STREAM_DRAW);
+    if (size)
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void buffer_texture::bind(GLenum texture_unit) {
+    glActiveTexture(texture_unit);
+    glBindTexture(GL_TEXTURE_BUFFER, this->gl_texture);
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "glad/gl.h"
+#include <cstddef>
+
+// A buffer object exposed to shaders as a samplerBuffer / usamplerBuffer.
+class buffer_texture {
+public:
+    buffer_texture(){}
+    buffer_texture(GLenum internal_format);
+    ~buffer_texture();
+
+    // replaces the contents, the storage only grows.
+    void update(const void* data, size_t size);
+    void bind(GLenum texture_unit);
+
+    GLuint gl_buffer = 0;
+    GLuint gl_texture = 0;
+    GLenum internal_format = GL_RGBA32F;
+    size_t capacity = 0;
+};
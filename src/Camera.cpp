@@ -16,11 +16,13 @@ camera::camera(vec3* position, quaternion* rotation, int view_width, int view_he
     this->view_height = view_height;
     this->focal_length = focal_length;
     this->fov = fov;
-    this->projection = glm::perspective(this->fov, static_cast<float>(this->view_width)/static_cast<float>(this->view_height), 0.1f, static_cast<float>(this->focal_length));
+    this->projection = glm::perspective(this->fov, static_cast<float>(this->view_width)/static_cast<float>(this->view_height), this->near_plane, static_cast<float>(this->focal_length));
     this->view = glm::lookAt(this->position->axis, this->position->axis + this->rotation->get_forward().axis, this->rotation->get_up().axis);
+    this->view_frustum.extract(this->projection.mat * this->view.mat);
 }
 
 void camera::recalculate_pv() {
-    this->projection = glm::perspective(this->fov, static_cast<float>(this->view_width)/static_cast<float>(this->view_height), 0.1f, static_cast<float>(this->focal_length));
+    this->projection = glm::perspective(this->fov, static_cast<float>(this->view_width)/static_cast<float>(this->view_height), this->near_plane, static_cast<float>(this->focal_length));
     this->view = glm::lookAt(this->position->axis, this->position->axis + this->rotation->get_forward().axis, this->rotation->get_up().axis);
+    this->view_frustum.extract(this->projection.mat * this->view.mat);
 }
\ No newline at end of file
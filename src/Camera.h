@@ -8,6 +8,7 @@
 #include "Quaternion.h"
 #include "Vec3.h"
 #include "Matrix.h"
+#include "Frustum.h"
 
 using std::vector;
 using std::unordered_set;
@@ -24,8 +25,12 @@ public:
     int view_width, view_height;
     float focal_length;
     float fov;
+    // near clip distance of projection, the light clusters slice depth from it as well.
+    float near_plane = 0.1f;
     void recalculate_pv();
     matrix4x4 projection, view;
+    // planes of projection * view, refreshed by recalculate_pv.
+    frustum view_frustum;
     double * deltatime;
     long long * time_ns;
     long long * time;
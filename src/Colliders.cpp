@@ -26,6 +26,37 @@ void collider::cleanup() {
     }
 }
 
+const matrix4x4& collider::get_world_matrix() {
+    size_t owner_version = this->owner ? this->owner->transform_version : 0;
+    glm::vec3 off = this->offset ? this->offset->axis : glm::vec3(0.0f);
+    glm::quat rot = this->rotation ? this->rotation->quat : glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scl = this->scale ? this->scale->axis : glm::vec3(1.0f);
+    if (this->world_cached && this->owner == this->cached_owner && owner_version == this->cached_owner_version
+            && off == this->cached_offset && rot == this->cached_rotation && scl == this->cached_scale)
+        return this->world_matrix;
+
+    glm::mat4 world = this->owner ? this->owner->model_matrix.mat : glm::mat4(1.0f);
+    world = glm::translate(world, off) * glm::toMat4(rot);
+    this->world_matrix = glm::scale(world, scl);
+    this->cached_owner = this->owner;
+    this->cached_owner_version = owner_version;
+    this->cached_offset = off;
+    this->cached_rotation = rot;
+    this->cached_scale = scl;
+    this->world_cached = true;
+    this->inverse_cached = false;
+    return this->world_matrix;
+}
+
+const matrix4x4& collider::get_inverse_world_matrix() {
+    this->get_world_matrix();
+    if (!this->inverse_cached) {
+        this->inverse_world_matrix = this->world_matrix.inverse();
+        this->inverse_cached = true;
+    }
+    return this->inverse_world_matrix;
+}
+
 void collider_box::cleanup() {
         
     if (shader_program) {
@@ -71,7 +102,7 @@ collider_box::collider_box(object3d* owner, vec3* offset, quaternion* rotation,
     this->owner = owner;
     vec3 box_max = vec3(0,0,0);
     vec3 box_min = vec3(0,0,0);
-    collider_box::mutate_max_min(this->owner->model_data->data->mesh_data->data, &box_max, &box_min);
+    collider_box::mutate_max_min(this->owner->model_data->data->get_draw_list(), &box_max, &box_min);
     this->upper_bounds = box_max;
     this->lower_bounds = box_min;
     this->bounds[0] = upper_bounds;
@@ -88,29 +119,15 @@ collider_box::collider_box(object3d* owner, vec3* offset, quaternion* rotation,
     dbg_create_shader_program();
 }
 
-void collider_box::mutate_max_min(mesh_dict* m_d, vec3* aabb_max, vec3* aabb_min) {
-    for (auto [_, m] : *m_d) {
-        if (std::holds_alternative<rc_mesh>(m)) {
-            auto msh = std::get<rc_mesh>(m);
-            aabb_max->axis.x = std::max(aabb_max->axis.x, msh->data->aabb_max.axis.x);
-            aabb_max->axis.y = std::max(aabb_max->axis.y, msh->data->aabb_max.axis.y);
-            aabb_max->axis.z = std::max(aabb_max->axis.z, msh->data->aabb_max.axis.z);
-
-            aabb_min->axis.x = std::min(aabb_min->axis.x, msh->data->aabb_min.axis.x);
-            aabb_min->axis.y = std::min(aabb_min->axis.y, msh->data->aabb_min.axis.y);
-            aabb_min->axis.z = std::min(aabb_min->axis.z, msh->data->aabb_min.axis.z);
-        } else {
-            auto msh = std::get<rc_mesh_dict>(m);
-            collider_box::mutate_max_min(msh->data, aabb_max, aabb_min);
-        }
+void collider_box::mutate_max_min(const vector<mesh_draw_record>& draw_list, vec3* aabb_max, vec3* aabb_min) {
+    for (const mesh_draw_record& record : draw_list) {
+        aabb_max->axis = glm::max(aabb_max->axis, record.aabb_max);
+        aabb_min->axis = glm::min(aabb_min->axis, record.aabb_min);
     }
 }
 
 bool collider_box::check_collision(vec3 intersection) {
-    auto this_mat = ((this->owner ? this->owner->model_matrix : matrix4x4(1.0f)).translate(this->offset) * matrix4x4(this->rotation)).scale(this->scale);
-
-
-    intersection = (vec3(this_mat.inverse() * vec4(intersection.axis, 1.0)) - *offset);
+    intersection = (vec3(this->get_inverse_world_matrix() * vec4(intersection.axis, 1.0)) - *offset);
     return upper_bounds >= intersection && lower_bounds <= intersection;
 }
 
@@ -126,8 +143,8 @@ bool collider_box::check_collision(collider* other) {
 }
 
 bool collider_box::check_collision(collider_box* other) {
-    auto this_mat = ((this->owner ? this->owner->model_matrix : matrix4x4(1.0f)).translate(this->offset) * matrix4x4(this->rotation)).scale(this->scale);
-    auto other_mat = ((other->owner ? other->owner->model_matrix : matrix4x4(1.0f)).translate(other->offset) * matrix4x4(other->rotation)).scale(other->scale);
+    const matrix4x4& this_mat = this->get_world_matrix();
+    const matrix4x4& other_mat = other->get_world_matrix();
 
     vec3 dirs_this[3] = {
         this_mat[0],
@@ -158,7 +175,7 @@ bool collider_box::check_collision(collider_box* other) {
 }
 
 bool collider_box::check_collision(collider_convex* other) {
-    auto this_mat = ((this->owner ? this->owner->model_matrix : matrix4x4(1.0f)).translate(this->offset) * matrix4x4(this->rotation)).scale(this->scale);
+    const matrix4x4& this_mat = this->get_world_matrix();
     
     vec3 dirs_this[3] = {
         this_mat[0],
@@ -297,7 +314,7 @@ void collider_box::dbg_create_shader_program() {
 
 void collider_box::dbg_render(const camera& cam) {
     if (show_collider) {
-        auto this_mat = ((this->owner ? this->owner->model_matrix : matrix4x4(1.0f)).translate(this->offset) * matrix4x4(this->rotation)).scale(this->scale);
+        const matrix4x4& this_mat = this->get_world_matrix();
         glDepthMask(GL_FALSE); 
         // Use shader program
         glUseProgram(shader_program); 
@@ -332,7 +349,7 @@ std::pair<float, float> collider::minmax_vertex_SAT(const vec3 & axis) {
 
 
 std::pair<float, float> collider_box::minmax_vertex_SAT(const vec3 & axis) {
-    auto this_mat = ((this->owner ? this->owner->model_matrix : matrix4x4(1.0f)).translate(this->offset) * matrix4x4(this->rotation)).scale(this->scale);
+    const matrix4x4& this_mat = this->get_world_matrix();
     float min_proj = (vec3(this_mat * vec4(this->bounds[0], 1.0f))).dot(axis);
     float max_proj = min_proj;
     
@@ -356,7 +373,7 @@ bool collider::check_SAT(vec3 axis, collider *other) {
 collider_convex::collider_convex(object3d* owner, vec3* offset, quaternion* rotation, vec3* scale) {
     this->owner = owner;
     this->offset = offset;
-    generate_hull(this->owner->model_data->data->mesh_data->data->gather_mesh_verticies());
+    generate_hull(this->owner->model_data->data->gather_mesh_verticies());
     render_hull_create_shader_program();
     this->offset = offset;
     this->rotation = rotation;
@@ -364,10 +381,7 @@ collider_convex::collider_convex(object3d* owner, vec3* offset, quaternion* rota
 }
 
 collider_convex::collider_convex(rc_mesh owner, vec3* offset, quaternion* rotation, vec3* scale) {
-    vector<vec3> verts;
-    for (const auto & v : *owner->data->vertices)
-        verts.push_back(v.position);
-    generate_hull(verts);
+    generate_hull(owner->data->get_positions());
     this->offset = offset;
     render_hull_create_shader_program();
     this->offset = offset;
@@ -488,7 +502,7 @@ void collider_convex::render_hull_create_shader_program() {
  
 void collider_convex::dbg_render(const camera& cam) {
     if (show_collider) {
-        auto this_mat = ((this->owner ? this->owner->model_matrix : matrix4x4(1.0f)).translate(this->offset) * matrix4x4(this->rotation)).scale(this->scale);
+        const matrix4x4& this_mat = this->get_world_matrix();
         glDepthMask(GL_FALSE); 
         // Use shader program
         glUseProgram(shader_program); 
@@ -752,8 +766,7 @@ bool hull_face::is_visible(const vec3& point, const matrix3x3 & rot) const {
 // convex collisions:
 
 bool collider_convex::check_collision(vec3 intersection) {
-    auto this_mat = ((this->owner ? this->owner->model_matrix : matrix4x4(1.0f)).translate(this->offset) * matrix4x4(this->rotation)).scale(this->scale);
-    vec3 transformed_point = this_mat.inverse() * vec4(intersection, 1.0f);
+    vec3 transformed_point = this->get_inverse_world_matrix() * vec4(intersection, 1.0f);
     for (const auto& face : hull) {
         if (!face.is_visible(transformed_point - *offset, matrix3x3(this->rotation))) {
             return false;
@@ -773,7 +786,7 @@ bool collider_convex::check_collision(collider* other) {
 }
 
 bool collider_convex::check_collision(collider_box* other) {
-    auto other_mat = ((other->owner ? other->owner->model_matrix : matrix4x4(1.0f)).translate(other->offset) * matrix4x4(other->rotation)).scale(other->scale);
+    const matrix4x4& other_mat = other->get_world_matrix();
     vec3 dirs_other[3] = {
         other_mat[0],
         other_mat[1],
@@ -816,7 +829,7 @@ bool collider_convex::check_collision(collider_convex* other) {
 }
 
 std::pair<float, float> collider_convex::minmax_vertex_SAT(const vec3 & axis) {
-    auto this_mat = ((this->owner ? this->owner->model_matrix : matrix4x4(1.0f)).translate(this->offset) * matrix4x4(this->rotation)).scale(this->scale);
+    const matrix4x4& this_mat = this->get_world_matrix();
     float min_proj = axis.dot(vec3(this_mat * vec4(this->hull[0].vertices[0], 1.0f)));
     float max_proj = min_proj;
 
@@ -904,10 +917,8 @@ ray_hit collider_ray::intersects_box(collider_box* collider) {
     vec3 ray_direction = vec3(0.0f, 0.0f, -1.0f).rotate(*this->direction).get_normalized();
 
     // Build the transformation matrix from world space to local space
-    auto model_matrix = ((collider->owner ? collider->owner->model_matrix : matrix4x4(1.0f)).translate(collider->offset) * matrix4x4(collider->rotation)).scale(collider->scale);
-
-    // Extract the inverse of the model matrix
-    matrix4x4 inv_model_matrix = model_matrix.inverse();
+    const matrix4x4& model_matrix = collider->get_world_matrix();
+    const matrix4x4& inv_model_matrix = collider->get_inverse_world_matrix();
 
     // Transform ray origin and direction to local space
     vec3 local_origin = inv_model_matrix * vec4(ray_origin, 1.0f);
@@ -958,7 +969,7 @@ bool collider_ray::check_collision(collider_box* collider) {
 }
 
 bool collider_ray::check_collision(collider_convex* collider) {
-    auto collider_mat = ((collider->owner ? collider->owner->model_matrix : matrix4x4(1.0f)).translate(collider->offset) * matrix4x4(collider->rotation)).scale(collider->scale);
+    const matrix4x4& collider_mat = collider->get_world_matrix();
     for (const hull_face & h : collider->hull) {
         auto hit = intersects_hullface(collider_mat, h);
         if (hit.hit) return true;
@@ -993,7 +1004,7 @@ ray_hit collider_ray::get_collision(collider_box* collider) {
 }
 
 ray_hit collider_ray::get_collision(collider_convex* collider) {
-    auto collider_mat = ((collider->owner ? collider->owner->model_matrix : matrix4x4(1.0f)).translate(collider->offset) * matrix4x4(collider->rotation)).scale(collider->scale);
+    const matrix4x4& collider_mat = collider->get_world_matrix();
     for (const hull_face & h : collider->hull) {
         auto rh = intersects_hullface(collider_mat, h);
         if (rh.hit) return rh;
@@ -34,6 +34,20 @@ public:
     vec3* scale = nullptr;
     quaternion* rotation = nullptr;
     bool show_collider = false;
+
+    // owner world matrix * offset * rotation * scale, rebuilt only after one of them changed.
+    const matrix4x4& get_world_matrix();
+    const matrix4x4& get_inverse_world_matrix();
+private:
+    matrix4x4 world_matrix = matrix4x4(1.0f);
+    matrix4x4 inverse_world_matrix = matrix4x4(1.0f);
+    const object3d* cached_owner = nullptr;
+    size_t cached_owner_version = 0;
+    glm::vec3 cached_offset = glm::vec3(0.0f);
+    glm::quat cached_rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 cached_scale = glm::vec3(1.0f);
+    bool world_cached = false;
+    bool inverse_cached = false;
 };
 
 class collider_box : public collider {
@@ -76,7 +90,7 @@ public:
     vec3 lower_bounds;
     vec3 bounds[8];
 private:
-    static void mutate_max_min(mesh_dict* m, vec3* aabb_max, vec3* aabb_min);
+    static void mutate_max_min(const vector<mesh_draw_record>& draw_list, vec3* aabb_max, vec3* aabb_min);
     void dbg_create_shader_program();
 
     unsigned int shader_program;
@@ -0,0 +1,688 @@
+#include "CookedModel.h"
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <type_traits>
+#include "Model.h"
+#include "Animation.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// vertex and index arrays start on this boundary, the mapping itself is page aligned.
+static constexpr size_t cooked_alignment = 16;
+
+enum cooked_child_kind : uint8_t {
+    COOKED_MESH = 0,
+    COOKED_MESH_DICT = 1
+};
+
+mapped_file::mapped_file(const string& file_path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Failed to open \"" + file_path + "\".\n");
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        throw std::runtime_error("Failed to map \"" + file_path + "\", it is empty or unreadable.\n");
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view) {
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Failed to map \"" + file_path + "\".\n");
+    }
+    this->file_handle = file;
+    this->mapping_handle = mapping;
+    this->length = static_cast<size_t>(file_size.QuadPart);
+    this->bytes = static_cast<const unsigned char*>(view);
+#else
+    int fd = open(file_path.c_str(), O_RDONLY);
+    if (fd == -1)
+        throw std::runtime_error("Failed to open \"" + file_path + "\".\n");
+    struct stat info;
+    if (fstat(fd, &info) == -1 || info.st_size == 0) {
+        close(fd);
+        throw std::runtime_error("Failed to map \"" + file_path + "\", it is empty or unreadable.\n");
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Failed to map \"" + file_path + "\".\n");
+    }
+    this->descriptor = fd;
+    this->length = static_cast<size_t>(info.st_size);
+    this->bytes = static_cast<const unsigned char*>(view);
+#endif
+}
+
+mapped_file::~mapped_file() {
+#ifdef _WIN32
+    UnmapViewOfFile(this->bytes);
+    CloseHandle(this->mapping_handle);
+    CloseHandle(this->file_handle);
+#else
+    munmap(const_cast<unsigned char*>(this->bytes), this->length);
+    close(this->descriptor);
+#endif
+}
+
+namespace {
+
+class cooked_writer {
+public:
+    cooked_writer(const string& file_path) : out(file_path, std::ios::binary | std::ios::trunc), file_path(file_path) {
+        if (!out)
+            throw std::runtime_error("Failed to open \"" + file_path + "\" for writing.\n");
+    }
+
+    inline void bytes(const void* data, size_t size) {
+        out.write(static_cast<const char*>(data), size);
+        offset += size;
+    }
+
+    template<typename T>
+    inline void value(const T& v) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        bytes(&v, sizeof(T));
+    }
+
+    inline void text(const string& s) {
+        value<uint32_t>(static_cast<uint32_t>(s.size()));
+        bytes(s.data(), s.size());
+    }
+
+    inline void vector3(const vec3& v) {
+        value(v.axis.x);
+        value(v.axis.y);
+        value(v.axis.z);
+    }
+
+    inline void matrix(const matrix4x4& m) {
+        for (int c = 0; c < 4; c++)
+            for (int r = 0; r < 4; r++)
+                value(m.mat[c][r]);
+    }
+
+    inline void align() {
+        static const char zeros[cooked_alignment] = {};
+        bytes(zeros, (cooked_alignment - offset % cooked_alignment) % cooked_alignment);
+    }
+
+    inline void finish() {
+        out.close();
+        if (out.fail())
+            throw std::runtime_error("Failed to write \"" + file_path + "\".\n");
+    }
+private:
+    std::ofstream out;
+    string file_path;
+    size_t offset = 0;
+};
+
+class cooked_reader {
+public:
+    cooked_reader(const mapped_file& file, const string& file_path)
+    : begin(file.data()), cursor(file.data()), end(file.data() + file.size()), file_path(file_path) {}
+
+    [[noreturn]] inline void fail(const string& why) {
+        throw std::runtime_error("Cooked model \"" + file_path + "\" " + why + ".\n");
+    }
+
+    inline const unsigned char* bytes(size_t size) {
+        if (size > static_cast<size_t>(end - cursor))
+            fail("is truncated");
+        const unsigned char* ret = cursor;
+        cursor += size;
+        return ret;
+    }
+
+    template<typename T>
+    inline T value() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T ret;
+        std::memcpy(&ret, bytes(sizeof(T)), sizeof(T));
+        return ret;
+    }
+
+    // an element count, rejected early when the rest of the file could not hold that many items.
+    inline size_t count(size_t min_item_size) {
+        size_t ret = value<uint32_t>();
+        if (ret * min_item_size > static_cast<size_t>(end - cursor))
+            fail("is truncated");
+        return ret;
+    }
+
+    inline string text() {
+        size_t size = count(1);
+        return string(reinterpret_cast<const char*>(bytes(size)), size);
+    }
+
+    inline vec3 vector3() {
+        float x = value<float>(), y = value<float>(), z = value<float>();
+        return vec3(x, y, z);
+    }
+
+    inline matrix4x4 matrix() {
+        matrix4x4 ret(1.0f);
+        for (int c = 0; c < 4; c++)
+            for (int r = 0; r < 4; r++)
+                ret.mat[c][r] = value<float>();
+        return ret;
+    }
+
+    inline void align() {
+        bytes((cooked_alignment - static_cast<size_t>(cursor - begin) % cooked_alignment) % cooked_alignment);
+    }
+private:
+    const unsigned char* begin;
+    const unsigned char* cursor;
+    const unsigned char* end;
+    string file_path;
+};
+
+// meshes and materials in the order the tree is walked, which is the order they are stored in.
+struct cooked_tables {
+    vector<mesh*> meshes;
+    vector<material*> materials;
+    std::map<mesh*, uint32_t> mesh_ids;
+    std::map<material*, uint32_t> material_ids;
+};
+
+void gather_tables(mesh_dict* dict, cooked_tables& tables) {
+    for (const auto& [key, child] : dict->data) {
+        if (auto msh = std::get_if<rc_mesh>(&child)) {
+            if (!*msh || tables.mesh_ids.contains((*msh)->data))
+                continue;
+            tables.mesh_ids[(*msh)->data] = static_cast<uint32_t>(tables.meshes.size());
+            tables.meshes.push_back((*msh)->data);
+            material* mat = (*msh)->data->mesh_material->data;
+            if (!tables.material_ids.contains(mat)) {
+                tables.material_ids[mat] = static_cast<uint32_t>(tables.materials.size());
+                tables.materials.push_back(mat);
+            }
+        } else if (auto sub_dict = std::get_if<rc_mesh_dict>(&child)) {
+            if (*sub_dict)
+                gather_tables((*sub_dict)->data, tables);
+        }
+    }
+}
+
+void write_tree(cooked_writer& out, mesh_dict* dict, const cooked_tables& tables) {
+    out.text(dict->name);
+    uint32_t children = 0;
+    for (const auto& [key, child] : dict->data)
+        std::visit([&](auto rc) { children += rc != nullptr; }, child);
+    out.value(children);
+    for (const auto& [key, child] : dict->data) {
+        if (auto msh = std::get_if<rc_mesh>(&child)) {
+            if (!*msh)
+                continue;
+            out.value(COOKED_MESH);
+            out.text(key);
+            out.value(tables.mesh_ids.at((*msh)->data));
+        } else if (auto sub_dict = std::get_if<rc_mesh_dict>(&child)) {
+            if (!*sub_dict)
+                continue;
+            out.value(COOKED_MESH_DICT);
+            out.text(key);
+            write_tree(out, (*sub_dict)->data, tables);
+        }
+    }
+}
+
+// frees an object and its counter whatever the count, RC itself leaves data alone.
+template<typename T>
+void delete_rc(RC<T*>* rc) {
+    delete rc->data;
+    delete rc;
+}
+
+// frees dict and the dicts below it but not their meshes, which belong to the reader's mesh table.
+void delete_dicts(rc_mesh_dict dict) {
+    for (auto& [key, child] : dict->data->data)
+        if (auto sub_dict = std::get_if<rc_mesh_dict>(&child); sub_dict && *sub_dict)
+            delete_dicts(*sub_dict);
+    delete_rc(dict);
+}
+
+rc_mesh_dict read_tree(cooked_reader& in, const vector<rc_mesh>& meshes, vector<bool>& placed) {
+    auto dict = new RC(new mesh_dict());
+    try {
+        dict->data->name = in.text();
+        size_t children = in.count(sizeof(uint8_t) + sizeof(uint32_t));
+        for (size_t i = 0; i < children; i++) {
+            auto kind = in.value<uint8_t>();
+            string key = in.text();
+            if (kind == COOKED_MESH) {
+                uint32_t id = in.value<uint32_t>();
+                if (id >= meshes.size())
+                    in.fail("references a mesh it does not hold");
+                // a mesh shared between nodes holds one reference per node.
+                if (placed[id])
+                    meshes[id]->inc();
+                placed[id] = true;
+                dict->data->data.insert_or_assign(key, meshes[id]);
+            } else if (kind == COOKED_MESH_DICT) {
+                dict->data->data.insert_or_assign(key, read_tree(in, meshes, placed));
+            } else {
+                in.fail("has an unknown node kind");
+            }
+        }
+    } catch (...) {
+        delete_dicts(dict);
+        throw;
+    }
+    return dict;
+}
+
+void write_node(cooked_writer& out, const assimp_node_data& node) {
+    out.text(node.name);
+    out.matrix(node.transformation);
+    out.value(static_cast<uint32_t>(node.children.size()));
+    for (const auto& child : node.children)
+        write_node(out, child);
+}
+
+void read_node(cooked_reader& in, assimp_node_data& node) {
+    node.name = in.text();
+    node.transformation = in.matrix();
+    node.children.resize(in.count(sizeof(uint32_t) * 2 + sizeof(float) * 16));
+    node.children_size = static_cast<int>(node.children.size());
+    for (auto& child : node.children)
+        read_node(in, child);
+}
+
+void write_bone_infos(cooked_writer& out, const vector<bone_info>& infos) {
+    out.value(static_cast<uint32_t>(infos.size()));
+    for (const auto& info : infos) {
+        out.text(info.name);
+        out.value(static_cast<int32_t>(info.id));
+        out.matrix(info.offset);
+    }
+}
+
+vector<bone_info> read_bone_infos(cooked_reader& in) {
+    vector<bone_info> ret(in.count(sizeof(uint32_t) * 2 + sizeof(float) * 16));
+    for (auto& info : ret) {
+        info.name = in.text();
+        info.id = in.value<int32_t>();
+        info.offset = in.matrix();
+    }
+    return ret;
+}
+
+// frees a model nothing else references, its meshes were never uploaded.
+void release_imported(rc_model model) {
+    std::function<void(rc_mesh_dict)> release_dict = [&](rc_mesh_dict dict) {
+        for (auto& [key, child] : dict->data->data) {
+            if (auto msh = std::get_if<rc_mesh>(&child)) {
+                if (!*msh)
+                    continue;
+                RC_collect((*msh)->data->mesh_material);
+                RC_collect(*msh);
+            } else if (auto sub_dict = std::get_if<rc_mesh_dict>(&child)) {
+                if (*sub_dict)
+                    release_dict(*sub_dict);
+            }
+        }
+        RC_collect(dict);
+    };
+    release_dict(model->data->mesh_data);
+    RC_collect(model);
+}
+
+// frees what a failed read built.  Nothing outside the reader references any of it yet, so every
+// object goes exactly once whatever its reference count says.
+void release_partial_read(rc_model model, rc_mesh_dict root, vector<rc_material>& materials, vector<rc_mesh>& meshes) {
+    if (model)
+        delete_rc(model);
+    if (root)
+        delete_dicts(root);
+    for (rc_mesh msh : meshes)
+        if (msh)
+            delete_rc(msh);
+    for (rc_material mat : materials)
+        if (mat)
+            delete_rc(mat);
+}
+
+} // namespace
+
+string cooked_model::path_for(const string& file_path) {
+    return file_path + ".cooked";
+}
+
+bool cooked_model::is_fresh(const string& file_path, const string& cooked_path) {
+    std::error_code err;
+    auto cooked_time = fs::last_write_time(cooked_path, err);
+    if (err)
+        return false;
+    // shipping only the cooked file is fine.
+    auto source_time = fs::last_write_time(file_path, err);
+    return err || cooked_time >= source_time;
+}
+
+string cooked_model::cook(const string& file_path, const string& cooked_path) {
+    string output = cooked_path.empty() ? path_for(file_path) : cooked_path;
+    // the GL work is never run, nothing here touches the context.
+    gl_task_list gl_tasks;
+    rc_model model = mesh::import_file(file_path, false, gl_tasks, false);
+    gl_tasks.clear();
+    try {
+        write(model, output);
+    } catch (...) {
+        release_imported(model);
+        throw;
+    }
+    release_imported(model);
+    return output;
+}
+
+void cooked_model::write(rc_model model, const string& cooked_path) {
+    cooked_tables tables;
+    gather_tables(model->data->mesh_data->data, tables);
+
+    // written next to the target and renamed, so a crash never leaves a half file that looks fresh.
+    string partial_path = cooked_path + ".partial";
+    {
+        cooked_writer out(partial_path);
+        out.value(magic);
+        out.value(version);
+        out.value(static_cast<uint32_t>(sizeof(vertex)));
+        out.value(static_cast<uint32_t>(model->data->animated));
+
+        out.value(static_cast<uint32_t>(tables.materials.size()));
+        for (material* mat : tables.materials) {
+            out.text(mat->name);
+            out.vector3(mat->ambient);
+            out.vector3(mat->diffuse);
+            out.vector3(mat->specular);
+            out.value(mat->shine);
+            out.text(mat->diffuse_file);
+            out.text(mat->specular_file);
+            out.text(mat->normals_file);
+        }
+
+        out.value(static_cast<uint32_t>(tables.meshes.size()));
+        for (mesh* msh : tables.meshes) {
+            if (!msh->vertices || !msh->faces)
+                throw std::runtime_error("Mesh \"" + msh->name + "\" discarded its geometry, only models kept with GeometryResidency::KEEP can be cooked.\n");
+            out.text(msh->name);
+            out.value(tables.material_ids.at(msh->mesh_material->data));
+            out.value(static_cast<uint32_t>(msh->is_animated));
+            out.vector3(msh->transform);
+            out.value(msh->radius);
+            out.vector3(msh->aabb_min);
+            out.vector3(msh->aabb_max);
+            out.value(static_cast<uint32_t>(msh->layout));
+            out.value(static_cast<uint32_t>(msh->index_type));
+            out.value(static_cast<uint64_t>(msh->vertices->size()));
+            out.value(static_cast<uint64_t>(msh->index_stream_count()));
+            out.value(static_cast<uint32_t>(msh->lods.size()));
+            for (const mesh_lod& lod : msh->lods) {
+                out.value(lod.first_index);
+                out.value(lod.index_count);
+                out.value(lod.error);
+            }
+            out.align();
+            out.bytes(msh->vertices->data(), msh->vertices->size() * sizeof(vertex));
+            // the VBO contents, the full layout uploads the vertices above.
+            if (msh->layout != VertexLayout::FULL) {
+                out.align();
+                vector<unsigned char> gpu_vertices = pack_vertices(msh->layout, msh->vertices->data(), msh->vertices->size());
+                out.bytes(gpu_vertices.data(), gpu_vertices.size());
+            }
+            out.align();
+            auto gpu_indices = msh->pack_index_stream();
+            if (gpu_indices)
+                out.bytes(gpu_indices->data(), gpu_indices->size());
+            else
+                out.bytes(msh->face_indices(), msh->faces->size() * 3 * sizeof(GLuint));
+        }
+
+        write_tree(out, model->data->mesh_data->data, tables);
+
+        out.value(static_cast<int32_t>(model->data->bone_counter));
+        write_bone_infos(out, model->data->bone_info_list);
+
+        out.value(static_cast<uint32_t>(model->data->animations.size()));
+        for (const auto& [name, anim] : model->data->animations) {
+            out.text(name);
+            out.value(anim->duration);
+            out.value(anim->ticks_per_second);
+            write_node(out, *anim->get_assimp_animation_tree());
+            write_bone_infos(out, anim->bone_info_list);
+            out.value(static_cast<uint32_t>(anim->bones.size()));
+            for (const bone& b : anim->bones) {
+                out.text(b.name);
+                out.value(static_cast<int32_t>(b.id));
+                out.value(static_cast<uint32_t>(b.position_times.size()));
+                for (size_t k = 0; k < b.position_times.size(); k++) {
+                    out.value(b.position_times[k]);
+                    out.vector3(b.position_values[k]);
+                }
+                out.value(static_cast<uint32_t>(b.rotation_times.size()));
+                for (size_t k = 0; k < b.rotation_times.size(); k++) {
+                    out.value(b.rotation_times[k]);
+                    out.value(b.rotation_values[k].w);
+                    out.value(b.rotation_values[k].x);
+                    out.value(b.rotation_values[k].y);
+                    out.value(b.rotation_values[k].z);
+                }
+                out.value(static_cast<uint32_t>(b.scale_times.size()));
+                for (size_t k = 0; k < b.scale_times.size(); k++) {
+                    out.value(b.scale_times[k]);
+                    out.vector3(b.scale_values[k]);
+                }
+            }
+        }
+        out.finish();
+    }
+    std::error_code err;
+    fs::rename(partial_path, cooked_path, err);
+    if (err) {
+        fs::remove(partial_path, err);
+        throw std::runtime_error("Failed to move the cooked model into \"" + cooked_path + "\".\n");
+    }
+}
+
+rc_model cooked_model::read(const string& file_path, const string& cooked_path, gl_task_list& gl_tasks) {
+    // kept alive by the upload tasks, the buffers go to GL straight from the mapping.
+    auto file = std::make_shared<mapped_file>(cooked_path);
+    cooked_reader in(*file, cooked_path);
+
+    if (in.value<uint32_t>() != magic)
+        in.fail("is not a cooked model");
+    if (in.value<uint32_t>() != version)
+        in.fail("was cooked by another version of Loxoc");
+    if (in.value<uint32_t>() != sizeof(vertex))
+        in.fail("was cooked with another vertex layout");
+    bool animated = in.value<uint32_t>() != 0;
+
+    // everything built so far is freed when the file turns out to be broken part way through.
+    vector<rc_material> materials;
+    vector<rc_mesh> meshes;
+    rc_mesh_dict root = nullptr;
+    rc_model ret = nullptr;
+    try {
+        materials.resize(in.count(sizeof(uint32_t) * 4 + sizeof(float) * 10));
+        for (auto& mat : materials) {
+            mat = new RC(new material(nullptr, nullptr, nullptr, nullptr, false));
+            mat->data->name = in.text();
+            mat->data->ambient = in.vector3();
+            mat->data->diffuse = in.vector3();
+            mat->data->specular = in.vector3();
+            mat->data->shine = in.value<float>();
+            mesh::stage_default_program(mat, animated, gl_tasks);
+            string texture_files[3] = {in.text(), in.text(), in.text()};
+            if (!texture_files[0].empty())
+                mesh::stage_texture(mat, &material::diffuse_texture, &material::diffuse_file, texture_files[0], gl_tasks);
+            if (!texture_files[1].empty())
+                mesh::stage_texture(mat, &material::specular_texture, &material::specular_file, texture_files[1], gl_tasks);
+            if (!texture_files[2].empty())
+                mesh::stage_texture(mat, &material::normals_texture, &material::normals_file, texture_files[2], gl_tasks);
+            mesh::stage_missing_texture(mat, gl_tasks);
+        }
+
+        meshes.resize(in.count(sizeof(uint32_t) * 7 + sizeof(float) * 10 + sizeof(uint64_t) * 2));
+        vector<bool> material_used(materials.size(), false);
+        for (auto& msh : meshes) {
+            string name = in.text();
+            uint32_t material_id = in.value<uint32_t>();
+            if (material_id >= materials.size())
+                in.fail("references a material it does not hold");
+            rc_material mat = materials[material_id];
+            // the first mesh takes over the reference the material was created with.
+            if (material_used[material_id])
+                mat->inc();
+            material_used[material_id] = true;
+            bool is_animated = in.value<uint32_t>() != 0;
+            vec3 transform = in.vector3();
+            float radius = in.value<float>();
+            vec3 aabb_min = in.vector3();
+            vec3 aabb_max = in.vector3();
+            uint32_t layout = in.value<uint32_t>();
+            if (layout > static_cast<uint32_t>(VertexLayout::SKINNED_PACKED))
+                in.fail("holds an unknown vertex layout");
+            GLenum index_type = in.value<uint32_t>();
+            if (index_type != GL_UNSIGNED_SHORT && index_type != GL_UNSIGNED_INT)
+                in.fail("holds an unknown index type");
+            uint64_t vertex_count = in.value<uint64_t>();
+            uint64_t index_count = in.value<uint64_t>();
+            vector<mesh_lod> lods(in.count(sizeof(uint32_t) * 2 + sizeof(float)));
+            for (mesh_lod& lod : lods) {
+                lod.first_index = in.value<uint32_t>();
+                lod.index_count = in.value<uint32_t>();
+                lod.error = in.value<float>();
+            }
+            // the faces come first, then every level back to back.
+            uint64_t face_index_count = lods.empty() ? index_count : lods.front().first_index;
+            uint64_t expected_first = face_index_count;
+            for (const mesh_lod& lod : lods) {
+                if (lod.first_index != expected_first || lod.index_count % 3 != 0)
+                    in.fail("holds a level of detail outside of its mesh's indices");
+                expected_first += lod.index_count;
+            }
+            if (expected_first != index_count || face_index_count % 3 != 0)
+                in.fail("holds a mesh that is not triangulated");
+            in.align();
+            if (vertex_count > SIZE_MAX / sizeof(vertex))
+                in.fail("is truncated");
+            auto vertex_data = reinterpret_cast<const vertex*>(in.bytes(vertex_count * sizeof(vertex)));
+            const void* gpu_data = vertex_data;
+            size_t gpu_bytes = vertex_count * vertex_layout_stride(static_cast<VertexLayout>(layout));
+            if (static_cast<VertexLayout>(layout) != VertexLayout::FULL) {
+                in.align();
+                gpu_data = in.bytes(gpu_bytes);
+            }
+            in.align();
+            if (index_count > SIZE_MAX / sizeof(GLuint))
+                in.fail("is truncated");
+            const unsigned char* index_data = in.bytes(index_count * index_type_size(index_type));
+            auto index_at = [&](size_t i) -> unsigned int {
+                if (index_type == GL_UNSIGNED_SHORT)
+                    return reinterpret_cast<const uint16_t*>(index_data)[i];
+                return reinterpret_cast<const uint32_t*>(index_data)[i];
+            };
+
+            for (size_t i = 0; i < index_count; i++)
+                if (index_at(i) >= vertex_count)
+                    in.fail("holds an index past the end of its mesh");
+            // only the CPU copies the residency policy keeps are built, the GPU ones come from the mapping.
+            GeometryResidency residency = mesh::default_residency;
+            vector<vertex>* vertices = nullptr;
+            vector<tup<unsigned int, 3>>* faces = nullptr;
+            if (residency == GeometryResidency::KEEP) {
+                vertices = new vector<vertex>(vertex_data, vertex_data + vertex_count);
+                faces = new vector<tup<unsigned int, 3>>(face_index_count / 3);
+                for (size_t f = 0; f < faces->size(); f++)
+                    (*faces)[f] = make_tup<unsigned int, 3>({index_at(f * 3), index_at(f * 3 + 1), index_at(f * 3 + 2)});
+            }
+
+            msh = new RC(new mesh(name, mat, vertices, faces, transform, is_animated, false));
+            msh->data->residency = residency;
+            msh->data->lods = std::move(lods);
+            if (residency == GeometryResidency::KEEP && !msh->data->lods.empty()) {
+                msh->data->lod_indices = new vector<uint32_t>(index_count - face_index_count);
+                for (size_t i = face_index_count; i < index_count; i++)
+                    (*msh->data->lod_indices)[i - face_index_count] = index_at(i);
+            }
+            if (residency == GeometryResidency::POSITIONS_ONLY) {
+                msh->data->positions = new vector<glm::vec3>(vertex_count);
+                for (size_t v = 0; v < vertex_count; v++)
+                    (*msh->data->positions)[v] = vertex_data[v].position;
+            }
+            msh->data->radius = radius;
+            msh->data->aabb_min = aabb_min;
+            msh->data->aabb_max = aabb_max;
+            msh->data->layout = static_cast<VertexLayout>(layout);
+            msh->data->index_type = index_type;
+            gl_tasks.push_back([msh, file, gpu_data, gpu_bytes, index_data, index_count]() {
+                msh->data->create_VAO(gpu_data, gpu_bytes, index_data, index_count);
+            });
+        }
+
+        vector<bool> placed(meshes.size(), false);
+        root = read_tree(in, meshes, placed);
+        root->data->name = file_path;
+
+        ret = new RC(new model(root, animated));
+        ret->data->animated = animated;
+        ret->data->bone_counter = in.value<int32_t>();
+        ret->data->bone_info_list = read_bone_infos(in);
+
+        size_t animation_count = in.count(sizeof(uint32_t) * 5);
+        for (size_t a = 0; a < animation_count; a++) {
+            string name = in.text();
+            float duration = in.value<float>();
+            float ticks_per_second = in.value<float>();
+            assimp_node_data tree;
+            read_node(in, tree);
+            vector<bone_info> infos = read_bone_infos(in);
+            vector<bone> bones;
+            size_t bone_count = in.count(sizeof(uint32_t) * 5);
+            bones.reserve(bone_count);
+            for (size_t b = 0; b < bone_count; b++) {
+                string bone_name = in.text();
+                int id = in.value<int32_t>();
+                vector<key_position> positions(in.count(sizeof(float) * 4));
+                for (auto& key : positions) {
+                    key.time_stamp = in.value<float>();
+                    key.position = in.vector3();
+                }
+                vector<key_rotation> rotations(in.count(sizeof(float) * 5));
+                for (auto& key : rotations) {
+                    key.time_stamp = in.value<float>();
+                    float w = in.value<float>(), x = in.value<float>(), y = in.value<float>(), z = in.value<float>();
+                    key.orientation = quaternion(w, x, y, z);
+                }
+                vector<key_scale> scales(in.count(sizeof(float) * 4));
+                for (auto& key : scales) {
+                    key.time_stamp = in.value<float>();
+                    key.scale = in.vector3();
+                }
+                bones.emplace_back(bone_name, id, positions, rotations, scales);
+            }
+            ret->data->animations[name] = new animation(duration, ticks_per_second, std::move(tree), std::move(bones), std::move(infos));
+        }
+    } catch (...) {
+        release_partial_read(ret, root, materials, meshes);
+        throw;
+    }
+    return ret;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "Mesh.h"
+
+using std::string;
+
+// A read only view of a whole file, mapped into the address space.
+class mapped_file {
+public:
+    // throws when the file can not be opened or mapped.
+    mapped_file(const string& file_path);
+    ~mapped_file();
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    inline const unsigned char* data() const { return bytes; }
+    inline size_t size() const { return length; }
+private:
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#else
+    int descriptor = -1;
+#endif
+};
+
+// Models stored the way the engine uses them, so loading skips Assimp and every per vertex step.
+// The container holds the final vertex and index buffers of every mesh, already in the mesh's
+// vertex layout, the materials with the files of their textures, the mesh_dict tree, bone info
+// and animation channels.
+// Vertex and index buffers are uploaded straight out of the mapped file.
+class cooked_model {
+public:
+    static constexpr uint32_t magic = 0x444d584c; // "LXMD"
+    // bump when the layout or the vertex struct changes, older files are then ignored.
+    static constexpr uint32_t version = 4;
+
+    // where the cooked version of a model file lives.
+    static string path_for(const string& file_path);
+    // true when cooked_path exists and is not older than file_path, or file_path is gone.
+    static bool is_fresh(const string& file_path, const string& cooked_path);
+    // imports file_path through Assimp and writes it to cooked_path, path_for(file_path) when empty.
+    // Needs no GL context, returns the written path.
+    static string cook(const string& file_path, const string& cooked_path = "");
+    static void write(rc_model model, const string& cooked_path);
+    // loads a cooked file, the GL work is appended to gl_tasks like mesh::import_file does.
+    // The root mesh_dict is named file_path.  Throws when the file is malformed or from another version.
+    static rc_model read(const string& file_path, const string& cooked_path, gl_task_list& gl_tasks);
+};
@@ -3,6 +3,9 @@
 
 #include <stb_image.h>
 
+static const uniform_id UNIFORM_VIEW = intern_uniform("view");
+static const uniform_id UNIFORM_PROJECTION = intern_uniform("projection");
+
 #define load_cubemap_img(path, glside) unsigned char* path##_img_data = stbi_load(path##_path.c_str(), &width, &height, &nrChannels, 0);\
     if (path##_img_data) {\
         glTexImage2D(\
@@ -38,8 +41,8 @@ void skybox::render(camera& camera) {
     glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
     mat->data->use_material();
     camera.recalculate_pv();
-    mat->data->set_uniform("view", matrix4x4(glm::mat3(camera.view.mat)));
-    mat->data->set_uniform("projection", camera.projection);
+    mat->data->set_uniform(UNIFORM_VIEW, matrix4x4(glm::mat3(camera.view.mat)));
+    mat->data->set_uniform(UNIFORM_PROJECTION, camera.projection);
     mat->data->register_uniforms();
     // skybox cube
     glBindVertexArray(vao);
@@ -1,26 +1,47 @@
 #include "DirectionalLight.h"
 #include <sstream>
 
-void directional_light::set_uniforms(GLuint shader_prog, size_t index) {
-    std::stringstream ss;
-    ss << "directional_lights[" << index << "].";
-    auto prefix = ss.str();
+struct directional_light_uniform_ids {
+    uniform_id rotation, color, ambient, diffuse, specular, intensity;
+};
+
+// names for directional_lights[index] are built once and reused every frame.
+static const directional_light_uniform_ids& get_uniform_ids(size_t index) {
+    static vector<directional_light_uniform_ids> ids;
+    while (ids.size() <= index) {
+        std::stringstream ss;
+        ss << "directional_lights[" << ids.size() << "].";
+        auto prefix = ss.str();
+        ids.push_back({
+            intern_uniform(prefix + "rotation"),
+            intern_uniform(prefix + "color"),
+            intern_uniform(prefix + "ambient"),
+            intern_uniform(prefix + "diffuse"),
+            intern_uniform(prefix + "specular"),
+            intern_uniform(prefix + "intensity")
+        });
+    }
+    return ids[index];
+}
+
+void directional_light::set_uniforms(material* mat, size_t index) {
+    const auto& ids = get_uniform_ids(index);
     // set struct parameters
-    GLuint rotation_loc = glGetUniformLocation(shader_prog, (prefix + "rotation").c_str());
-    glUniformMatrix4fv(rotation_loc, 1, GL_FALSE, glm::value_ptr(glm::toMat4(this->rotation->quat)));
+    glUniformMatrix4fv(mat->get_uniform_location(ids.rotation), 1, GL_FALSE, glm::value_ptr(glm::toMat4(this->rotation->quat)));
+
+    glUniform3fv(mat->get_uniform_location(ids.color), 1, glm::value_ptr(this->color->axis));
 
-    GLuint color_loc = glGetUniformLocation(shader_prog, (prefix + "color").c_str());
-    glUniform3fv(color_loc, 1, glm::value_ptr(this->color->axis));
+    glUniform3fv(mat->get_uniform_location(ids.ambient), 1, glm::value_ptr(this->ambient->axis));
 
-    GLuint ambient_loc = glGetUniformLocation(shader_prog, (prefix + "ambient").c_str());
-    glUniform3fv(ambient_loc, 1, glm::value_ptr(this->ambient->axis));
+    glUniform3fv(mat->get_uniform_location(ids.diffuse), 1, glm::value_ptr(this->diffuse->axis));
 
-    GLuint diffuse_loc = glGetUniformLocation(shader_prog, (prefix + "diffuse").c_str());
-    glUniform3fv(diffuse_loc, 1, glm::value_ptr(this->diffuse->axis));
+    glUniform3fv(mat->get_uniform_location(ids.specular), 1, glm::value_ptr(this->specular->axis));
 
-    GLuint specular_loc = glGetUniformLocation(shader_prog, (prefix + "specular").c_str());
-    glUniform3fv(specular_loc, 1, glm::value_ptr(this->specular->axis));
+    glUniform1f(mat->get_uniform_location(ids.intensity), this->intensity);
+}
 
-    GLuint intensity_loc = glGetUniformLocation(shader_prog, (prefix + "intensity").c_str());
-    glUniform1f(intensity_loc, this->intensity);
-}
\ No newline at end of file
+void directional_light::pack(std140_directional_light& out) const {
+    // same axis the default fragment shader used to extract from the rotation matrix.
+    out.direction = glm::vec4(glm::normalize(glm::vec3(glm::toMat4(this->rotation->quat)[2])), 0.0f);
+    out.color = glm::vec4(this->color->axis, this->intensity);
+}
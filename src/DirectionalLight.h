@@ -1,6 +1,7 @@
 #pragma once
 #include "glad/gl.h"
 #include "Object3d.h"
+#include "UniformBuffer.h"
 #include "Quaternion.h"
 
 class directional_light {
@@ -14,7 +15,9 @@ public:
     vec3* diffuse;
     vec3* specular;
     float intensity = 1.0f;
-    void set_uniforms(GLuint shader_prog, size_t index);
+    void set_uniforms(material* mat, size_t index);
+    // writes the light into its slot of the per-frame light uniform buffer.
+    void pack(std140_directional_light& out) const;
     friend inline std::ostream& operator<<(std::ostream& os, const directional_light& self){
         os << "directional_light{ rotation: " << *self.rotation << ", color: " << *self.color << " }";
         return os;
@@ -9,6 +9,10 @@
 #include "Camera.h"
 #include <string>
 #include "glad/gl.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <atomic>
 
 using std::vector;
 
@@ -61,6 +65,13 @@ public:
     }
     
     inline void render(const camera & cam) {
+        update(cam);
+        if (emitting)
+            draw(cam);
+    }
+
+    // keeps the particle count at rate and advances the particles, also refreshes bounds_min/bounds_max.
+    inline void update(const camera & cam) {
         while(particles.size() != rate) {
             if (particles.size() < rate) {
                 particles.push_back(create_particle());
@@ -68,10 +79,14 @@ public:
                 particles.pop_back();
             }
         }
-        if (emitting) {
-            material->data->use_material();
-            update_instance_batch(cam);
-        }
+        if (emitting)
+            update_instance_data(cam);
+    }
+
+    // uploads the particles advanced by the last update and draws them.
+    inline void draw(const camera & cam) {
+        material->data->use_material();
+        draw_instance_batch(cam);
     }
 
     vector<particle> particles;
@@ -87,7 +102,17 @@ public:
     vec4* color_max;
     rc_material material;
     bool emitting = false;
+    // emitters update on job_system workers, so each one draws from its own generator.
+    // Seeded in creation order so runs with the same emitters are repeatable.
+    std::minstd_rand rng = std::minstd_rand(next_seed());
+    // world space box around the particles of the last update, padded by the largest particle scale.
+    vec3 bounds_min = vec3(0.0f, 0.0f, 0.0f);
+    vec3 bounds_max = vec3(0.0f, 0.0f, 0.0f);
 private:
+    inline static unsigned int next_seed() {
+        static std::atomic<unsigned int> seed{1};
+        return seed.fetch_add(1);
+    }
 
     inline void create_particles() {
         for (size_t i = 0; i < rate; i++)
@@ -100,23 +125,23 @@ private:
         
         quaternion dir = *direction;
 
-        float random_angle = rand_range(0.0f, 1.0f) * PI * 2;
-        float vel = rand_range(start_velocity_min, start_velocity_max);
+        float random_angle = rand_range(rng, 0.0f, 1.0f) * PI * 2;
+        float vel = rand_range(rng, start_velocity_min, start_velocity_max);
 
         dir.rotate(dir.get_forward(), random_angle);
-        dir.rotate(dir.get_up(), rand_range(-spread, spread));
-        dir.rotate(dir.get_right(), rand_range(-spread, spread));
+        dir.rotate(dir.get_up(), rand_range(rng, -spread, spread));
+        dir.rotate(dir.get_right(), rand_range(rng, -spread, spread));
         
-        vec4 color(rand_range(color_min->axis.x, color_max->axis.x), rand_range(color_min->axis.y, color_max->axis.y), rand_range(color_min->axis.z, color_max->axis.z), rand_range(color_min->axis.w, color_max->axis.w));
+        vec4 color(rand_range(rng, color_min->axis.x, color_max->axis.x), rand_range(rng, color_min->axis.y, color_max->axis.y), rand_range(rng, color_min->axis.z, color_max->axis.z), rand_range(rng, color_min->axis.w, color_max->axis.w));
         
-        vec2 scale(rand_range(scale_min->axis.x, scale_max->axis.x), rand_range(scale_min->axis.y, scale_max->axis.y));
+        vec2 scale(rand_range(rng, scale_min->axis.x, scale_max->axis.x), rand_range(rng, scale_min->axis.y, scale_max->axis.y));
 
         return particle(
             *position,
             scale,
             dir.get_forward() * vel,
             color,
-            rand_range(start_lifetime_min, start_lifetime_max)
+            rand_range(rng, start_lifetime_min, start_lifetime_max)
         );
     }
 
@@ -136,36 +161,47 @@ private:
         p->velocity -= cam ? velocity_decay * (float)*cam->deltatime : velocity_decay;
     }
 
-    inline void update_instance_batch(const camera & cam) {
-        
-        vector<float> instance_vbo_update;
-        unsigned int i = 0;
+    inline void update_instance_data(const camera & cam) {
+        instance_data.clear();
+        glm::vec3 lower(INFINITY), upper(-INFINITY);
         for (particle & p : particles) {
             update_particle(&p, &cam);
-            instance_vbo_update.push_back(p.position.axis.x);
-            instance_vbo_update.push_back(p.position.axis.y);
-            instance_vbo_update.push_back(p.position.axis.z);
+            instance_data.push_back(p.position.axis.x);
+            instance_data.push_back(p.position.axis.y);
+            instance_data.push_back(p.position.axis.z);
 
-            instance_vbo_update.push_back(p.color.axis.x);
-            instance_vbo_update.push_back(p.color.axis.y);
-            instance_vbo_update.push_back(p.color.axis.z);
-            instance_vbo_update.push_back(p.color.axis.w);
+            instance_data.push_back(p.color.axis.x);
+            instance_data.push_back(p.color.axis.y);
+            instance_data.push_back(p.color.axis.z);
+            instance_data.push_back(p.color.axis.w);
 
-            instance_vbo_update.push_back(p.scale.axis.x);
-            instance_vbo_update.push_back(p.scale.axis.y);
+            instance_data.push_back(p.scale.axis.x);
+            instance_data.push_back(p.scale.axis.y);
 
-            instance_vbo_update.push_back(p.life);
+            instance_data.push_back(p.life);
 
-            instance_vbo_update.push_back(p.starting_life);
-            
-            i++;
+            instance_data.push_back(p.starting_life);
+
+            lower = glm::min(lower, p.position.axis);
+            upper = glm::max(upper, p.position.axis);
         }
-        glBindBuffer(GL_ARRAY_BUFFER, gl_VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, instance_vbo_update.size() * sizeof(float), instance_vbo_update.data());
+        float pad = std::max({scale_max->axis.x, scale_max->axis.y, scale_min->axis.x, scale_min->axis.y, 0.0f});
+        if (particles.empty())
+            lower = upper = position->axis;
+        bounds_min.axis = lower - glm::vec3(pad);
+        bounds_max.axis = upper + glm::vec3(pad);
+    }
 
-        material->data->set_uniform("projection", cam.projection);
-        material->data->set_uniform("view", cam.view);
-        material->data->set_uniform("sprite", 0);
+    inline void draw_instance_batch(const camera & cam) {
+        glBindBuffer(GL_ARRAY_BUFFER, gl_VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instance_data.size() * sizeof(float), instance_data.data());
+
+        static const uniform_id projection_id = intern_uniform("projection");
+        static const uniform_id view_id = intern_uniform("view");
+        static const uniform_id sprite_id = intern_uniform("sprite");
+        material->data->set_uniform(projection_id, cam.projection);
+        material->data->set_uniform(view_id, cam.view);
+        material->data->set_uniform(sprite_id, 0);
         material->data->register_uniforms();
         glActiveTexture(GL_TEX_N_ITTER[0]);
         material->data->diffuse_texture->data->bind();
@@ -239,4 +275,5 @@ private:
     }
 
     GLuint gl_VAO, gl_VBO, gl_EBO;
+    vector<float> instance_data;
 };
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "Frustum.h"
+#include <cmath>
+#include <cfloat>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <glm/gtc/matrix_transform.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOXOC_FRUSTUM_SSE
+#include <emmintrin.h>
+#endif
+
+void frustum::extract(const glm::mat4& view_projection) {
+    // Gribb/Hartmann: each plane is the last row of the matrix plus or minus one of the others.
+    auto row = [&view_projection](int r) {
+        return glm::vec4(view_projection[0][r], view_projection[1][r], view_projection[2][r], view_projection[3][r]);
+    };
+    glm::vec4 planes[6] = {
+        row(3) + row(0), // left
+        row(3) - row(0), // right
+        row(3) + row(1), // bottom
+        row(3) - row(1), // top
+        row(3) + row(2), // near
+        row(3) - row(2)  // far
+    };
+    for (int i = 0; i < 6; i++) {
+        float length = glm::length(glm::vec3(planes[i]));
+        glm::vec4 plane = length > 0.0f ? planes[i] / length : planes[i];
+        this->normal_x[i] = plane.x;
+        this->normal_y[i] = plane.y;
+        this->normal_z[i] = plane.z;
+        this->distance[i] = plane.w;
+    }
+    // padding planes that everything is inside of.
+    for (int i = 6; i < 8; i++) {
+        this->normal_x[i] = this->normal_y[i] = this->normal_z[i] = 0.0f;
+        this->distance[i] = FLT_MAX;
+    }
+}
+
+FrustumTest frustum::test_sphere(const glm::vec3& center, float radius) const {
+    return this->classify(center, glm::vec3(0.0f), radius);
+}
+
+FrustumTest frustum::test_aabb(const glm::vec3& center, const glm::vec3& extent) const {
+    return this->classify(center, extent, 0.0f);
+}
+
+FrustumTest frustum::test_aabb(const glm::vec3& aabb_min, const glm::vec3& aabb_max, const glm::mat4& model) const {
+    glm::vec3 local_center = (aabb_min + aabb_max) * 0.5f;
+    glm::vec3 local_extent = (aabb_max - aabb_min) * 0.5f;
+    glm::vec3 center = glm::vec3(model * glm::vec4(local_center, 1.0f));
+    // the absolute rotation/scale part maps the half size onto the world axes.
+    glm::mat3 abs_basis = glm::mat3(model);
+    for (int c = 0; c < 3; c++)
+        abs_basis[c] = glm::abs(abs_basis[c]);
+    return this->classify(center, abs_basis * local_extent, 0.0f);
+}
+
+FrustumTest frustum::classify(const glm::vec3& center, const glm::vec3& extent, float radius) const {
+#ifdef LOXOC_FRUSTUM_SSE
+    int outside = 0, intersects = 0;
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+    const __m128 ex = _mm_set1_ps(extent.x), ey = _mm_set1_ps(extent.y), ez = _mm_set1_ps(extent.z);
+    const __m128 r = _mm_set1_ps(radius);
+    for (int i = 0; i < 8; i += 4) {
+        __m128 nx = _mm_load_ps(&this->normal_x[i]);
+        __m128 ny = _mm_load_ps(&this->normal_y[i]);
+        __m128 nz = _mm_load_ps(&this->normal_z[i]);
+        // signed distance of the center and how far the volume reaches along the normal.
+        __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_add_ps(_mm_mul_ps(nz, cz), _mm_load_ps(&this->distance[i])));
+        __m128 reach = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign_mask, nx), ex), _mm_mul_ps(_mm_andnot_ps(sign_mask, ny), ey)),
+            _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign_mask, nz), ez), r)
+        );
+        outside |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(d, reach), zero));
+        intersects |= _mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(d, reach), zero));
+    }
+    if (outside)
+        return FrustumTest::OUTSIDE;
+    return intersects ? FrustumTest::INTERSECTS : FrustumTest::INSIDE;
+#else
+    return this->classify_scalar(center, extent, radius);
+#endif
+}
+
+FrustumTest frustum::classify_scalar(const glm::vec3& center, const glm::vec3& extent, float radius) const {
+    bool outside = false, intersects = false;
+    // all eight planes, summed in the same order as the SSE2 lanes so both round alike.
+    for (int i = 0; i < 8; i++) {
+        float d = (this->normal_x[i] * center.x + this->normal_y[i] * center.y) + (this->normal_z[i] * center.z + this->distance[i]);
+        float reach = (std::abs(this->normal_x[i]) * extent.x + std::abs(this->normal_y[i]) * extent.y) + (std::abs(this->normal_z[i]) * extent.z + radius);
+        outside |= d + reach < 0.0f;
+        intersects |= d - reach < 0.0f;
+    }
+    if (outside)
+        return FrustumTest::OUTSIDE;
+    return intersects ? FrustumTest::INTERSECTS : FrustumTest::INSIDE;
+}
+
+namespace {
+
+void expect(bool condition, const std::string& what) {
+    if (!condition)
+        throw std::runtime_error("Frustum self test failed: " + what + ".");
+}
+
+const char* test_name(FrustumTest result) {
+    switch (result) {
+        case FrustumTest::OUTSIDE: return "outside";
+        case FrustumTest::INTERSECTS: return "intersects";
+        default: return "inside";
+    }
+}
+
+} // namespace
+
+void frustum::self_test() {
+    // a camera at the origin looking down -z, near 0.1, far 100.
+    frustum view(glm::perspective(1.0471976f, 16.0f / 9.0f, 0.1f, 100.0f));
+    expect(view.test_sphere(glm::vec3(0.0f, 0.0f, -10.0f), 1.0f) == FrustumTest::INSIDE, "a sphere in front of the camera is not inside");
+    expect(view.test_sphere(glm::vec3(0.0f, 0.0f, 10.0f), 1.0f) == FrustumTest::OUTSIDE, "a sphere behind the camera is not outside");
+    expect(view.test_sphere(glm::vec3(0.0f, 0.0f, -100.0f), 1.0f) == FrustumTest::INTERSECTS, "a sphere on the far plane does not intersect");
+    expect(view.test_aabb(glm::vec3(0.0f, 0.0f, -50.0f), glm::vec3(500.0f)) == FrustumTest::INTERSECTS, "a box around the whole view does not intersect");
+    expect(view.test_aabb(glm::vec3(-200.0f, 0.0f, -10.0f), glm::vec3(1.0f)) == FrustumTest::OUTSIDE, "a box far to the left is not outside");
+    glm::mat4 moved = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -20.0f));
+    expect(view.test_aabb(glm::vec3(-1.0f), glm::vec3(1.0f), moved) == FrustumTest::INSIDE, "a box moved in front of the camera is not inside");
+
+    // the padding planes have to stay out of the answer, even for volumes reaching past FLT_MAX.
+    for (int i = 6; i < 8; i++)
+        expect(view.normal_x[i] == 0.0f && view.normal_y[i] == 0.0f && view.normal_z[i] == 0.0f && view.distance[i] == FLT_MAX, "padding plane " + std::to_string(i) + " is not empty");
+    const float huge[] = {0.0f, 1e30f, FLT_MAX};
+    for (float r : huge) {
+        expect(view.classify(glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f), r) == view.classify_scalar(glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f), r), "the SSE2 and scalar tests disagree on a sphere of radius " + std::to_string(r));
+        expect(view.classify(glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(r), 0.0f) == view.classify_scalar(glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(r), 0.0f), "the SSE2 and scalar tests disagree on a box of half size " + std::to_string(r));
+    }
+    expect(view.test_sphere(glm::vec3(0.0f, 0.0f, -10.0f), FLT_MAX) == FrustumTest::INTERSECTS, "a sphere of radius FLT_MAX does not intersect");
+
+    // random cameras against random spheres and boxes, both paths have to agree on every one.
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> position(-150.0f, 150.0f), size(0.0f, 40.0f), angle(-3.14159265f, 3.14159265f), fov(0.3f, 2.5f);
+    for (int camera = 0; camera < 8; camera++) {
+        glm::vec3 eye(position(rng) * 0.1f, position(rng) * 0.1f, position(rng) * 0.1f);
+        glm::vec3 forward(std::cos(angle(rng)), std::sin(angle(rng)) * 0.5f, std::sin(angle(rng)));
+        frustum test(glm::perspective(fov(rng), 0.5f + size(rng) * 0.05f, 0.1f, 50.0f + size(rng) * 5.0f) * glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+        for (int i = 0; i < 2000; i++) {
+            glm::vec3 center(position(rng), position(rng), position(rng));
+            bool sphere = i % 2 == 0;
+            glm::vec3 extent = sphere ? glm::vec3(0.0f) : glm::vec3(size(rng), size(rng), size(rng));
+            float radius = sphere ? size(rng) : 0.0f;
+            FrustumTest fast = test.classify(center, extent, radius), scalar = test.classify_scalar(center, extent, radius);
+            expect(fast == scalar, std::string("the SSE2 and scalar tests disagree on ") + (sphere ? "sphere " : "box ") + std::to_string(i) + " of camera " + std::to_string(camera) + ", " + test_name(fast) + " against " + test_name(scalar));
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <glm/glm.hpp>
+
+enum class FrustumTest {
+    OUTSIDE,
+    INTERSECTS,
+    INSIDE
+};
+
+// View frustum planes extracted from a projection * view matrix.
+class frustum {
+public:
+    frustum(){}
+    frustum(const glm::mat4& view_projection) {
+        this->extract(view_projection);
+    }
+
+    void extract(const glm::mat4& view_projection);
+
+    FrustumTest test_sphere(const glm::vec3& center, float radius) const;
+    // world space box given by its center and half size.
+    FrustumTest test_aabb(const glm::vec3& center, const glm::vec3& extent) const;
+    // local space box moved by a model matrix, the result is widened to stay axis aligned.
+    FrustumTest test_aabb(const glm::vec3& aabb_min, const glm::vec3& aabb_max, const glm::mat4& model) const;
+
+    // classifies random spheres and boxes against a few cameras with both the SSE2 and the scalar path,
+    // padding planes included, and checks a handful of known answers.  Throws on a mismatch.
+    static void self_test();
+
+private:
+    FrustumTest classify(const glm::vec3& center, const glm::vec3& extent, float radius) const;
+    // the same test one plane at a time, used where SSE2 is missing and to check the SSE2 path.
+    FrustumTest classify_scalar(const glm::vec3& center, const glm::vec3& extent, float radius) const;
+
+    // six planes as structure of arrays padded to eight for the 4 wide kernel.
+    // A point is inside a plane when dot(normal, point) + distance >= 0.
+    alignas(16) float normal_x[8] = {};
+    alignas(16) float normal_y[8] = {};
+    alignas(16) float normal_z[8] = {};
+    alignas(16) float distance[8] = {};
+};
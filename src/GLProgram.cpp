@@ -0,0 +1,329 @@
+#include "GLProgram.h"
+#include "UniformBuffer.h"
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <mutex>
+#include <algorithm>
+
+#define INSTANCED_DEFINE "LOXOC_INSTANCED"
+
+// "LXPB", bump the version when the file layout changes.
+static const uint32_t BINARY_MAGIC = 0x4250584c;
+static const uint32_t BINARY_VERSION = 1;
+
+static program_cache_stats binary_cache_stats;
+
+static string& binary_cache_directory() {
+    static string directory = []() {
+        std::error_code err;
+        std::filesystem::path temp = std::filesystem::temp_directory_path(err);
+        return err ? string() : (temp / "loxoc_program_cache").string();
+    }();
+    return directory;
+}
+
+// vendor, renderer and version of the current context, a binary is only valid for the driver that wrote it.
+static const string& driver_id() {
+    static string id = []() {
+        auto get = [](GLenum name) {
+            const GLubyte* value = glGetString(name);
+            return value ? string(reinterpret_cast<const char*>(value)) : string();
+        };
+        return get(GL_VENDOR) + "\n" + get(GL_RENDERER) + "\n" + get(GL_VERSION);
+    }();
+    return id;
+}
+
+static bool binary_cache_enabled() {
+    static GLint format_count = -1;
+    if (format_count < 0)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    return format_count > 0 && !binary_cache_directory().empty();
+}
+
+template<typename T>
+static inline bool read_value(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+template<typename T>
+static inline void write_value(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+uniform_id intern_uniform(const string& name) {
+    static std::unordered_map<string, uniform_id> ids;
+    static std::mutex ids_mutex;
+    std::lock_guard<std::mutex> lock(ids_mutex);
+    auto [it, inserted] = ids.try_emplace(name, static_cast<uniform_id>(ids.size()));
+    return it->second;
+}
+
+std::unordered_map<gl_program::program_key, RC<gl_program*>*, gl_program::program_key_hash>& gl_program::cache() {
+    static std::unordered_map<program_key, RC<gl_program*>*, program_key_hash> programs;
+    return programs;
+}
+
+RC<gl_program*>* gl_program::get(shader* vertex, shader* fragment, shader* geometry, shader* compute) {
+    program_key key = {
+        vertex->cache_key(),
+        fragment->cache_key(),
+        geometry ? geometry->cache_key() : 0,
+        compute ? compute->cache_key() : 0
+    };
+    auto& programs = cache();
+    auto it = programs.find(key);
+    if (it == programs.end()) // the cache keeps the first reference.
+        it = programs.emplace(key, new RC(new gl_program(key, vertex, fragment, geometry, compute))).first;
+    it->second->inc();
+    return it->second;
+}
+
+size_t gl_program::collect_unused() {
+    auto& programs = cache();
+    size_t collected = 0;
+    for (auto it = programs.begin(); it != programs.end();) {
+        if (it->second->refcount == 1) {
+            RC_collect(it->second);
+            it = programs.erase(it);
+            collected++;
+        } else {
+            ++it;
+        }
+    }
+    return collected;
+}
+
+size_t gl_program::cached_count() {
+    return cache().size();
+}
+
+void gl_program::set_binary_cache_directory(const string& path) {
+    binary_cache_directory() = path;
+}
+
+string gl_program::get_binary_cache_directory() {
+    return binary_cache_directory();
+}
+
+program_cache_stats gl_program::get_binary_cache_stats() {
+    return binary_cache_stats;
+}
+
+gl_program::gl_program(const program_key& key, shader* vertex, shader* fragment, shader* geometry, shader* compute) {
+    this->handle = glCreateProgram();
+    if (this->load_binary(key)) {
+        binary_cache_stats.hits++;
+    } else {
+        binary_cache_stats.misses++;
+        this->compile_and_link(vertex, fragment, geometry, compute);
+        this->store_binary(key);
+    }
+    this->supports_instancing = vertex->source.find(INSTANCED_DEFINE) != string::npos;
+    this->reflect_uniforms();
+}
+
+void gl_program::compile_and_link(shader* vertex, shader* fragment, shader* geometry, shader* compute) {
+    shader* stages[] = {vertex, fragment, geometry, compute};
+    for (shader* stage : stages)
+        if (stage && !stage->shader_handle)
+            stage->compile();
+
+    for (shader* stage : stages)
+        if (stage)
+            glAttachShader(this->handle, stage->shader_handle);
+
+    if (binary_cache_enabled())
+        glProgramParameteri(this->handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(this->handle);
+
+    // the stage objects are not needed once linked, the next program using them compiles again.
+    for (shader* stage : stages) {
+        if (stage) {
+            glDetachShader(this->handle, stage->shader_handle);
+            glDeleteShader(stage->shader_handle);
+            stage->shader_handle = 0;
+        }
+    }
+
+    // Check for linking errors
+    GLint success;
+    GLchar infoLog[512];
+    glGetProgramiv(this->handle, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(this->handle, 512, NULL, infoLog);
+        glDeleteProgram(this->handle);
+        std::stringstream ss;
+        ss << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << "\n";
+        std::cerr << ss.str();
+        throw std::runtime_error(ss.str());
+    }
+}
+
+static std::filesystem::path binary_path(const std::array<uint64_t, 4>& key) {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const unsigned char* bytes, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    mix(reinterpret_cast<const unsigned char*>(key.data()), sizeof(uint64_t) * key.size());
+    mix(reinterpret_cast<const unsigned char*>(driver_id().data()), driver_id().size());
+    std::stringstream name;
+    name << std::hex << hash << ".bin";
+    return std::filesystem::path(binary_cache_directory()) / name.str();
+}
+
+bool gl_program::load_binary(const program_key& key) {
+    if (!binary_cache_enabled())
+        return false;
+    std::ifstream file(binary_path(key), std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    // the driver string and stage keys are stored in full, so a hash collision reads as a miss.
+    uint32_t magic = 0, version = 0, driver_length = 0;
+    if (!read_value(file, magic) || !read_value(file, version) || !read_value(file, driver_length)
+        || magic != BINARY_MAGIC || version != BINARY_VERSION || driver_length != driver_id().size())
+        return false;
+    string driver(driver_length, '\0');
+    program_key stored_key;
+    GLenum format = 0;
+    uint32_t length = 0;
+    if (!file.read(driver.data(), driver_length) || driver != driver_id()
+        || !read_value(file, stored_key) || stored_key != key
+        || !read_value(file, format) || !read_value(file, length) || length == 0)
+        return false;
+    std::vector<char> data(length);
+    if (!file.read(data.data(), length))
+        return false;
+
+    glProgramBinary(this->handle, format, data.data(), static_cast<GLsizei>(length));
+    GLint success = 0;
+    glGetProgramiv(this->handle, GL_LINK_STATUS, &success);
+    if (!success) {
+        // usually a driver update, start over on a clean program and overwrite the entry.
+        binary_cache_stats.rejected++;
+        glDeleteProgram(this->handle);
+        this->handle = glCreateProgram();
+        return false;
+    }
+    return true;
+}
+
+void gl_program::store_binary(const program_key& key) {
+    if (!binary_cache_enabled())
+        return;
+    GLint length = 0;
+    glGetProgramiv(this->handle, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+    std::vector<char> data(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(this->handle, length, &written, &format, data.data());
+    if (written <= 0)
+        return;
+
+    // the cache is best effort, a directory that can't be written to only costs the next startup.
+    std::error_code err;
+    std::filesystem::create_directories(binary_cache_directory(), err);
+    if (err)
+        return;
+    std::filesystem::path path = binary_path(key);
+    std::filesystem::path partial = path;
+    partial += ".partial";
+    {
+        std::ofstream file(partial, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return;
+        const string& driver = driver_id();
+        write_value(file, BINARY_MAGIC);
+        write_value(file, BINARY_VERSION);
+        write_value(file, static_cast<uint32_t>(driver.size()));
+        file.write(driver.data(), driver.size());
+        write_value(file, key);
+        write_value(file, format);
+        write_value(file, static_cast<uint32_t>(written));
+        file.write(data.data(), written);
+        if (!file) {
+            file.close();
+            std::filesystem::remove(partial, err);
+            return;
+        }
+    }
+    // renamed into place so a crash mid write never leaves a truncated entry behind.
+    std::filesystem::rename(partial, path, err);
+    if (!err)
+        binary_cache_stats.stored++;
+}
+
+gl_program::~gl_program() {
+    glDeleteProgram(this->handle);
+}
+
+void gl_program::reflect_uniforms() {
+    // bind the engine uniform blocks by index, GLSL 330 has no binding layout qualifier.
+    auto bind_block = [this](const char* block_name, UniformBlockBinding binding) {
+        GLuint block_index = glGetUniformBlockIndex(this->handle, block_name);
+        if (block_index == GL_INVALID_INDEX)
+            return false;
+        glUniformBlockBinding(this->handle, block_index, static_cast<GLuint>(binding));
+        return true;
+    };
+    this->has_frame_block = bind_block(FRAME_BLOCK_NAME, UniformBlockBinding::FRAME);
+    this->has_light_block = bind_block(LIGHT_BLOCK_NAME, UniformBlockBinding::LIGHTS);
+
+    // the clustered light buffers stay bound to fixed units for the whole frame.
+    auto bind_sampler = [this](const char* sampler_name, LightBufferUnit unit) {
+        GLint loc = glGetUniformLocation(this->handle, sampler_name);
+        if (loc != -1)
+            glProgramUniform1i(this->handle, loc, static_cast<GLint>(unit));
+    };
+    bind_sampler(POINT_LIGHT_SAMPLER_NAME, LightBufferUnit::POINT_LIGHTS);
+    bind_sampler(SPOT_LIGHT_SAMPLER_NAME, LightBufferUnit::SPOT_LIGHTS);
+    bind_sampler(CLUSTER_GRID_SAMPLER_NAME, LightBufferUnit::CLUSTER_GRID);
+    bind_sampler(CLUSTER_INDICES_SAMPLER_NAME, LightBufferUnit::CLUSTER_INDICES);
+
+    // Query every active uniform once so setters become an array index.
+    this->uniform_locations.clear();
+    GLint uniform_count = 0, max_name_length = 0;
+    glGetProgramiv(this->handle, GL_ACTIVE_UNIFORMS, &uniform_count);
+    glGetProgramiv(this->handle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+    std::vector<GLchar> name_buffer(std::max(max_name_length, 1));
+
+    this->location_ids.clear();
+    auto store = [this](const string& name, GLint loc) {
+        uniform_id id = intern_uniform(name);
+        if (static_cast<size_t>(id) >= this->uniform_locations.size())
+            this->uniform_locations.resize(id + 1, -1);
+        this->uniform_locations[id] = loc;
+        if (loc != -1)
+            this->location_ids.try_emplace(loc, id);
+    };
+
+    for (GLint u_n = 0; u_n < uniform_count; u_n++) {
+        GLint array_size = 0;
+        GLenum type;
+        GLsizei name_length = 0;
+        glGetActiveUniform(this->handle, u_n, name_buffer.size(), &name_length, &array_size, &type, name_buffer.data());
+        string name(name_buffer.data(), name_length);
+        GLint loc = glGetUniformLocation(this->handle, name.c_str());
+        if (loc == -1) // uniform block members have no location
+            continue;
+        store(name, loc);
+
+        // arrays are reported once as "name[0]", register every element and the bare name.
+        auto bracket = name.rfind("[0]");
+        if (bracket != string::npos && bracket + 3 == name.size()) {
+            string base = name.substr(0, bracket);
+            store(base, loc);
+            for (GLint i = 1; i < array_size; i++) {
+                string element = base + "[" + std::to_string(i) + "]";
+                store(element, glGetUniformLocation(this->handle, element.c_str()));
+            }
+        }
+    }
+}
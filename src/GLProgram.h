@@ -0,0 +1,84 @@
+#pragma once
+#include "Shader.h"
+#include "RC.h"
+#include "glad/gl.h"
+#include <string>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <cstdint>
+
+using std::string;
+
+typedef int uniform_id;
+
+// Uniform names are interned process-wide so render paths can keep an integer
+// handle instead of building the name string on every draw.
+uniform_id intern_uniform(const string& name);
+
+// how the on-disk program binary cache did since startup.
+struct program_cache_stats {
+    // programs loaded from a cached binary.
+    size_t hits = 0;
+    // programs that had to be compiled, including rejected binaries.
+    size_t misses = 0;
+    // cached binaries the driver refused, they get replaced.
+    size_t rejected = 0;
+    // binaries written to the cache directory.
+    size_t stored = 0;
+};
+
+// A linked GL program and its uniform reflection.  Every material built from the same
+// stage sources shares one, so only get() should create them.
+class gl_program {
+public:
+    // the program for these stages, compiled and linked on the first request.
+    // The returned reference belongs to the caller.
+    static RC<gl_program*>* get(shader* vertex, shader* fragment, shader* geometry = nullptr, shader* compute = nullptr);
+    // deletes the cached programs no material holds anymore, returns how many went.
+    static size_t collect_unused();
+    static size_t cached_count();
+
+    // Linked programs are written to this directory and loaded from it instead of compiling on later runs.
+    // Defaults to "loxoc_program_cache" in the system temp directory, an empty path turns the cache off.
+    static void set_binary_cache_directory(const string& path);
+    static string get_binary_cache_directory();
+    static program_cache_stats get_binary_cache_stats();
+
+    ~gl_program();
+
+    // Returns -1 when the uniform is not active in the program.
+    inline GLint get_uniform_location(uniform_id id) const {
+        return static_cast<size_t>(id) < uniform_locations.size() ? uniform_locations[id] : -1;
+    }
+
+    GLuint handle = 0;
+    // indexed by uniform_id.
+    std::vector<GLint> uniform_locations;
+    // reverse of uniform_locations.
+    std::unordered_map<GLint, uniform_id> location_ids;
+    // wether the program reads camera/light data from the per-frame uniform buffers.
+    bool has_frame_block = false;
+    bool has_light_block = false;
+    // wether the vertex shader has an instanced path (mentions LOXOC_INSTANCED).
+    bool supports_instancing = false;
+private:
+    // cache_key() of each stage, 0 for missing ones.
+    typedef std::array<uint64_t, 4> program_key;
+
+    gl_program(const program_key& key, shader* vertex, shader* fragment, shader* geometry, shader* compute);
+    void compile_and_link(shader* vertex, shader* fragment, shader* geometry, shader* compute);
+    void reflect_uniforms();
+    // false when there is no usable binary for key, handle is left as a fresh program then.
+    bool load_binary(const program_key& key);
+    void store_binary(const program_key& key);
+    struct program_key_hash {
+        size_t operator()(const program_key& key) const {
+            size_t hash = 0;
+            for (uint64_t stage : key)
+                hash ^= std::hash<uint64_t>()(stage) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+            return hash;
+        }
+    };
+    static std::unordered_map<program_key, RC<gl_program*>*, program_key_hash>& cache();
+};
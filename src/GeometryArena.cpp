@@ -0,0 +1,254 @@
+#include "GeometryArena.h"
+#include <algorithm>
+#include <stdexcept>
+
+size_t range_allocator::allocate(size_t units) {
+    if (units == 0)
+        return 0;
+    for (auto it = ranges.begin(); it != ranges.end(); it++) {
+        if (it->second < units)
+            continue;
+        size_t offset = it->first;
+        size_t left = it->second - units;
+        ranges.erase(it);
+        if (left)
+            ranges.emplace(offset + units, left);
+        used += units;
+        return offset;
+    }
+    return npos;
+}
+
+void range_allocator::free(size_t offset, size_t units) {
+    if (units == 0)
+        return;
+    used -= units;
+    auto next = ranges.lower_bound(offset);
+    if (next != ranges.end() && offset + units == next->first) {
+        units += next->second;
+        next = ranges.erase(next);
+    }
+    if (next != ranges.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += units;
+            return;
+        }
+    }
+    ranges.emplace(offset, units);
+}
+
+void range_allocator::grow(size_t new_capacity) {
+    if (new_capacity <= capacity)
+        return;
+    size_t added = new_capacity - capacity;
+    // free() books the units as released, so count them as used first.
+    used += added;
+    size_t old_capacity = capacity;
+    capacity = new_capacity;
+    free(old_capacity, added);
+}
+
+void range_allocator::reset(size_t new_capacity, size_t used_units) {
+    ranges.clear();
+    capacity = new_capacity;
+    used = used_units;
+    if (used_units < new_capacity)
+        ranges.emplace(used_units, new_capacity - used_units);
+}
+
+size_t range_allocator::largest_free() const {
+    size_t ret = 0;
+    for (const auto& [offset, units] : ranges)
+        ret = std::max(ret, units);
+    return ret;
+}
+
+geometry_arena::geometry_arena(VertexLayout layout) : layout(layout), stride(vertex_layout_stride(layout)) {
+    glGenVertexArrays(1, &this->gl_VAO);
+}
+
+geometry_arena& geometry_arena::get(VertexLayout layout) {
+    auto& arena = arenas[static_cast<size_t>(layout)];
+    if (!arena)
+        arena.reset(new geometry_arena(layout));
+    return *arena;
+}
+
+void geometry_arena::resize_buffer(GLuint& buffer, size_t used_bytes, size_t new_bytes) {
+    GLuint resized;
+    glGenBuffers(1, &resized);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, resized);
+    glBufferData(GL_COPY_WRITE_BUFFER, new_bytes, nullptr, GL_STATIC_DRAW);
+    if (buffer) {
+        if (used_bytes) {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used_bytes);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = resized;
+}
+
+void geometry_arena::attach_buffers() {
+    glBindVertexArray(this->gl_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, this->gl_VBO);
+    set_vertex_attributes(this->layout);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->gl_EBO);
+    glBindVertexArray(0);
+}
+
+geometry_range* geometry_arena::allocate(const void* vertex_data, size_t vertex_count, const void* index_data, size_t index_bytes) {
+    size_t index_units = (index_bytes + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    bool resized = false;
+
+    size_t first_vertex = this->vertex_ranges.allocate(vertex_count);
+    if (first_vertex == range_allocator::npos) {
+        size_t capacity = std::max({initial_vertices, this->vertex_ranges.capacity * 2, this->vertex_ranges.capacity + vertex_count});
+        resize_buffer(this->gl_VBO, this->vertex_ranges.capacity * this->stride, capacity * this->stride);
+        this->vertex_ranges.grow(capacity);
+        first_vertex = this->vertex_ranges.allocate(vertex_count);
+        resized = true;
+        grows++;
+    }
+    size_t index_offset = this->index_ranges.allocate(index_units);
+    if (index_offset == range_allocator::npos) {
+        size_t capacity = std::max({initial_index_units, this->index_ranges.capacity * 2, this->index_ranges.capacity + index_units});
+        resize_buffer(this->gl_EBO, this->index_ranges.capacity * sizeof(uint32_t), capacity * sizeof(uint32_t));
+        this->index_ranges.grow(capacity);
+        index_offset = this->index_ranges.allocate(index_units);
+        resized = true;
+        grows++;
+    }
+    if (first_vertex == range_allocator::npos || index_offset == range_allocator::npos)
+        throw std::runtime_error("Geometry arena failed to allocate after growing.");
+    if (resized)
+        this->attach_buffers();
+
+    if (vertex_count) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, this->gl_VBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, first_vertex * this->stride, vertex_count * this->stride, vertex_data);
+    }
+    if (index_bytes) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, this->gl_EBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, index_offset * sizeof(uint32_t), index_bytes, index_data);
+    }
+
+    auto range = std::make_unique<geometry_range>();
+    range->arena = this;
+    range->first_vertex = first_vertex;
+    range->vertex_count = vertex_count;
+    range->index_offset = index_offset;
+    range->index_units = index_units;
+    range->slot = this->ranges.size();
+    geometry_range* ret = range.get();
+    this->ranges.push_back(std::move(range));
+    return ret;
+}
+
+void geometry_arena::release(geometry_range* range) {
+    geometry_arena* arena = range->arena;
+    arena->vertex_ranges.free(range->first_vertex, range->vertex_count);
+    arena->index_ranges.free(range->index_offset, range->index_units);
+    size_t slot = range->slot;
+    std::swap(arena->ranges[slot], arena->ranges.back());
+    arena->ranges[slot]->slot = slot;
+    arena->ranges.pop_back();
+}
+
+void geometry_arena::defragment() {
+    vector<geometry_range*> order;
+    order.reserve(this->ranges.size());
+    for (auto& range : this->ranges)
+        order.push_back(range.get());
+
+    // ranges are packed in offset order into fresh buffers, the old ones go once everything is copied.
+    size_t vertex_used = this->vertex_ranges.used;
+    size_t vertex_capacity = std::max(initial_vertices, vertex_used + vertex_used / 4);
+    GLuint vbo;
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertex_capacity * this->stride, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, this->gl_VBO);
+    std::sort(order.begin(), order.end(), [](geometry_range* a, geometry_range* b) {
+        return a->first_vertex < b->first_vertex;
+    });
+    size_t next = 0;
+    for (geometry_range* range : order) {
+        if (range->vertex_count)
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range->first_vertex * this->stride, next * this->stride, range->vertex_count * this->stride);
+        range->first_vertex = range->vertex_count ? next : 0;
+        next += range->vertex_count;
+    }
+    if (this->gl_VBO)
+        glDeleteBuffers(1, &this->gl_VBO);
+    this->gl_VBO = vbo;
+    this->vertex_ranges.reset(vertex_capacity, next);
+
+    size_t index_used = this->index_ranges.used;
+    size_t index_capacity = std::max(initial_index_units, index_used + index_used / 4);
+    GLuint ebo;
+    glGenBuffers(1, &ebo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+    glBufferData(GL_COPY_WRITE_BUFFER, index_capacity * sizeof(uint32_t), nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, this->gl_EBO);
+    std::sort(order.begin(), order.end(), [](geometry_range* a, geometry_range* b) {
+        return a->index_offset < b->index_offset;
+    });
+    next = 0;
+    for (geometry_range* range : order) {
+        if (range->index_units)
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range->index_offset * sizeof(uint32_t), next * sizeof(uint32_t), range->index_units * sizeof(uint32_t));
+        range->index_offset = range->index_units ? next : 0;
+        next += range->index_units;
+    }
+    if (this->gl_EBO)
+        glDeleteBuffers(1, &this->gl_EBO);
+    this->gl_EBO = ebo;
+    this->index_ranges.reset(index_capacity, next);
+
+    this->attach_buffers();
+    defragmentations++;
+}
+
+bool geometry_arena::fragmented() const {
+    auto mostly_holes = [](const range_allocator& ranges, size_t initial) {
+        return ranges.capacity > initial && ranges.free_ranges() > 1 && ranges.used < ranges.capacity / 2;
+    };
+    return mostly_holes(this->vertex_ranges, initial_vertices) || mostly_holes(this->index_ranges, initial_index_units);
+}
+
+void geometry_arena::defragment_all() {
+    for (auto& arena : arenas)
+        if (arena)
+            arena->defragment();
+}
+
+void geometry_arena::maintain() {
+    for (auto& arena : arenas)
+        if (arena && arena->fragmented())
+            arena->defragment();
+}
+
+geometry_arena_stats geometry_arena::get_stats() {
+    geometry_arena_stats ret;
+    for (auto& arena : arenas) {
+        if (!arena)
+            continue;
+        ret.arenas++;
+        ret.allocations += arena->ranges.size();
+        ret.vertex_capacity_bytes += arena->vertex_ranges.capacity * arena->stride;
+        ret.vertex_used_bytes += arena->vertex_ranges.used * arena->stride;
+        ret.index_capacity_bytes += arena->index_ranges.capacity * sizeof(uint32_t);
+        ret.index_used_bytes += arena->index_ranges.used * sizeof(uint32_t);
+        ret.free_ranges += arena->vertex_ranges.free_ranges() + arena->index_ranges.free_ranges();
+        ret.largest_free_bytes = std::max({
+            ret.largest_free_bytes,
+            arena->vertex_ranges.largest_free() * arena->stride,
+            arena->index_ranges.largest_free() * sizeof(uint32_t)
+        });
+    }
+    ret.grows = grows;
+    ret.defragmentations = defragmentations;
+    return ret;
+}
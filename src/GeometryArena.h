@@ -0,0 +1,111 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include "glad/gl.h"
+#include "VertexLayout.h"
+
+using std::vector;
+
+struct geometry_arena_stats {
+    size_t arenas = 0;
+    size_t allocations = 0;
+    size_t vertex_capacity_bytes = 0;
+    size_t vertex_used_bytes = 0;
+    size_t index_capacity_bytes = 0;
+    size_t index_used_bytes = 0;
+    // free ranges of all arenas, the space after the last allocation counts as one.
+    size_t free_ranges = 0;
+    size_t largest_free_bytes = 0;
+    size_t grows = 0;
+    size_t defragmentations = 0;
+};
+
+// First fit free list over [0, capacity) units, freed ranges merge with their neighbours.
+class range_allocator {
+public:
+    static constexpr size_t npos = SIZE_MAX;
+    // the offset of units free units, or npos.  Empty ranges take nothing and sit at 0.
+    size_t allocate(size_t units);
+    void free(size_t offset, size_t units);
+    // adds [capacity, new_capacity) to the free list.
+    void grow(size_t new_capacity);
+    // [0, used_units) taken, the rest free.
+    void reset(size_t new_capacity, size_t used_units);
+    inline size_t free_ranges() const {
+        return ranges.size();
+    }
+    size_t largest_free() const;
+    size_t capacity = 0;
+    size_t used = 0;
+private:
+    // offset -> units
+    std::map<size_t, size_t> ranges;
+};
+
+class geometry_arena;
+
+// Where a mesh's vertices and indices live inside an arena.  Defragmenting moves them,
+// so draws read the offsets from here every time.
+struct geometry_range {
+    geometry_arena* arena = nullptr;
+    size_t first_vertex = 0;
+    size_t vertex_count = 0;
+    // in 4 byte units, keeps 32 bit index ranges aligned.
+    size_t index_offset = 0;
+    size_t index_units = 0;
+    inline GLint base_vertex() const {
+        return static_cast<GLint>(first_vertex);
+    }
+    inline const void* index_pointer() const {
+        return reinterpret_cast<const void*>(index_offset * sizeof(uint32_t));
+    }
+private:
+    friend class geometry_arena;
+    size_t slot = 0;
+};
+
+// Shared vertex and index buffers for every mesh of one vertex layout, drawn with base vertex
+// draws through a single VAO so the render queue does not switch VAOs between meshes.
+// Full buffers grow by copying into bigger ones on the GPU, arenas that are mostly holes after
+// meshes went away get compacted by maintain().  GL thread only.
+class geometry_arena {
+public:
+    static geometry_arena& get(VertexLayout layout);
+    // copies the data in, vertex_data is vertex_count vertices in this arena's layout.
+    geometry_range* allocate(const void* vertex_data, size_t vertex_count, const void* index_data, size_t index_bytes);
+    static void release(geometry_range* range);
+    // moves every range to the front and shrinks the buffers to what is used plus some slack.
+    void defragment();
+    static void defragment_all();
+    // defragments the arenas where more than half the capacity sits in holes, cheap enough for every frame.
+    static void maintain();
+    static geometry_arena_stats get_stats();
+
+    const VertexLayout layout;
+    const size_t stride;
+    GLuint gl_VAO = 0;
+    // the GL objects are left to the context, arenas live until exit.
+    geometry_arena(const geometry_arena&) = delete;
+    geometry_arena& operator=(const geometry_arena&) = delete;
+private:
+    geometry_arena(VertexLayout layout);
+    // copies the first used_bytes of buffer into a new buffer of new_bytes.
+    static void resize_buffer(GLuint& buffer, size_t used_bytes, size_t new_bytes);
+    // points the VAO at the current buffers.
+    void attach_buffers();
+    bool fragmented() const;
+
+    GLuint gl_VBO = 0, gl_EBO = 0;
+    range_allocator vertex_ranges, index_ranges;
+    vector<std::unique_ptr<geometry_range>> ranges;
+
+    static constexpr size_t initial_vertices = size_t(1) << 16;
+    static constexpr size_t initial_index_units = size_t(1) << 18;
+    static constexpr size_t layout_count = 5;
+    static inline std::unique_ptr<geometry_arena> arenas[layout_count];
+    static inline size_t grows = 0;
+    static inline size_t defragmentations = 0;
+};
@@ -0,0 +1,240 @@
+#include "JobSystem.h"
+#include <stdexcept>
+#include <string>
+
+// index of the calling thread's deque, 0 for threads that are not workers.
+static thread_local size_t current_queue = 0;
+
+void job::depends_on(job& dependency) {
+    if (this->submitted.load() || dependency.submitted.load())
+        throw std::runtime_error("Job dependencies have to be added before the jobs are submitted.");
+    this->pending.fetch_add(1);
+    dependency.dependents.push_back(this);
+}
+
+job_system& job_system::get() {
+    static job_system instance;
+    return instance;
+}
+
+job_system::job_system() {
+    unsigned int hardware = std::thread::hardware_concurrency();
+    this->start_workers(hardware > 1 ? hardware - 1 : 0);
+}
+
+job_system::~job_system() {
+    this->stop_workers();
+}
+
+void job_system::set_worker_count(size_t count) {
+    if (count == this->workers.size())
+        return;
+    this->stop_workers();
+    this->start_workers(count);
+}
+
+void job_system::start_workers(size_t count) {
+    this->queues.clear();
+    for (size_t i = 0; i < count + 1; i++)
+        this->queues.push_back(std::make_unique<job_queue>());
+    this->running = true;
+    for (size_t i = 0; i < count; i++)
+        this->workers.emplace_back(&job_system::worker_main, this, i + 1);
+}
+
+void job_system::stop_workers() {
+    {
+        std::lock_guard<std::mutex> lock(this->sleep_mutex);
+        this->running = false;
+    }
+    this->wake.notify_all();
+    for (std::thread& worker : this->workers)
+        worker.join();
+    this->workers.clear();
+}
+
+void job_system::worker_main(size_t queue_index) {
+    current_queue = queue_index;
+    while (this->running.load()) {
+        if (job* j = this->find_job()) {
+            this->execute(j);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(this->sleep_mutex);
+        this->wake.wait(lock, [this]() {
+            return !this->running.load() || this->queued.load() > 0;
+        });
+    }
+}
+
+void job_system::submit(job& j) {
+    if (j.submitted.exchange(true))
+        throw std::runtime_error("A job can only be submitted once.");
+    if (j.pending.fetch_sub(1) == 1)
+        this->push(&j);
+}
+
+void job_system::push(job* j) {
+    job_queue& queue = *this->queues[std::min(current_queue, this->queues.size() - 1)];
+    {
+        // counted first so queued never drops below the number of jobs in the deques,
+        // under the lock so a worker can not miss the wake up between its check and its wait.
+        std::lock_guard<std::mutex> lock(this->sleep_mutex);
+        this->queued.fetch_add(1);
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(j);
+    }
+    this->wake.notify_one();
+}
+
+job* job_system::find_job() {
+    size_t count = this->queues.size();
+    size_t own = std::min(current_queue, count - 1);
+    {
+        job_queue& queue = *this->queues[own];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+            job* j = queue.jobs.back();
+            queue.jobs.pop_back();
+            this->queued.fetch_sub(1);
+            return j;
+        }
+    }
+    // steal the oldest job of the next busy thread.
+    for (size_t i = 1; i < count; i++) {
+        job_queue& queue = *this->queues[(own + i) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+            job* j = queue.jobs.front();
+            queue.jobs.pop_front();
+            this->queued.fetch_sub(1);
+            return j;
+        }
+    }
+    return nullptr;
+}
+
+void job_system::execute(job* j) {
+    try {
+        if (j->work)
+            j->work();
+    } catch (...) {
+        j->error = std::current_exception();
+    }
+    // finished before any dependent can run, so waiting on the last job of a chain covers all of them.
+    // The owner may destroy the job as soon as done is set, so its dependents are taken first.
+    vector<job*> dependents = std::move(j->dependents);
+    j->done.store(true, std::memory_order_release);
+    for (job* dependent : dependents)
+        if (dependent->pending.fetch_sub(1) == 1)
+            this->push(dependent);
+}
+
+void job_system::wait(job& j) {
+    if (!j.submitted.load())
+        throw std::runtime_error("Waiting on a job that was never submitted.");
+    while (!j.finished()) {
+        if (job* other = this->find_job())
+            this->execute(other);
+        else
+            std::this_thread::yield();
+    }
+    if (j.error)
+        std::rethrow_exception(j.error);
+}
+
+namespace {
+    void expect(bool condition, const std::string& what) {
+        if (!condition)
+            throw std::runtime_error("job_system self test failed: " + what);
+    }
+
+    void test_parallel_for(job_system& jobs, size_t workers) {
+        const size_t counts[] = {1, 7, 64, 1000};
+        const size_t grains[] = {0, 1, 3, 64, 5000};
+        for (size_t count : counts) {
+            for (size_t grain : grains) {
+                std::unique_ptr<std::atomic<int>[]> visits(new std::atomic<int>[count]);
+                for (size_t i = 0; i < count; i++)
+                    visits[i] = 0;
+                std::thread::id caller = std::this_thread::get_id();
+                std::atomic<bool> off_caller{false}, out_of_order{false};
+                size_t next = 0;
+                jobs.parallel_for(count, grain, [&](size_t begin, size_t end) {
+                    if (std::this_thread::get_id() != caller)
+                        off_caller = true;
+                    if (workers == 0) {
+                        if (begin != next)
+                            out_of_order = true;
+                        next = end;
+                    }
+                    if (begin >= end || end - begin > std::max<size_t>(grain, 1))
+                        out_of_order = true;
+                    for (size_t i = begin; i < end; i++)
+                        visits[i]++;
+                });
+                std::string where = std::to_string(count) + " items, grain " + std::to_string(grain) + ", " + std::to_string(workers) + " workers";
+                for (size_t i = 0; i < count; i++)
+                    expect(visits[i] == 1, "index " + std::to_string(i) + " ran " + std::to_string(visits[i].load()) + " times, " + where);
+                expect(!out_of_order, "chunks out of order or over grain, " + where);
+                if (workers == 0)
+                    expect(!off_caller || count == 0, "a chunk left the calling thread, " + where);
+            }
+        }
+        // nothing to do still returns without calling body.
+        bool called = false;
+        jobs.parallel_for(0, 1, [&](size_t, size_t) { called = true; });
+        expect(!called, "parallel_for over 0 items called its body");
+    }
+
+    void test_dependencies(job_system& jobs, size_t workers) {
+        // a chain of jobs submitted last to first still has to run first to last.
+        const size_t length = 32;
+        std::atomic<size_t> ran{0};
+        vector<size_t> order(length, 0);
+        std::unique_ptr<job[]> chain(new job[length]);
+        for (size_t i = 0; i < length; i++)
+            chain[i].work = [&, i]() { order[i] = ran++; };
+        for (size_t i = 1; i < length; i++)
+            chain[i].depends_on(chain[i - 1]);
+        for (size_t i = length; i-- > 0;)
+            jobs.submit(chain[i]);
+        jobs.wait(chain[length - 1]);
+        for (size_t i = 0; i < length; i++)
+            expect(chain[i].finished() && order[i] == i, "job " + std::to_string(i) + " of a dependency chain ran out of order with " + std::to_string(workers) + " workers");
+
+        // errors reach the caller.  With workers the other chunks are already queued and still run,
+        // without them the in order loop stops at the throwing chunk.
+        std::atomic<int> chunks{0};
+        bool threw = false;
+        try {
+            jobs.parallel_for(8, 1, [&](size_t begin, size_t) {
+                chunks++;
+                if (begin == 3)
+                    throw std::runtime_error("expected");
+            });
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        expect(threw, "a throwing chunk was lost with " + std::to_string(workers) + " workers");
+        expect(chunks == (workers ? 8 : 4), "a throwing chunk ran " + std::to_string(chunks.load()) + " of 8 chunks with " + std::to_string(workers) + " workers");
+    }
+}
+
+void job_system::self_test() {
+    job_system& jobs = job_system::get();
+    size_t workers = jobs.get_worker_count();
+    try {
+        for (size_t count : {0, 1, 2, 4}) {
+            jobs.set_worker_count(count);
+            test_parallel_for(jobs, count);
+            test_dependencies(jobs, count);
+        }
+    } catch (...) {
+        jobs.set_worker_count(workers);
+        throw;
+    }
+    jobs.set_worker_count(workers);
+}
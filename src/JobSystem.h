@@ -0,0 +1,123 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <algorithm>
+#include <cstddef>
+
+using std::vector;
+
+// A unit of work for the job_system.  Jobs are owned by whoever submits them
+// and have to outlive the wait() for them, they are not reusable.
+class job {
+public:
+    job() {}
+    job(std::function<void()> work) : work(std::move(work)) {}
+    job(const job&) = delete;
+    job& operator=(const job&) = delete;
+
+    // holds this job back until dependency finished, call it before either job is submitted.
+    void depends_on(job& dependency);
+
+    inline bool finished() const {
+        return done.load(std::memory_order_acquire);
+    }
+
+    std::function<void()> work;
+private:
+    friend class job_system;
+    // unfinished dependencies, plus one until the job is submitted.
+    std::atomic<int> pending{1};
+    std::atomic<bool> submitted{false};
+    std::atomic<bool> done{false};
+    vector<job*> dependents;
+    std::exception_ptr error;
+};
+
+// Work stealing scheduler for engine side frame work.
+// Every thread owns a deque, it pushes and pops its own jobs at the back while idle
+// threads steal from the front of the others.  Threads that are not workers, like the
+// one owning the GL context, share the first deque and help out while they wait().
+// With zero workers every job runs on the waiting thread, in a fixed order.
+class job_system {
+public:
+    // the engine wide scheduler, starts one worker less than there are hardware threads.
+    static job_system& get();
+    ~job_system();
+
+    // joins the current workers and starts count new ones, only call it while no jobs are in flight.
+    void set_worker_count(size_t count);
+    inline size_t get_worker_count() const {
+        return workers.size();
+    }
+
+    // checks parallel_for visits every index once with 0, 1, 2 and 4 workers, that it runs chunks in order on the
+    // caller without workers and that dependencies finish first.  Restores the worker count, throws on a mismatch.
+    static void self_test();
+
+    void submit(job& j);
+    // runs queued jobs on this thread until j finished, rethrows what j threw.
+    void wait(job& j);
+
+    // calls body(begin, end) over [0, count) in chunks of at most grain items and returns once all of them ran.
+    // Chunks run in order on the calling thread when there are no workers.
+    template<typename F>
+    void parallel_for(size_t count, size_t grain, F&& body) {
+        if (count == 0)
+            return;
+        grain = std::max<size_t>(grain, 1);
+        size_t chunks = (count + grain - 1) / grain;
+        if (chunks == 1 || this->workers.empty()) {
+            for (size_t begin = 0; begin < count; begin += grain)
+                body(begin, std::min(begin + grain, count));
+            return;
+        }
+        std::unique_ptr<job[]> jobs(new job[chunks]);
+        for (size_t c = 0; c < chunks; c++) {
+            size_t begin = c * grain, end = std::min(begin + grain, count);
+            jobs[c].work = [&body, begin, end]() { body(begin, end); };
+            this->submit(jobs[c]);
+        }
+        // the newest chunks sit at the back of this thread's deque, so waiting from the back runs them without stealing.
+        std::exception_ptr error;
+        for (size_t c = chunks; c-- > 0;) {
+            try {
+                this->wait(jobs[c]);
+            } catch (...) {
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+private:
+    job_system();
+
+    struct job_queue {
+        std::mutex mutex;
+        std::deque<job*> jobs;
+    };
+
+    void start_workers(size_t count);
+    void stop_workers();
+    void worker_main(size_t queue_index);
+    void push(job* j);
+    job* find_job();
+    void execute(job* j);
+
+    // queue 0 is shared by every thread that is not a worker.
+    vector<std::unique_ptr<job_queue>> queues;
+    vector<std::thread> workers;
+    std::atomic<size_t> queued{0};
+    std::atomic<bool> running{false};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+};
@@ -0,0 +1,342 @@
+#include "LightClusters.h"
+#include "JobSystem.h"
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOXOC_CLUSTER_SSE
+#include <emmintrin.h>
+#endif
+
+float light_clusters::attenuation_range(float constant, float linear, float quadratic) {
+    // solve quadratic*d^2 + linear*d + (constant - 1/threshold) = 0 for the positive root.
+    float c = constant - 1.0f / static_cast<float>(ATTENUATION_THRESHOLD);
+    if (c >= 0.0f)
+        return 0.0f;
+    if (quadratic <= 0.0f)
+        return linear > 0.0f ? -c / linear : INFINITY;
+    return (-linear + std::sqrt(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic);
+}
+
+void light_clusters::set_projection(float fov_y, float aspect, float z_near, float z_far) {
+    if (!this->bounds.empty() && fov_y == this->fov_y && aspect == this->aspect && z_near == this->z_near && z_far == this->z_far)
+        return;
+    this->fov_y = fov_y;
+    this->aspect = aspect;
+    this->z_near = z_near;
+    this->z_far = z_far;
+
+    float tan_y = std::tan(fov_y * 0.5f);
+    float tan_x = tan_y * aspect;
+    float log_ratio = std::log(z_far / z_near);
+    this->slice_scale = DIM_Z / log_ratio;
+    this->slice_bias = DIM_Z * std::log(z_near) / log_ratio;
+
+    this->bounds.resize(CLUSTER_COUNT);
+    this->slice_near.resize(DIM_Z);
+    this->slice_far.resize(DIM_Z);
+
+    for (uint32_t z = 0; z < DIM_Z; z++) {
+        // exponential slices keep the clusters roughly cube shaped with distance.
+        float d_near = z_near * std::pow(z_far / z_near, static_cast<float>(z) / DIM_Z);
+        float d_far = z_near * std::pow(z_far / z_near, static_cast<float>(z + 1) / DIM_Z);
+        this->slice_near[z] = d_near;
+        this->slice_far[z] = d_far;
+        for (uint32_t y = 0; y < DIM_Y; y++) {
+            float ny0 = -1.0f + 2.0f * y / DIM_Y, ny1 = -1.0f + 2.0f * (y + 1) / DIM_Y;
+            for (uint32_t x = 0; x < DIM_X; x++) {
+                float nx0 = -1.0f + 2.0f * x / DIM_X, nx1 = -1.0f + 2.0f * (x + 1) / DIM_X;
+                cluster_bounds& b = this->bounds[cluster_index(x, y, z)];
+                // the tile edges are lines through the eye, so the extremes sit on the near or far face.
+                b.min[0] = std::min({nx0 * d_near, nx0 * d_far}) * tan_x;
+                b.max[0] = std::max({nx1 * d_near, nx1 * d_far}) * tan_x;
+                b.min[1] = std::min({ny0 * d_near, ny0 * d_far}) * tan_y;
+                b.max[1] = std::max({ny1 * d_near, ny1 * d_far}) * tan_y;
+                b.min[2] = -d_far;
+                b.max[2] = -d_near;
+                float radius_sq = 0.0f;
+                for (int a = 0; a < 3; a++) {
+                    b.center[a] = (b.min[a] + b.max[a]) * 0.5f;
+                    float half = (b.max[a] - b.min[a]) * 0.5f;
+                    radius_sq += half * half;
+                }
+                b.radius = std::sqrt(radius_sq);
+            }
+        }
+    }
+}
+
+uint32_t light_clusters::slice_of(float depth) const {
+    float slice = std::floor(std::log(std::max(depth, this->z_near)) * this->slice_scale - this->slice_bias);
+    return static_cast<uint32_t>(std::clamp(slice, 0.0f, static_cast<float>(DIM_Z - 1)));
+}
+
+void light_clusters::sphere_soa::clear() {
+    this->x.clear();
+    this->y.clear();
+    this->z.clear();
+    this->radius_sq.clear();
+    this->index.clear();
+}
+
+void light_clusters::sphere_soa::push(float x, float y, float z, float radius, uint32_t index) {
+    this->x.push_back(x);
+    this->y.push_back(y);
+    this->z.push_back(z);
+    this->radius_sq.push_back(radius * radius);
+    this->index.push_back(index);
+}
+
+void light_clusters::sphere_soa::pad() {
+    // a negative squared radius never passes the overlap test.
+    while (this->x.size() % 4) {
+        this->push(0.0f, 0.0f, 0.0f, 0.0f, 0);
+        this->radius_sq.back() = -1.0f;
+    }
+}
+
+template<typename F>
+void light_clusters::for_each_overlap(const sphere_soa& spheres, const cluster_bounds& b, F&& on_hit) {
+#ifdef LOXOC_CLUSTER_SSE
+    size_t count = spheres.x.size();
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 min_x = _mm_set1_ps(b.min[0]), max_x = _mm_set1_ps(b.max[0]);
+    const __m128 min_y = _mm_set1_ps(b.min[1]), max_y = _mm_set1_ps(b.max[1]);
+    const __m128 min_z = _mm_set1_ps(b.min[2]), max_z = _mm_set1_ps(b.max[2]);
+    for (size_t i = 0; i < count; i += 4) {
+        __m128 cx = _mm_loadu_ps(&spheres.x[i]);
+        __m128 cy = _mm_loadu_ps(&spheres.y[i]);
+        __m128 cz = _mm_loadu_ps(&spheres.z[i]);
+        // distance from each center to the box along every axis, zero inside.
+        __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(min_x, cx), _mm_sub_ps(cx, max_x)), zero);
+        __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(min_y, cy), _mm_sub_ps(cy, max_y)), zero);
+        __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(min_z, cz), _mm_sub_ps(cz, max_z)), zero);
+        __m128 dist_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        int mask = _mm_movemask_ps(_mm_cmple_ps(dist_sq, _mm_loadu_ps(&spheres.radius_sq[i])));
+        for (int lane = 0; mask; lane++, mask >>= 1)
+            if (mask & 1)
+                on_hit(i + lane);
+    }
+#else
+    for_each_overlap_scalar(spheres, b, on_hit);
+#endif
+}
+
+template<typename F>
+void light_clusters::for_each_overlap_scalar(const sphere_soa& spheres, const cluster_bounds& b, F&& on_hit) {
+    for (size_t i = 0; i < spheres.x.size(); i++) {
+        float dx = std::max({b.min[0] - spheres.x[i], spheres.x[i] - b.max[0], 0.0f});
+        float dy = std::max({b.min[1] - spheres.y[i], spheres.y[i] - b.max[1], 0.0f});
+        float dz = std::max({b.min[2] - spheres.z[i], spheres.z[i] - b.max[2], 0.0f});
+        if (dx * dx + dy * dy + dz * dz <= spheres.radius_sq[i])
+            on_hit(i);
+    }
+}
+
+void light_clusters::build(const vector<cluster_light_sphere>& point_lights, const vector<cluster_light_cone>& spot_lights) {
+    this->grid.assign(CLUSTER_COUNT * 2, 0);
+    this->light_indices.clear();
+    if (this->bounds.empty())
+        return;
+
+    size_t point_count = std::min(point_lights.size(), MAX_LIGHTS_PER_TYPE);
+    size_t spot_count = std::min(spot_lights.size(), MAX_LIGHTS_PER_TYPE);
+
+    this->slices.resize(DIM_Z);
+    job_system::get().parallel_for(DIM_Z, 1, [&](size_t begin, size_t end) {
+        for (size_t z = begin; z < end; z++)
+            this->build_slice(static_cast<uint32_t>(z), point_lights, spot_lights, point_count, spot_count);
+    });
+
+    // concatenate the slices, clusters past max_light_indices lose their lights.
+    bool truncated = false;
+    for (uint32_t z = 0; z < DIM_Z; z++) {
+        size_t base = this->light_indices.size();
+        for (uint32_t cluster = cluster_index(0, 0, z); cluster < cluster_index(0, 0, z + 1); cluster++) {
+            size_t offset = base + this->grid[cluster * 2];
+            uint32_t cluster_points = this->grid[cluster * 2 + 1] & 0xFFFF;
+            uint32_t cluster_spots = this->grid[cluster * 2 + 1] >> 16;
+            size_t available = offset < this->max_light_indices ? this->max_light_indices - offset : 0;
+            if (cluster_points + cluster_spots > available) {
+                truncated = true;
+                // spot indices follow the point indices, so they can only stay if every point does.
+                if (cluster_points > available) {
+                    cluster_points = static_cast<uint32_t>(available);
+                    cluster_spots = 0;
+                } else {
+                    cluster_spots = static_cast<uint32_t>(available - cluster_points);
+                }
+            }
+            this->grid[cluster * 2] = static_cast<uint32_t>(std::min(offset, this->max_light_indices));
+            this->grid[cluster * 2 + 1] = cluster_points | (cluster_spots << 16);
+        }
+        const vector<uint16_t>& slice_indices = this->slices[z].light_indices;
+        size_t room = base < this->max_light_indices ? this->max_light_indices - base : 0;
+        this->light_indices.insert(this->light_indices.end(), slice_indices.begin(), slice_indices.begin() + std::min(room, slice_indices.size()));
+    }
+
+    if (truncated && !this->overflowed) {
+        std::cerr << "WARNING: light cluster index list is full, some lights were dropped.\n";
+        this->overflowed = true;
+    }
+}
+
+void light_clusters::build_slice(uint32_t z, const vector<cluster_light_sphere>& point_lights, const vector<cluster_light_cone>& spot_lights, size_t point_count, size_t spot_count) {
+    slice_scratch& slice = this->slices[z];
+    float d_near = this->slice_near[z], d_far = this->slice_far[z];
+
+    // only lights overlapping the slice depth range are tested against its tiles.
+    slice.point_candidates.clear();
+    for (size_t i = 0; i < point_count; i++) {
+        const cluster_light_sphere& l = point_lights[i];
+        if (-l.z + l.radius >= d_near && -l.z - l.radius <= d_far)
+            slice.point_candidates.push(l.x, l.y, l.z, l.radius, i);
+    }
+    slice.point_candidates.pad();
+
+    slice.spot_candidates.clear();
+    for (size_t i = 0; i < spot_count; i++) {
+        const cluster_light_cone& l = spot_lights[i];
+        if (-l.z + l.range >= d_near && -l.z - l.range <= d_far)
+            slice.spot_candidates.push(l.x, l.y, l.z, l.range, i);
+    }
+    slice.spot_candidates.pad();
+
+    slice.light_indices.clear();
+    for (uint32_t y = 0; y < DIM_Y; y++) {
+        for (uint32_t x = 0; x < DIM_X; x++) {
+            uint32_t cluster = cluster_index(x, y, z);
+            const cluster_bounds& b = this->bounds[cluster];
+            size_t offset = slice.light_indices.size();
+            uint32_t cluster_points = 0, cluster_spots = 0;
+
+            for_each_overlap(slice.point_candidates, b, [&](size_t c) {
+                slice.light_indices.push_back(static_cast<uint16_t>(slice.point_candidates.index[c]));
+                cluster_points++;
+            });
+
+            for_each_overlap(slice.spot_candidates, b, [&](size_t c) {
+                // the range sphere passed, reject clusters outside the cone using their bounding sphere.
+                const cluster_light_cone& l = spot_lights[slice.spot_candidates.index[c]];
+                float vx = b.center[0] - l.x, vy = b.center[1] - l.y, vz = b.center[2] - l.z;
+                float v_len_sq = vx * vx + vy * vy + vz * vz;
+                float v_axis = vx * l.axis_x + vy * l.axis_y + vz * l.axis_z;
+                float closest = l.cos_angle * std::sqrt(std::max(v_len_sq - v_axis * v_axis, 0.0f)) - v_axis * l.sin_angle;
+                if (closest > b.radius || v_axis > b.radius + l.range || v_axis < -b.radius)
+                    return;
+                slice.light_indices.push_back(static_cast<uint16_t>(slice.spot_candidates.index[c]));
+                cluster_spots++;
+            });
+
+            // offsets are relative to the slice until build() merges the slices.
+            this->grid[cluster * 2] = static_cast<uint32_t>(offset);
+            this->grid[cluster * 2 + 1] = cluster_points | (cluster_spots << 16);
+        }
+    }
+}
+
+namespace {
+
+void expect(bool condition, const std::string& what) {
+    if (!condition)
+        throw std::runtime_error("Light cluster self test failed: " + what + ".");
+}
+
+// the point (or spot) indices binned into cluster.
+vector<uint16_t> cluster_lights(const light_clusters& clusters, uint32_t cluster, bool spots) {
+    uint32_t offset = clusters.grid[cluster * 2];
+    uint32_t points = clusters.grid[cluster * 2 + 1] & 0xFFFF;
+    uint32_t spot_count = clusters.grid[cluster * 2 + 1] >> 16;
+    auto first = clusters.light_indices.begin() + offset + (spots ? points : 0);
+    return vector<uint16_t>(first, first + (spots ? spot_count : points));
+}
+
+bool cluster_has(const light_clusters& clusters, uint32_t cluster, bool spots, uint16_t light) {
+    vector<uint16_t> lights = cluster_lights(clusters, cluster, spots);
+    return std::find(lights.begin(), lights.end(), light) != lights.end();
+}
+
+} // namespace
+
+void light_clusters::self_test() {
+    const float fov_y = 1.0471976f, aspect = 16.0f / 9.0f;
+    light_clusters clusters;
+    clusters.set_projection(fov_y, aspect, 0.1f, 100.0f);
+
+    // in view space, the camera looks down -z.
+    vector<cluster_light_sphere> points = {
+        {0.0f, 0.0f, -10.0f, 0.5f},
+        {3.0f, -1.0f, -30.0f, 2.0f},
+        {-50.0f, 0.0f, -5.0f, 1.0f}, // far off to the left, outside the frustum
+    };
+    float spot_angle = 0.17453292f;
+    vector<cluster_light_cone> spots = {
+        {0.0f, 0.0f, 0.0f, 20.0f, 0.0f, 0.0f, -1.0f, std::cos(spot_angle), std::sin(spot_angle)},
+    };
+    clusters.build(points, spots);
+
+    uint32_t slice = clusters.slice_of(10.0f);
+    expect(cluster_has(clusters, cluster_index(DIM_X / 2, DIM_Y / 2, slice), false, 0), "a point light is missing from the cluster around its center");
+    expect(!cluster_has(clusters, cluster_index(0, 0, slice), false, 0), "a point light reached a cluster in the corner of the view");
+    expect(!cluster_has(clusters, cluster_index(DIM_X / 2, DIM_Y / 2, clusters.slice_of(50.0f)), false, 0), "a point light reached a slice behind it");
+    // every cluster holds exactly the point lights whose sphere touches its box, whatever the slice filter skipped.
+    for (uint32_t cluster = 0; cluster < CLUSTER_COUNT; cluster++) {
+        const cluster_bounds& b = clusters.bounds[cluster];
+        for (uint16_t i = 0; i < points.size(); i++) {
+            const cluster_light_sphere& l = points[i];
+            float dx = std::max({b.min[0] - l.x, l.x - b.max[0], 0.0f});
+            float dy = std::max({b.min[1] - l.y, l.y - b.max[1], 0.0f});
+            float dz = std::max({b.min[2] - l.z, l.z - b.max[2], 0.0f});
+            bool overlaps = dx * dx + dy * dy + dz * dz <= l.radius * l.radius;
+            expect(cluster_has(clusters, cluster, false, i) == overlaps, "point light " + std::to_string(i) + " is binned differently from its overlap with cluster " + std::to_string(cluster));
+        }
+    }
+    for (uint32_t cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+        expect(!cluster_has(clusters, cluster, false, 2), "a point light outside the frustum was binned");
+
+    expect(cluster_has(clusters, cluster_index(DIM_X / 2, DIM_Y / 2, slice), true, 0), "a spot light is missing from a cluster on its axis");
+    // inside the range sphere but well outside the 10 degree cone.
+    expect(!cluster_has(clusters, cluster_index(0, 0, slice), true, 0), "a spot light reached a cluster outside its cone");
+    expect(!cluster_has(clusters, cluster_index(DIM_X / 2, DIM_Y / 2, clusters.slice_of(40.0f)), true, 0), "a spot light reached past its range");
+
+    // the SSE2 path has to find the same lights as the scalar one, including the padding lanes.
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> lateral(-40.0f, 40.0f), depth(-110.0f, 0.0f), radius(0.1f, 8.0f);
+    sphere_soa spheres;
+    for (uint32_t i = 0; i < 37; i++)
+        spheres.push(lateral(rng), lateral(rng), depth(rng), radius(rng), i);
+    spheres.pad();
+    for (uint32_t cluster = 0; cluster < CLUSTER_COUNT; cluster++) {
+        vector<size_t> fast, scalar;
+        for_each_overlap(spheres, clusters.bounds[cluster], [&](size_t i) { fast.push_back(i); });
+        for_each_overlap_scalar(spheres, clusters.bounds[cluster], [&](size_t i) { scalar.push_back(i); });
+        expect(fast == scalar, "the SSE2 and scalar overlap tests disagree on cluster " + std::to_string(cluster));
+    }
+
+    // a full index list keeps whole clusters in order and drops the rest.
+    vector<cluster_light_sphere> crowd(40, {0.0f, 0.0f, -10.0f, 5.0f});
+    clusters.build(crowd, {});
+    vector<uint32_t> full_grid = clusters.grid;
+    vector<uint16_t> full_indices = clusters.light_indices;
+    expect(full_indices.size() > 100, "the crowd did not fill more than 100 indices");
+    clusters.max_light_indices = 100;
+    // the overflow warning is expected here.
+    clusters.overflowed = true;
+    clusters.build(crowd, {});
+    expect(clusters.light_indices.size() <= 100, "the index list grew past max_light_indices");
+    for (uint32_t cluster = 0; cluster < CLUSTER_COUNT; cluster++) {
+        uint32_t offset = clusters.grid[cluster * 2];
+        uint32_t count = (clusters.grid[cluster * 2 + 1] & 0xFFFF) + (clusters.grid[cluster * 2 + 1] >> 16);
+        expect(offset + count <= clusters.light_indices.size(), "a truncated cluster points past the index list");
+        uint32_t full_offset = full_grid[cluster * 2];
+        uint32_t full_count = full_grid[cluster * 2 + 1] & 0xFFFF;
+        if (full_offset + full_count <= 100)
+            expect(count == full_count && std::equal(full_indices.begin() + full_offset, full_indices.begin() + full_offset + full_count, clusters.light_indices.begin() + offset), "a cluster that fit lost lights to truncation");
+        for (uint16_t light : cluster_lights(clusters, cluster, false))
+            expect(light < crowd.size(), "truncation left an index to a light that does not exist");
+    }
+}
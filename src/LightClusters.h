@@ -0,0 +1,92 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using std::vector;
+
+// attenuation below which a light is treated as not reaching a surface.
+#define ATTENUATION_THRESHOLD 0.003
+
+// Light volumes are given in view space, the camera looks down -z.
+struct cluster_light_sphere {
+    float x, y, z, radius;
+};
+
+struct cluster_light_cone {
+    float x, y, z, range;
+    float axis_x, axis_y, axis_z; // normalized direction the light shines in
+    float cos_angle, sin_angle; // of the outer cone
+};
+
+// Bins point and spot lights into a grid of view frustum cells (froxels) once per frame.
+// Depth slices are binned in parallel on the job_system.
+// Has no GL or glm dependency so it can be run and checked on the CPU alone.
+class light_clusters {
+public:
+    static constexpr uint32_t DIM_X = 16, DIM_Y = 9, DIM_Z = 24;
+    static constexpr uint32_t CLUSTER_COUNT = DIM_X * DIM_Y * DIM_Z;
+    // light indices are uploaded as 16 bit.
+    static constexpr size_t MAX_LIGHTS_PER_TYPE = 0xFFFF;
+
+    // distance at which 1/(constant + linear*d + quadratic*d^2) drops to ATTENUATION_THRESHOLD.
+    static float attenuation_range(float constant, float linear, float quadratic);
+
+    // recomputes the cluster bounds, returns early when the projection did not change.
+    void set_projection(float fov_y, float aspect, float z_near, float z_far);
+    void build(const vector<cluster_light_sphere>& point_lights, const vector<cluster_light_cone>& spot_lights);
+
+    // bins known lights and checks the clusters they land in, that the SSE2 and scalar overlap tests
+    // agree and that a full index list truncates cleanly.  Throws describing the first mismatch.
+    static void self_test();
+
+    inline static uint32_t cluster_index(uint32_t x, uint32_t y, uint32_t z) {
+        return x + DIM_X * (y + DIM_Y * z);
+    }
+    // depth slice of a positive view depth, the fragment shader does the same math.
+    uint32_t slice_of(float depth) const;
+
+    // two values per cluster: offset into light_indices, point count | spot count << 16
+    vector<uint32_t> grid;
+    // every cluster's point light indices followed by its spot light indices.
+    vector<uint16_t> light_indices;
+    // the index list stops growing past this, set from GL_MAX_TEXTURE_BUFFER_SIZE.
+    size_t max_light_indices = SIZE_MAX;
+    // log(depth) * slice_scale - slice_bias is the depth slice.
+    float slice_scale = 0.0f, slice_bias = 0.0f;
+
+private:
+    struct cluster_bounds {
+        float min[3], max[3];
+        float center[3], radius;
+    };
+
+    // structure of arrays the overlap tests read four lights at a time.
+    struct sphere_soa {
+        vector<float> x, y, z, radius_sq;
+        vector<uint32_t> index;
+        void clear();
+        void push(float x, float y, float z, float radius, uint32_t index);
+        void pad();
+    };
+
+    // what one depth slice produces, kept apart so slices can be binned at the same time.
+    struct slice_scratch {
+        sphere_soa point_candidates, spot_candidates;
+        // the slice's clusters' indices, grid offsets are relative to this until merged.
+        vector<uint16_t> light_indices;
+    };
+
+    template<typename F>
+    static void for_each_overlap(const sphere_soa& spheres, const cluster_bounds& bounds, F&& on_hit);
+    // the same test one light at a time, what for_each_overlap runs without SSE2.
+    template<typename F>
+    static void for_each_overlap_scalar(const sphere_soa& spheres, const cluster_bounds& bounds, F&& on_hit);
+    void build_slice(uint32_t z, const vector<cluster_light_sphere>& point_lights, const vector<cluster_light_cone>& spot_lights, size_t point_count, size_t spot_count);
+
+    vector<cluster_bounds> bounds;
+    vector<float> slice_near, slice_far;
+    float fov_y = 0.0f, aspect = 0.0f, z_near = 0.0f, z_far = 0.0f;
+    vector<slice_scratch> slices;
+    bool overflowed = false;
+};
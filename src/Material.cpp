@@ -1,12 +1,44 @@
 #include "Material.h"
 #include "util.h"
-#include <sstream>
 #include "Texture.h"
 #include "Object3d.h"
+#include <unordered_map>
+#include <algorithm>
+
+static const uniform_id UNIFORM_MATERIAL_AMBIENT = intern_uniform("material.ambient");
+static const uniform_id UNIFORM_MATERIAL_SHINE = intern_uniform("material.shine");
+
+#define INSTANCED_DEFINE "LOXOC_INSTANCED"
+
+// a material holds one reference on each of its textures.
+static inline void assign_texture(rc_texture& slot, rc_texture value) {
+    if (slot == value)
+        return;
+    if (value)
+        value->inc();
+    if (slot)
+        RC_collect(slot);
+    slot = value;
+}
+
+material::~material() {
+    if (this->instanced_variant)
+        RC_collect(this->instanced_variant);
+    if (this->program)
+        RC_collect(this->program);
+    assign_texture(this->diffuse_texture, nullptr);
+    assign_texture(this->specular_texture, nullptr);
+    assign_texture(this->normals_texture, nullptr);
+}
 
 void material::set_uniform(string name, uniform_type value) {
-    int loc = glGetUniformLocation(this->shader_program, name.c_str());
-    this->inner_set_uniform(loc, value);
+    this->set_uniform(intern_uniform(name), value);
+}
+
+void material::set_uniform(uniform_id id, uniform_type value) {
+    GLint loc = this->get_uniform_location(id);
+    if (loc != -1)
+        this->inner_set_uniform(loc, value);
 }
  
 void material::use_material() {
@@ -56,49 +88,56 @@ void TRAIT_has_uniform::register_uniforms() {
 } 
 
 void material::link_shaders() {
-    this->vertex->data->compile();
-    this->fragment->data->compile();
-    if (this->geometry)
-        this->geometry->data->compile();
-    if (this->compute)
-        this->compute->data->compile();
-    this->shader_program = glCreateProgram();
-    glAttachShader(this->shader_program, this->vertex->data->shader_handle);
-    glAttachShader(this->shader_program, this->fragment->data->shader_handle);
-    if (this->geometry)
-        glAttachShader(this->shader_program, this->geometry->data->shader_handle);
-    if (this->compute)
-        glAttachShader(this->shader_program, this->compute->data->shader_handle);
-    
-    glLinkProgram(this->shader_program);
-    
-    // Check for linking errors
-    GLint success;
-    GLchar infoLog[512];
-    glGetProgramiv(this->shader_program, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(this->shader_program, 512, NULL, infoLog);
-        std::stringstream ss;
-        ss << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << "\n";
-        std::cerr << ss.str();
-        throw std::runtime_error(ss.str());
+    RC<gl_program*>* linked = gl_program::get(
+        this->vertex->data,
+        this->fragment->data,
+        this->geometry ? this->geometry->data : nullptr,
+        this->compute ? this->compute->data : nullptr
+    );
+    if (this->program)
+        RC_collect(this->program);
+    this->program = linked;
+    this->shader_program = linked->data->handle;
+    this->has_frame_block = linked->data->has_frame_block;
+    this->has_light_block = linked->data->has_light_block;
+    this->supports_instancing = linked->data->supports_instancing;
+}
+
+RC<material*>* material::get_instanced_variant() {
+    if (!this->instanced_variant) {
+        this->fragment->inc();
+        if (this->geometry)
+            this->geometry->inc();
+        if (this->compute)
+            this->compute->inc();
+        shader* defined = this->vertex->data->with_define(INSTANCED_DEFINE);
+        rc_shader instanced_vertex = shader::shared(defined->source, defined->type);
+        delete defined;
+        this->instanced_variant = new RC(new material(instanced_vertex, this->fragment, this->geometry, this->compute));
+    }
+    material* variant = this->instanced_variant->data;
+    variant->ambient = this->ambient;
+    variant->diffuse = this->diffuse;
+    variant->specular = this->specular;
+    variant->shine = this->shine;
+    assign_texture(variant->diffuse_texture, this->diffuse_texture);
+    assign_texture(variant->specular_texture, this->specular_texture);
+    assign_texture(variant->normals_texture, this->normals_texture);
+    return this->instanced_variant;
+}
+
+void material::forward_uniforms(material* other) const {
+    const auto& location_ids = this->program->data->location_ids;
+    for (const auto& [loc, value] : this->uniforms) {
+        auto it = location_ids.find(loc);
+        if (it != location_ids.end())
+            other->set_uniform(it->second, value);
     }
-    // glDetachShader(this->shader_program, this->vertex_shader.shader_handle);
-    // glDetachShader(this->shader_program, this->fragment_shader.shader_handle);
-    glDeleteShader(this->vertex->data->shader_handle);
-    glDeleteShader(this->fragment->data->shader_handle);
-    if (this->geometry)
-        glDeleteShader(this->geometry->data->shader_handle);
-    if (this->compute)
-        glDeleteShader(this->compute->data->shader_handle);
 }
 
 void material::set_material() {
-    string prefix = "material.";
     // set struct parameters
-    
-    GLuint ambient_loc = glGetUniformLocation(this->shader_program, (prefix + "ambient").c_str());
-    glUniform3fv(ambient_loc, 1, glm::value_ptr(this->ambient.axis));
+    glUniform3fv(this->get_uniform_location(UNIFORM_MATERIAL_AMBIENT), 1, glm::value_ptr(this->ambient.axis));
     
     if (this->diffuse_texture) {
         glActiveTexture(GL_TEX_N_ITTER[0]);
@@ -110,43 +149,34 @@ void material::set_material() {
         this->specular_texture->data->bind();
     }
     
-    
-    GLuint shine_loc = glGetUniformLocation(this->shader_program, (prefix + "shine").c_str());
-    glUniform1f(shine_loc, this->shine);
+    glUniform1f(this->get_uniform_location(UNIFORM_MATERIAL_SHINE), this->shine);
 }
 
-void material::set_material_fallback(const RC<material*>* obj_mat, bool has_diffuse, bool has_specular, bool has_normal, bool use_default_material_properties) {
-    string prefix = "material.";
-    // set struct parameters
+void material::set_material_fallback(const RC<material*>* obj_mat, bool has_diffuse, bool has_specular, bool has_normal, bool use_default_material_properties, gl_state_tracker& state) {
+    // set struct parameters, the object's program is the one that is bound.
+    GLint ambient_loc = obj_mat->data->get_uniform_location(UNIFORM_MATERIAL_AMBIENT);
     if (use_default_material_properties) {
-        GLuint ambient_loc = glGetUniformLocation(this->shader_program, (prefix + "ambient").c_str());
         glUniform3fv(ambient_loc, 1, glm::value_ptr(this->ambient.axis));
     } else {
-        GLuint ambient_loc = glGetUniformLocation(obj_mat->data->shader_program, (prefix + "ambient").c_str());
         glUniform3fv(ambient_loc, 1, glm::value_ptr(obj_mat->data->ambient.axis));
     }
     
     if (has_diffuse) {
-        glActiveTexture(GL_TEX_N_ITTER[0]);
-        obj_mat->data->diffuse_texture->data->bind();
+        state.bind_texture(0, obj_mat->data->diffuse_texture->data->gl_texture);
     } else {
-        glActiveTexture(GL_TEX_N_ITTER[0]);
-        this->diffuse_texture->data->bind();
+        state.bind_texture(0, this->diffuse_texture->data->gl_texture);
     }
     
     if (has_specular) {
-        glActiveTexture(GL_TEX_N_ITTER[1]);
-        obj_mat->data->specular_texture->data->bind();
+        state.bind_texture(1, obj_mat->data->specular_texture->data->gl_texture);
     } else if (this->specular_texture != nullptr) {
-        glActiveTexture(GL_TEX_N_ITTER[1]);
-        this->specular_texture->data->bind();
+        state.bind_texture(1, this->specular_texture->data->gl_texture);
     }
     
+    GLint shine_loc = obj_mat->data->get_uniform_location(UNIFORM_MATERIAL_SHINE);
     if (use_default_material_properties) {
-        GLuint shine_loc = glGetUniformLocation(this->shader_program, (prefix + "shine").c_str());
         glUniform1f(shine_loc, this->shine);
     } else {
-        GLuint shine_loc = glGetUniformLocation(obj_mat->data->shader_program, (prefix + "shine").c_str());
         glUniform1f(shine_loc, obj_mat->data->shine);
     }
 
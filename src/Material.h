@@ -1,5 +1,6 @@
 #pragma once
 #include "Shader.h"
+#include "GLProgram.h"
 #include <map>
 #include <variant>
 #include "glad/gl.h"
@@ -7,12 +8,15 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include "RC.h"
 #include "Vec2.h"
 #include "Vec3.h"
 #include "Vec4.h"
 #include "Matrix.h"
 #include "Texture.h"
+#include "UniformBuffer.h"
+#include "RenderQueue.h"
 
 using std::string;
 using std::map;
@@ -46,34 +50,52 @@ protected:
     void inner_set_uniform(int loc, uniform_type value);
 };
 
-typedef RC<texture*>* rc_texture;
-typedef RC<shader*>* rc_shader;
 
 class material : public TRAIT_has_uniform {
 public:
     
-    material(rc_shader vertex, rc_shader fragment, rc_shader geometry = nullptr, rc_shader compute = nullptr)
+    // link = false leaves linking to a later link_shaders() call on the GL thread, for loaders.
+    material(rc_shader vertex, rc_shader fragment, rc_shader geometry = nullptr, rc_shader compute = nullptr, bool link = true)
     : vertex(vertex), fragment(fragment), geometry(geometry), compute(compute)
     {
-        this->link_shaders();
+        if (link)
+            this->link_shaders();
     }
 
-    ~material(){}
+    ~material();
     void set_uniform(string name, uniform_type value);
+    void set_uniform(uniform_id id, uniform_type value);
     void link_shaders();
 
+    // Returns -1 when the uniform is not active in the linked program.
+    inline GLint get_uniform_location(uniform_id id) const {
+        return program->data->get_uniform_location(id);
+    }
+
+    inline GLint get_uniform_location(const string& name) const {
+        return get_uniform_location(intern_uniform(name));
+    }
+
     // calls use shader program
     void use_material();
 
     void set_material();
 
-    void set_material_fallback(const RC<material*>* obj_mat, bool has_diffuse, bool has_specular, bool has_normal, bool use_default_material_properties);
+    // Same shaders linked with LOXOC_INSTANCED defined in the vertex stage, built on first use.
+    // Its material properties and textures are synced from this material on every call.
+    RC<material*>* get_instanced_variant();
+    // copies this material's pending uniforms onto another program by name.
+    void forward_uniforms(material* other) const;
+
+    void set_material_fallback(const RC<material*>* obj_mat, bool has_diffuse, bool has_specular, bool has_normal, bool use_default_material_properties, gl_state_tracker& state);
 
     rc_shader vertex = nullptr;
     rc_shader fragment = nullptr;
     rc_shader geometry = nullptr;
     rc_shader compute = nullptr;
-    GLuint shader_program;
+    // shared with every material linked from the same sources, see gl_program::get.
+    RC<gl_program*>* program = nullptr;
+    GLuint shader_program = 0;
     string name;
     vec3 ambient = vec3(0.1f, 0.1f, 0.1f);
     vec3 diffuse = vec3(1.0f, 1.0f, 1.0f);
@@ -83,6 +105,15 @@ public:
     rc_texture diffuse_texture = nullptr;
     rc_texture specular_texture = nullptr;
     rc_texture normals_texture = nullptr;
+    // files the importer took the textures from, kept so imported models can be cooked.
+    string diffuse_file, specular_file, normals_file;
+
+    // copied from the program when linking.
+    bool has_frame_block = false;
+    bool has_light_block = false;
+    bool supports_instancing = false;
+private:
+    RC<material*>* instanced_variant = nullptr;
 };
 
 typedef RC<material*>* rc_material;
\ No newline at end of file
@@ -9,20 +9,63 @@
 #include <sstream>
 #include "Model.h"
 #include "Animation.h"
+#include "CookedModel.h"
 
 
 string fix_texture_path(string file_path, string file) {
     return std::filesystem::absolute(std::filesystem::path(str_tool::rem_file_from_path(file_path) + "/textures/" + str_tool::rem_path_from_file(file))).string();
 }
 
-void mesh::process_node(rc_model model, aiNode* node, const aiScene* scene, rc_mesh_dict last_mesh_dict, const aiMatrix4x4& transform, string file_path) {
+void mesh::stage_default_program(rc_material mat, bool animated, gl_task_list& gl_tasks) {
+    // the default shaders are shared, so every submesh material ends up on the same cached program.
+    // They are looked up and linked on the GL thread, together with the other shared resources.
+    string vertex_path = get_mod_path() + (animated ? "/default_vertex_animated.glsl" : "/default_vertex.glsl");
+    gl_tasks.push_back([mat, vertex_path]() {
+        mat->data->vertex = shader::shared_from_file(vertex_path, ShaderType::VERTEX);
+        mat->data->fragment = shader::shared_from_file(get_mod_path() + "/default_fragment.glsl", ShaderType::FRAGMENT);
+        mat->data->link_shaders();
+    });
+}
+
+void mesh::stage_texture(rc_material mat, rc_texture material::* slot, string material::* file_slot, const string& texture_path, gl_task_list& gl_tasks) {
+    std::shared_ptr<decoded_image> decoded;
+    try {
+        decoded = texture_cache::prefetch(texture_path, TextureWraping::REPEAT, TextureFiltering::LINEAR);
+    } catch ( std::runtime_error e ) {
+        std::cerr << e.what();
+        return;
+    }
+    mat->data->*file_slot = texture_path;
+    gl_tasks.push_back([mat, slot, texture_path, decoded]() {
+        rc_texture loaded = texture_cache::get(texture_path, TextureWraping::REPEAT, TextureFiltering::LINEAR, decoded);
+        rc_texture& target = mat->data->*slot;
+        if (target)
+            RC_collect(target);
+        target = loaded;
+    });
+}
+
+void mesh::stage_missing_texture(rc_material mat, gl_task_list& gl_tasks) {
+    // insert default texture when no diffuse map was loaded. TODO add logic to allow for mesh color
+    string missing_path = get_mod_path() + "/MissingTexture.jpg";
+    std::shared_ptr<decoded_image> missing = mat->data->diffuse_file.empty()
+        ? texture_cache::prefetch(missing_path, TextureWraping::REPEAT, TextureFiltering::LINEAR)
+        : nullptr;
+    gl_tasks.push_back([mat, missing_path, missing]() {
+        if (mat->data->diffuse_texture == nullptr)
+            mat->data->diffuse_texture = texture_cache::get(missing_path, TextureWraping::REPEAT, TextureFiltering::LINEAR, missing);
+    });
+}
+
+void mesh::process_node(rc_model model, aiNode* node, const aiScene* scene, rc_mesh_dict last_mesh_dict, const aiMatrix4x4& transform, string file_path, gl_task_list& gl_tasks) {
     
     // itterate meshes for the node
     auto t_aivec3 = transform * aiVector3D(1.0f, 1.0f, 1.0f);
     for (size_t m_n = 0; m_n < node->mNumMeshes; m_n++) {
         auto msh = scene->mMeshes[node->mMeshes[m_n]];
         auto mesh_name = string(msh->mName.C_Str());
-        rc_material mesh_material = new RC(new material(new RC(shader::from_file(get_mod_path() + (model->data->animated ? "/default_vertex_animated.glsl" : "/default_vertex.glsl"), ShaderType::VERTEX)), new RC(shader::from_file(get_mod_path() + "/default_fragment.glsl", ShaderType::FRAGMENT))));
+        rc_material mesh_material = new RC(new material(nullptr, nullptr, nullptr, nullptr, false));
+        stage_default_program(mesh_material, model->data->animated, gl_tasks);
         vector<tup<unsigned int, 3>>* faces = new vector<tup<unsigned int, 3>>();
         vector<vertex>* _vertexes = new vector<vertex>();
 
@@ -110,10 +153,7 @@ void mesh::process_node(rc_model model, aiNode* node, const aiScene* scene, rc_m
             faces->push_back(make_tup<unsigned int, 3>({fce.mIndices[0], fce.mIndices[1], fce.mIndices[2]}));
         }
 
-        if (mesh_material->data->diffuse_texture == nullptr) { // TODO add logic to allow for mesh color
-            // insert default texture 
-            mesh_material->data->diffuse_texture = new RC(new texture(get_mod_path() + "/MissingTexture.jpg", TextureWraping::REPEAT, TextureFiltering::LINEAR));
-        }
+        stage_missing_texture(mesh_material, gl_tasks);
 
         
         model->data->extract_bone_weight_for_vertices(_vertexes, msh, scene);
@@ -122,7 +162,39 @@ void mesh::process_node(rc_model model, aiNode* node, const aiScene* scene, rc_m
             v.weights = glm::normalize(v.weights);
         }
 
-        auto ret_mesh = new RC(new mesh(mesh_name, mesh_material, _vertexes, faces, _transform, model->data->animated));
+        if (mesh_optimizer::enabled) {
+            // welded after the bone weights went in, they are part of what makes vertices equal.
+            vector<uint32_t> indices;
+            indices.reserve(faces->size() * 3);
+            for (auto& fce : *faces)
+                indices.insert(indices.end(), fce.data, fce.data + 3);
+            mesh_optimization_report report = mesh_optimizer::optimize(*_vertexes, indices);
+            for (size_t f_n = 0; f_n < faces->size(); f_n++)
+                (*faces)[f_n] = make_tup<unsigned int, 3>({indices[f_n * 3], indices[f_n * 3 + 1], indices[f_n * 3 + 2]});
+            if (mesh_optimizer::logging)
+                std::cout << "Optimized mesh \"" << mesh_name << "\": " << report.welded << " vertices welded, ACMR "
+                    << report.before.acmr << " -> " << report.after.acmr << ", ATVR "
+                    << report.before.atvr << " -> " << report.after.atvr << "\n";
+        }
+
+        auto ret_mesh = new RC(new mesh(mesh_name, mesh_material, _vertexes, faces, _transform, model->data->animated, false));
+        if (mesh_simplifier::lod_levels > 0) {
+            vector<uint32_t> indices(ret_mesh->data->face_indices(), ret_mesh->data->face_indices() + faces->size() * 3);
+            auto lod_indices = new vector<uint32_t>();
+            ret_mesh->data->lods = mesh_simplifier::generate_lods(*_vertexes, indices, *lod_indices);
+            ret_mesh->data->lod_indices = lod_indices;
+        }
+        // packed here so the GL thread only uploads.
+        ret_mesh->data->layout = choose_vertex_layout(_vertexes->data(), _vertexes->size(), model->data->animated, quantize_vertices);
+        ret_mesh->data->index_type = index_type_for(_vertexes->size());
+        auto gpu_vertices = std::make_shared<vector<unsigned char>>(pack_vertices(ret_mesh->data->layout, _vertexes->data(), _vertexes->size()));
+        ret_mesh->data->residency = default_residency;
+        size_t index_count = ret_mesh->data->index_stream_count();
+        auto gpu_indices = ret_mesh->data->pack_index_stream();
+        gl_tasks.push_back([ret_mesh, gpu_vertices, gpu_indices, index_count]() {
+            const void* index_data = gpu_indices ? static_cast<const void*>(gpu_indices->data()) : ret_mesh->data->face_indices();
+            ret_mesh->data->create_VAO(gpu_vertices->data(), gpu_vertices->size(), index_data, index_count);
+        });
         ret_mesh->data->radius = radius;
         ret_mesh->data->aabb_max = aabb_max;
         ret_mesh->data->aabb_min = aabb_min;
@@ -133,7 +205,7 @@ void mesh::process_node(rc_model model, aiNode* node, const aiScene* scene, rc_m
     for (size_t c_n = 0; c_n < node->mNumChildren; c_n++) {
         auto child_mesh_dict = new RC(new mesh_dict());
         child_mesh_dict->data->name = node->mChildren[c_n]->mName.C_Str();
-        process_node(model, node->mChildren[c_n], scene, child_mesh_dict, transform * node->mChildren[c_n]->mTransformation, file_path);
+        process_node(model, node->mChildren[c_n], scene, child_mesh_dict, transform * node->mChildren[c_n]->mTransformation, file_path, gl_tasks);
         
         if (child_mesh_dict->data->data.size() == 1 && // Check if it is duplicating the name with the dict
                     child_mesh_dict->data->data.contains(child_mesh_dict->data->name)) {
@@ -148,6 +220,26 @@ void mesh::process_node(rc_model model, aiNode* node, const aiScene* scene, rc_m
 
 
 rc_model mesh::from_file(string file_path, bool animated) {
+    gl_task_list gl_tasks;
+    rc_model ret = import_file(file_path, animated, gl_tasks);
+    for (auto& task : gl_tasks)
+        task();
+    // flatten the node tree once so rendering never walks it.
+    ret->data->get_draw_list();
+    return ret;
+}
+
+rc_model mesh::import_file(const string& file_path, bool animated, gl_task_list& gl_tasks, bool use_cooked) {
+    string cooked_path = cooked_model::path_for(file_path);
+    if (use_cooked && cooked_model::is_fresh(file_path, cooked_path)) {
+        size_t staged = gl_tasks.size();
+        try {
+            return cooked_model::read(file_path, cooked_path, gl_tasks);
+        } catch (std::runtime_error& e) {
+            std::cerr << "WARNING: " << e.what() << "Importing \"" << file_path << "\" instead.\n";
+            gl_tasks.resize(staged);
+        }
+    }
     Assimp::Importer importer;
     const aiScene* scene = importer.ReadFile( file_path, aiProcess_Triangulate | aiProcess_FlipUVs);
 
@@ -166,67 +258,107 @@ rc_model mesh::from_file(string file_path, bool animated) {
     
     ret->data->animated = scene->mNumAnimations > 0;
 
-    process_node(ret, scene->mRootNode, scene, curren_mesh_dict, scene->mRootNode->mTransformation, file_path);
+    process_node(ret, scene->mRootNode, scene, curren_mesh_dict, scene->mRootNode->mTransformation, file_path, gl_tasks);
 
     for (int i = 0; i < scene->mNumAnimations; i++)  {
         ret->data->animations[scene->mAnimations[i]->mName.data] = new animation(scene, scene->mAnimations[i], ret);
         ret->data->animated = true;
     }
-    
     return ret;
 }
  
-void mesh::create_VAO() {
-    //VAO
-    glGenVertexArrays(1, &this->gl_VAO);
-    glBindVertexArray(this->gl_VAO);
+static_assert(sizeof(tup<unsigned int, 3>) == 3 * sizeof(GLuint), "faces have to be a flat index array to upload them as is");
 
-    vector<GLuint> gl_inds;
-    this->get_gl_vert_inds(&gl_inds);
-    
-    this->indicies_size = gl_inds.size();
+void mesh::create_VAO() {
+    this->layout = choose_vertex_layout(vertices->data(), vertices->size(), this->is_animated, quantize_vertices);
+    this->index_type = index_type_for(vertices->size());
+    vector<unsigned char> gpu_vertices;
+    const void* vertex_data = vertices->data();
+    if (this->layout != VertexLayout::FULL) {
+        gpu_vertices = pack_vertices(this->layout, vertices->data(), vertices->size());
+        vertex_data = gpu_vertices.data();
+    }
+    auto gpu_indices = this->pack_index_stream();
+    const void* index_data = gpu_indices ? static_cast<const void*>(gpu_indices->data()) : this->face_indices();
+    this->create_VAO(vertex_data, vertices->size() * vertex_layout_stride(this->layout), index_data, this->index_stream_count());
+}
 
-    //VBO
-    glGenBuffers(1, &this->gl_VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, this->gl_VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices->size() * sizeof(vertex), &(*vertices)[0], GL_STATIC_DRAW); 
-    
-    //EBO
-    glGenBuffers(1, &this->gl_EBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->gl_EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indicies_size * sizeof(GLuint), &gl_inds[0], GL_STATIC_DRAW);
-
-    // Vertex attributes (verticies)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // Vertex attributes (normals)
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, normal));
-    glEnableVertexAttribArray(1);
-
-    // if (!this->faces->empty()) {
-        // Vertex attributes (texcoords)
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(vertex),
-            (void*)offsetof(vertex, tex_coords));
-        glEnableVertexAttribArray(2);
-    // }
-
-    if (this->is_animated) {
-        // Vertex attributes (bone_ids)
-        glVertexAttribIPointer(3, 4, GL_INT, sizeof(vertex), (void*)offsetof(vertex, bone_ids));
-        glEnableVertexAttribArray(3);
-        // Vertex attributes (weights)
-        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, weights));
-        glEnableVertexAttribArray(4); 
+std::shared_ptr<vector<unsigned char>> mesh::pack_index_stream() const {
+    size_t face_index_count = this->faces->size() * 3;
+    // 32 bit indices of meshes without levels of detail upload straight from the faces.
+    if (this->index_type == GL_UNSIGNED_INT && (!this->lod_indices || this->lod_indices->empty()))
+        return nullptr;
+    auto ret = std::make_shared<vector<unsigned char>>(pack_indices(this->index_type, this->face_indices(), face_index_count));
+    if (this->lod_indices) {
+        vector<unsigned char> lod_data = pack_indices(this->index_type, this->lod_indices->data(), this->lod_indices->size());
+        ret->insert(ret->end(), lod_data.begin(), lod_data.end());
     }
+    return ret;
+}
+
+void mesh::create_VAO(const void* vertex_data, size_t vertex_bytes, const void* index_data, size_t index_count) {
+    geometry_arena& arena = geometry_arena::get(this->layout);
+    this->indicies_size = this->lods.empty() ? index_count : this->lods.front().first_index;
+    size_t index_bytes = index_count * index_type_size(this->index_type);
+    this->geometry = arena.allocate(vertex_data, vertex_bytes / arena.stride, index_data, index_bytes);
+    this->gl_VAO = arena.gl_VAO;
+
+    this->gpu_bytes = vertex_bytes + index_bytes;
+    this->apply_residency();
+}
+
+void mesh::set_residency(GeometryResidency policy) {
+    this->residency = policy;
+    if (this->gl_VAO)
+        this->apply_residency();
+}
 
-    glBindVertexArray(0);
+void mesh::apply_residency() {
+    if (this->residency == GeometryResidency::KEEP)
+        return;
+    if (this->residency == GeometryResidency::POSITIONS_ONLY && this->vertices && !this->positions) {
+        this->positions = new vector<glm::vec3>();
+        this->positions->reserve(this->vertices->size());
+        for (const auto& v : *this->vertices)
+            this->positions->push_back(v.position);
+    }
+    if (this->residency == GeometryResidency::DISCARD) {
+        delete this->positions;
+        this->positions = nullptr;
+    }
+    delete this->vertices;
+    this->vertices = nullptr;
+    delete this->faces;
+    this->faces = nullptr;
+    delete this->lod_indices;
+    this->lod_indices = nullptr;
 }
 
-void mesh::get_gl_vert_inds(vector<unsigned int>* mut_inds) {
-    for (tup<unsigned int, 3> fce : *this->faces) {
-        mut_inds->push_back(fce[0]);
-        mut_inds->push_back(fce[1]);
-        mut_inds->push_back(fce[2]);
+vector<vec3> mesh::get_positions() const {
+    vector<vec3> ret;
+    if (this->vertices) {
+        ret.reserve(this->vertices->size());
+        for (const auto& v : *this->vertices)
+            ret.push_back(v.position);
+    } else if (this->positions) {
+        ret.reserve(this->positions->size());
+        for (const auto& p : *this->positions)
+            ret.push_back(p);
+    } else {
+        throw std::runtime_error("Mesh \"" + this->name + "\" discarded its geometry after upload, load it with GeometryResidency.KEEP or POSITIONS_ONLY to build colliders from it.");
     }
+    return ret;
+}
+
+size_t mesh::get_cpu_bytes() const {
+    size_t ret = 0;
+    if (this->vertices)
+        ret += this->vertices->capacity() * sizeof(vertex);
+    if (this->faces)
+        ret += this->faces->capacity() * sizeof(tup<unsigned int, 3>);
+    if (this->lod_indices)
+        ret += this->lod_indices->capacity() * sizeof(uint32_t);
+    if (this->positions)
+        ret += this->positions->capacity() * sizeof(glm::vec3);
+    return ret;
 }
\ No newline at end of file
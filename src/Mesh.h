@@ -18,8 +18,15 @@
 #include <iterator>
 #include "RC.h"
 #include <variant>
+#include <functional>
+#include <atomic>
+#include <algorithm>
 #include "Material.h"
 #include "util.h"
+#include "VertexLayout.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "GeometryArena.h"
 
 #define MAX_BONE_INFLUENCE 4
 
@@ -38,6 +45,9 @@ typedef RC<mesh_dict*>* rc_mesh_dict;
 
 typedef std::variant<rc_mesh, rc_mesh_dict> mesh_dict_child;
 
+// GL work an import leaves for the thread owning the context, in the order it has to run.
+typedef vector<std::function<void()>> gl_task_list;
+
 enum illum_model {
     CONSTANT_COLOR,
     DIFFUSE,
@@ -46,17 +56,14 @@ enum illum_model {
 
 typedef RC<texture*>* rc_texture;
 
-struct vertex {
-    // position
-    glm::vec3 position = glm::vec3(0.0f,0.0f,0.0f);
-    // normal
-    glm::vec3 normal = glm::vec3(0.0f,0.0f,0.0f);
-    // texCoords
-    glm::vec2 tex_coords = glm::vec2(0.0f,0.0f);
-	//bone indexes which will influence this vertex
-	glm::ivec4 bone_ids = glm::ivec4(0,0,0,0);
-	//weights from each bone
-	glm::vec4 weights = glm::vec4(0.0f,0.0f,0.0f,0.0f);
+// What a mesh keeps of its geometry on the CPU once it was uploaded.
+enum class GeometryResidency : uint8_t {
+    // vertices and faces stay, meshes can be edited, cooked and turned into colliders.
+    KEEP,
+    // only vertex positions stay, enough for colliders and hulls.
+    POSITIONS_ONLY,
+    // nothing stays, the mesh only renders.
+    DISCARD
 };
 
 class mesh {
@@ -67,7 +74,11 @@ public:
     mesh_material(rhs.mesh_material),
     vertices(rhs.vertices),
     faces(rhs.faces),
-    transform(rhs.transform)
+    transform(rhs.transform),
+    lods(rhs.lods),
+    lod_indices(rhs.lod_indices),
+    layout(rhs.layout),
+    index_type(rhs.index_type)
     {}
     mesh(
         string name,
@@ -75,7 +86,8 @@ public:
         vector<vertex>* vertices,
         vector<tup<unsigned int, 3>>* faces,
         vec3 transform,
-        bool is_animated = false
+        bool is_animated = false,
+        bool upload = true
     ):
     name(name),
     mesh_material(mesh_material),
@@ -84,36 +96,113 @@ public:
     transform(transform),
     is_animated(is_animated)
     {
-        this->create_VAO();
+        if (upload)
+            this->create_VAO();
     }
     ~mesh(){
-        glDeleteVertexArrays(1, &gl_VAO);
-        glDeleteBuffers(1, &gl_VBO);
-        glDeleteBuffers(1, &gl_EBO);
+        // meshes that were never uploaded, like the ones a cook imports, need no context to go away.
+        if (geometry)
+            geometry_arena::release(geometry);
         delete faces;
+        delete lod_indices;
         delete vertices;
+        delete positions;
     }
     static rc_model from_file(string file_path, bool animated);
+    // The part of from_file that does not need GL: parsing, vertex and bone data, texture decoding.
+    // Everything else is appended to gl_tasks, run them in order on the GL thread before using the model.
+    // A cooked file next to file_path that is not older than it is loaded instead, unless use_cooked is false.
+    static rc_model import_file(const string& file_path, bool animated, gl_task_list& gl_tasks, bool use_cooked = true);
     string name = "";
     rc_material mesh_material = nullptr;
 
     // VVV THESE SHOULD BE HEAP ALLOCATED
+    // both are null once the residency policy dropped them.
     vector<tup<unsigned int, 3>>* faces = nullptr;
     vector<vertex>* vertices = nullptr;
+    // only set under GeometryResidency::POSITIONS_ONLY.
+    vector<glm::vec3>* positions = nullptr;
     bool is_animated = false;
 
     vec3 transform = vec3(0.0f,0.0f,0.0f);
     float radius = 0.0f;
-    void get_gl_vert_inds(vector<unsigned int>* mut_inds);
 
-    unsigned int gl_VAO, gl_VBO, gl_EBO;
+    // the faces as one flat index array, no copy.
+    inline const GLuint* face_indices() const {
+        return reinterpret_cast<const GLuint*>(faces->data());
+    }
+
+    // reduced levels of detail, their indices follow the faces in the index buffer.
+    vector<mesh_lod> lods;
+    // the indices of every reduced level back to back, dropped along with faces.
+    vector<uint32_t>* lod_indices = nullptr;
+    // level 0 is full detail, levels past the last reduced one get the last.
+    inline mesh_lod get_lod(size_t level) const {
+        if (level == 0 || lods.empty())
+            return {0, static_cast<uint32_t>(indicies_size), 0.0f};
+        return lods[std::min(level, lods.size()) - 1];
+    }
+
+    // applied after every upload, setting it on an uploaded mesh applies it right away.
+    GeometryResidency residency = GeometryResidency::KEEP;
+    void set_residency(GeometryResidency policy);
+    // vertex positions from whatever the mesh still keeps, throws once they were discarded.
+    vector<vec3> get_positions() const;
+    // bytes of geometry this mesh holds on the CPU and in its GL buffers.
+    size_t get_cpu_bytes() const;
+    inline size_t get_gpu_bytes() const {
+        return gpu_bytes;
+    }
+    // the residency meshes of later imports get.
+    static inline void set_default_residency(GeometryResidency policy) {
+        default_residency = policy;
+    }
+    static inline GeometryResidency get_default_residency() {
+        return default_residency;
+    }
+
+    // the VAO of the arena holding the geometry, shared with every mesh of the same layout.
+    unsigned int gl_VAO = 0;
+    geometry_range* geometry = nullptr;
     size_t indicies_size = 0;
+    // how the VBO stores the vertices, picked by the importer or by create_VAO.
+    VertexLayout layout = VertexLayout::FULL;
+    // GL_UNSIGNED_SHORT when the vertices allow 16 bit indices.
+    GLenum index_type = GL_UNSIGNED_INT;
+    // lets meshes created from now on pick the packed vertex layouts.
+    static inline void set_vertex_quantization(bool enabled) {
+        quantize_vertices = enabled;
+    }
+    static inline bool get_vertex_quantization() {
+        return quantize_vertices;
+    }
     vec3 aabb_max = vec3(0.0f,0.0f,0.0f);
     vec3 aabb_min = vec3(0.0f,0.0f,0.0f);
 private:
     // RETURNS A HEAP ALLOCATED POINTER
-    static void process_node(rc_model model, aiNode* node, const aiScene* scene, rc_mesh_dict last_mesh_dict, const aiMatrix4x4& transform, string file_path);
+    static void process_node(rc_model model, aiNode* node, const aiScene* scene, rc_mesh_dict last_mesh_dict, const aiMatrix4x4& transform, string file_path, gl_task_list& gl_tasks);
+    // queues linking the default shaders into mat.
+    static void stage_default_program(rc_material mat, bool animated, gl_task_list& gl_tasks);
+    // decodes the texture now and queues its upload into the material's slot, file_slot records where it came from.
+    static void stage_texture(rc_material mat, rc_texture material::* slot, string material::* file_slot, const string& texture_path, gl_task_list& gl_tasks);
+    // queues the missing texture for materials that did not get a diffuse map.
+    static void stage_missing_texture(rc_material mat, gl_task_list& gl_tasks);
+    // picks the layout and uploads the CPU copies.
     void create_VAO();
+    // uploads vertex_data and index_data, which already are in this mesh's layout and index_type.
+    // index_count covers the faces and every level of detail.
+    void create_VAO(const void* vertex_data, size_t vertex_bytes, const void* index_data, size_t index_count);
+    // the faces followed by lod_indices as index_type, nullptr when the faces upload as they are.
+    std::shared_ptr<vector<unsigned char>> pack_index_stream() const;
+    inline size_t index_stream_count() const {
+        return faces->size() * 3 + (lod_indices ? lod_indices->size() : 0);
+    }
+    friend class cooked_model;
+    void apply_residency();
+    size_t gpu_bytes = 0;
+    // read from the import thread.
+    static inline std::atomic<bool> quantize_vertices = false;
+    static inline std::atomic<GeometryResidency> default_residency = GeometryResidency::KEEP;
 };
 
 inline string trim(const string& str)
@@ -161,7 +250,10 @@ public:
     mesh_dict(){}
     mesh_dict(string name, std::map<string, mesh_dict_child> data):data(data), name(name){}
     mesh_dict(const mesh_dict& rhs) : data(rhs.data), name(rhs.name) {}
+    // bumped by every insert or remove on this dict, models whose draw list came from it rebuild the list.
+    size_t version = 0;
     inline void insert(mesh_dict_child m) {
+        version++;
         if (std::holds_alternative<rc_mesh>(m)) {
             auto msh = std::get<rc_mesh>(m);
             this->data.insert_or_assign(msh->data->name, msh);
@@ -175,6 +267,7 @@ public:
         return this->data[name];
     }
     inline void remove(string name) {
+        version++;
         this->data.erase(name);
     }
     inline mesh_dict_child operator[](string name) {
@@ -182,12 +275,12 @@ public:
     }
     inline vector<vec3> gather_mesh_verticies() {
         vector<vec3> ret;
-        for (auto [key, m] : *this) {
+        for (const auto& [key, m] : this->data) {
             if (std::holds_alternative<rc_mesh>(m)) {
                 auto msh = std::get<rc_mesh>(m);
                 // verticies
-                for (const auto & v : *msh->data->vertices)
-                    ret.push_back(v.position);
+                auto positions = msh->data->get_positions();
+                vec_extend(ret, positions);
             } else if (std::holds_alternative<rc_mesh_dict>(m)) {
                 auto msh_d = std::get<rc_mesh_dict>(m);
                 auto m_data = msh_d->data->gather_mesh_verticies();
@@ -204,6 +297,18 @@ public:
     string name = "";
 };
 
+// One mesh of a model flattened out of its mesh_dict tree.
+// Node transforms are baked into the vertices on import, so records carry none.
+struct mesh_draw_record {
+    mesh* msh;
+    GLuint vao;
+    GLsizei index_count;
+    GLenum index_type;
+    const geometry_range* geometry;
+    material* mat;
+    glm::vec3 aabb_min, aabb_max;
+};
+
 
 // Texture assimp macro
 
@@ -211,11 +316,7 @@ public:
             aiString path;\
             if (ai_mat->GetTexture(aitype, t_n, &path) == AI_SUCCESS) {\
                 if (str_tool::rem_path_from_file(string(path.C_Str())).find(".") != std::string::npos) {\
-                    try {\
-                        mesh_material->data->type_name##_texture = new RC(new texture(fix_texture_path(file_path, string(path.C_Str())), TextureWraping::REPEAT, TextureFiltering::LINEAR));\
-                    } catch ( std::runtime_error e ) {\
-                        std::cerr << e.what();\
-                    }\
+                    stage_texture(mesh_material, &material::type_name##_texture, &material::type_name##_file, fix_texture_path(file_path, string(path.C_Str())), gl_tasks);\
                 }\
             } else {\
                 std::cerr << "Assimp failed to get "#type_name"s texture for node \"" << node->mName.C_Str() << "\"\n";\
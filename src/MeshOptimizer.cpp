@@ -0,0 +1,350 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+// Forsyth's scoring constants, see "Linear-Speed Vertex Cache Optimisation".
+static constexpr float cache_decay_power = 1.5f;
+static constexpr float last_triangle_score = 0.75f;
+static constexpr float valence_boost_scale = 2.0f;
+static constexpr float valence_boost_power = 0.5f;
+
+static inline float forsyth_vertex_score(int cache_position, uint32_t live_triangles) {
+    if (live_triangles == 0)
+        return -1.0f;
+    float score = 0.0f;
+    if (cache_position >= 0) {
+        if (cache_position < 3) {
+            // the last triangle's vertices, a bit lower so strips do not just continue.
+            score = last_triangle_score;
+        } else {
+            const float scaler = 1.0f / (mesh_optimizer::cache_size - 3);
+            score = std::pow(1.0f - (cache_position - 3) * scaler, cache_decay_power);
+        }
+    }
+    // favour vertices with few triangles left, so no lonely triangles are left behind.
+    return score + valence_boost_scale * std::pow(static_cast<float>(live_triangles), -valence_boost_power);
+}
+
+size_t mesh_optimizer::weld_vertices(vector<vertex>& vertices, vector<uint32_t>& indices) {
+    struct vertex_bits_hash {
+        size_t operator()(const vertex& v) const {
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&v);
+            uint64_t hash = 14695981039346656037ull;
+            for (size_t i = 0; i < sizeof(vertex); i++)
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            return static_cast<size_t>(hash);
+        }
+    };
+    struct vertex_bits_equal {
+        bool operator()(const vertex& a, const vertex& b) const {
+            return std::memcmp(&a, &b, sizeof(vertex)) == 0;
+        }
+    };
+
+    std::unordered_map<vertex, uint32_t, vertex_bits_hash, vertex_bits_equal> unique;
+    unique.reserve(vertices.size());
+    vector<uint32_t> remap(vertices.size());
+    vector<vertex> welded;
+    welded.reserve(vertices.size());
+    for (size_t v = 0; v < vertices.size(); v++) {
+        auto [it, inserted] = unique.try_emplace(vertices[v], static_cast<uint32_t>(welded.size()));
+        if (inserted)
+            welded.push_back(vertices[v]);
+        remap[v] = it->second;
+    }
+    for (auto& index : indices)
+        index = remap[index];
+    size_t removed = vertices.size() - welded.size();
+    vertices = std::move(welded);
+    return removed;
+}
+
+void mesh_optimizer::optimize_vertex_cache(vector<uint32_t>& indices, size_t vertex_count) {
+    size_t face_count = indices.size() / 3;
+    if (face_count == 0)
+        return;
+
+    // triangles around each vertex, the first live_triangles[v] of them are not emitted yet.
+    vector<uint32_t> live_triangles(vertex_count, 0);
+    for (uint32_t index : indices)
+        live_triangles[index]++;
+    vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; v++)
+        adjacency_offsets[v + 1] = adjacency_offsets[v] + live_triangles[v];
+    vector<uint32_t> adjacency(indices.size());
+    {
+        vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (size_t f = 0; f < face_count; f++)
+            for (size_t c = 0; c < 3; c++)
+                adjacency[fill[indices[f * 3 + c]]++] = static_cast<uint32_t>(f);
+    }
+
+    vector<int> cache_position(vertex_count, -1);
+    vector<float> vertex_score(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++)
+        vertex_score[v] = forsyth_vertex_score(-1, live_triangles[v]);
+    vector<float> face_score(face_count);
+    for (size_t f = 0; f < face_count; f++)
+        face_score[f] = vertex_score[indices[f * 3]] + vertex_score[indices[f * 3 + 1]] + vertex_score[indices[f * 3 + 2]];
+
+    vector<bool> emitted(face_count, false);
+    vector<uint32_t> cache, next_cache;
+    cache.reserve(cache_size + 3);
+    next_cache.reserve(cache_size + 3);
+    vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    size_t cursor = 0;
+    int64_t best_face = -1;
+    for (size_t step = 0; step < face_count; step++) {
+        if (best_face < 0) {
+            // nothing in the cache is connected to what is left, continue in input order.
+            while (emitted[cursor])
+                cursor++;
+            best_face = static_cast<int64_t>(cursor);
+        }
+        const uint32_t* face = &indices[best_face * 3];
+        result.insert(result.end(), face, face + 3);
+        emitted[best_face] = true;
+
+        next_cache.assign(face, face + 3);
+        for (uint32_t v : cache)
+            if (v != face[0] && v != face[1] && v != face[2])
+                next_cache.push_back(v);
+
+        for (size_t c = 0; c < 3; c++) {
+            uint32_t v = face[c];
+            uint32_t* live = &adjacency[adjacency_offsets[v]];
+            for (uint32_t t = 0; t < live_triangles[v]; t++) {
+                if (live[t] == static_cast<uint32_t>(best_face)) {
+                    std::swap(live[t], live[live_triangles[v] - 1]);
+                    live_triangles[v]--;
+                    break;
+                }
+            }
+        }
+
+        // rescore everything that moved in the cache, including what fell out of it.
+        for (size_t i = 0; i < next_cache.size(); i++) {
+            uint32_t v = next_cache[i];
+            cache_position[v] = i < cache_size ? static_cast<int>(i) : -1;
+            vertex_score[v] = forsyth_vertex_score(cache_position[v], live_triangles[v]);
+        }
+        best_face = -1;
+        float best_score = -1.0f;
+        for (uint32_t v : next_cache) {
+            const uint32_t* live = &adjacency[adjacency_offsets[v]];
+            for (uint32_t t = 0; t < live_triangles[v]; t++) {
+                uint32_t f = live[t];
+                face_score[f] = vertex_score[indices[f * 3]] + vertex_score[indices[f * 3 + 1]] + vertex_score[indices[f * 3 + 2]];
+                if (face_score[f] > best_score || (face_score[f] == best_score && f < best_face)) {
+                    best_score = face_score[f];
+                    best_face = f;
+                }
+            }
+        }
+
+        if (next_cache.size() > cache_size)
+            next_cache.resize(cache_size);
+        std::swap(cache, next_cache);
+    }
+    indices = std::move(result);
+}
+
+void mesh_optimizer::optimize_overdraw(vector<uint32_t>& indices, const vector<vertex>& vertices) {
+    size_t face_count = indices.size() / 3;
+    if (face_count < 2)
+        return;
+
+    // a cluster starts wherever the cache starts over, reordering whole clusters keeps the cache hits.
+    vector<size_t> cluster_starts;
+    vector<uint32_t> timestamps(vertices.size(), 0);
+    uint32_t time = stats_cache_size + 1;
+    for (size_t f = 0; f < face_count; f++) {
+        size_t misses = 0;
+        for (size_t c = 0; c < 3; c++) {
+            uint32_t v = indices[f * 3 + c];
+            if (time - timestamps[v] > stats_cache_size) {
+                timestamps[v] = time++;
+                misses++;
+            }
+        }
+        if (f == 0 || misses == 3)
+            cluster_starts.push_back(f);
+    }
+    if (cluster_starts.size() < 2)
+        return;
+    cluster_starts.push_back(face_count);
+
+    size_t cluster_count = cluster_starts.size() - 1;
+    vector<glm::vec3> centroids(cluster_count, glm::vec3(0.0f));
+    vector<glm::vec3> normals(cluster_count, glm::vec3(0.0f));
+    glm::vec3 mesh_centroid(0.0f);
+    float mesh_area = 0.0f;
+    for (size_t k = 0; k < cluster_count; k++) {
+        float cluster_area = 0.0f;
+        for (size_t f = cluster_starts[k]; f < cluster_starts[k + 1]; f++) {
+            const glm::vec3& a = vertices[indices[f * 3]].position;
+            const glm::vec3& b = vertices[indices[f * 3 + 1]].position;
+            const glm::vec3& c = vertices[indices[f * 3 + 2]].position;
+            // twice the area, weighted towards big triangles.
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            float area = glm::length(normal);
+            centroids[k] += (a + b + c) * (area / 3.0f);
+            normals[k] += normal;
+            cluster_area += area;
+        }
+        mesh_centroid += centroids[k];
+        mesh_area += cluster_area;
+        centroids[k] = cluster_area > 0.0f ? centroids[k] / cluster_area : vertices[indices[cluster_starts[k] * 3]].position;
+        float normal_length = glm::length(normals[k]);
+        normals[k] = normal_length > 0.0f ? normals[k] / normal_length : glm::vec3(0.0f);
+    }
+    if (mesh_area > 0.0f)
+        mesh_centroid /= mesh_area;
+
+    vector<float> keys(cluster_count);
+    for (size_t k = 0; k < cluster_count; k++)
+        keys[k] = glm::dot(centroids[k] - mesh_centroid, normals[k]);
+    vector<size_t> order(cluster_count);
+    for (size_t k = 0; k < cluster_count; k++)
+        order[k] = k;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return keys[a] > keys[b];
+    });
+
+    vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (size_t k : order)
+        result.insert(result.end(), indices.begin() + cluster_starts[k] * 3, indices.begin() + cluster_starts[k + 1] * 3);
+    indices = std::move(result);
+}
+
+void mesh_optimizer::optimize_vertex_fetch(vector<vertex>& vertices, vector<uint32_t>& indices) {
+    vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    uint32_t next = 0;
+    for (auto& index : indices) {
+        if (remap[index] == UINT32_MAX)
+            remap[index] = next++;
+        index = remap[index];
+    }
+    vector<vertex> reordered(next);
+    for (size_t v = 0; v < vertices.size(); v++)
+        if (remap[v] != UINT32_MAX)
+            reordered[remap[v]] = vertices[v];
+    vertices = std::move(reordered);
+}
+
+vertex_cache_stats mesh_optimizer::analyze_vertex_cache(const vector<uint32_t>& indices, size_t vertex_count, size_t cache_entries) {
+    vertex_cache_stats stats;
+    stats.triangles = indices.size() / 3;
+    vector<uint32_t> timestamps(vertex_count, 0);
+    vector<bool> used(vertex_count, false);
+    uint32_t time = static_cast<uint32_t>(cache_entries) + 1;
+    for (uint32_t index : indices) {
+        if (!used[index]) {
+            used[index] = true;
+            stats.vertices++;
+        }
+        if (time - timestamps[index] > cache_entries) {
+            timestamps[index] = time++;
+            stats.transformed++;
+        }
+    }
+    if (stats.triangles)
+        stats.acmr = static_cast<float>(stats.transformed) / stats.triangles;
+    if (stats.vertices)
+        stats.atvr = static_cast<float>(stats.transformed) / stats.vertices;
+    return stats;
+}
+
+mesh_optimization_report mesh_optimizer::optimize(vector<vertex>& vertices, vector<uint32_t>& indices) {
+    mesh_optimization_report report;
+    report.before = analyze_vertex_cache(indices, vertices.size());
+    report.welded = weld_vertices(vertices, indices);
+    optimize_vertex_cache(indices, vertices.size());
+    optimize_overdraw(indices, vertices);
+    optimize_vertex_fetch(vertices, indices);
+    report.after = analyze_vertex_cache(indices, vertices.size());
+    return report;
+}
+
+static void expect_optimized(bool condition, const std::string& what) {
+    if (!condition)
+        throw std::runtime_error("Mesh optimizer self test failed: " + what + ".");
+}
+
+// the mesh's triangles by position, each rotated to start at its smallest corner so winding is kept.
+static vector<std::array<float, 9>> canonical_triangles(const vector<vertex>& vertices, const vector<uint32_t>& indices) {
+    vector<std::array<float, 9>> ret;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        std::array<std::array<float, 3>, 3> corners;
+        for (size_t c = 0; c < 3; c++) {
+            const glm::vec3& p = vertices[indices[i + c]].position;
+            corners[c] = {p.x, p.y, p.z};
+        }
+        size_t first = std::min_element(corners.begin(), corners.end()) - corners.begin();
+        std::array<float, 9> triangle;
+        for (size_t c = 0; c < 3; c++)
+            std::copy(corners[(first + c) % 3].begin(), corners[(first + c) % 3].end(), triangle.begin() + c * 3);
+        ret.push_back(triangle);
+    }
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+void mesh_optimizer::self_test() {
+    // a grid of quads that each have their own four vertices, with its triangles scattered.
+    const uint32_t size = 16;
+    vector<vertex> vertices;
+    vector<uint32_t> grid_indices;
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            uint32_t base = static_cast<uint32_t>(vertices.size());
+            for (uint32_t corner = 0; corner < 4; corner++) {
+                vertex v;
+                v.position = glm::vec3(static_cast<float>(x + (corner & 1)), static_cast<float>(y + (corner >> 1)), 0.0f);
+                v.normal = glm::vec3(0.0f, 0.0f, 1.0f);
+                v.tex_coords = glm::vec2(v.position.x / size, v.position.y / size);
+                vertices.push_back(v);
+            }
+            uint32_t quad[6] = {base, base + 1, base + 2, base + 1, base + 3, base + 2};
+            grid_indices.insert(grid_indices.end(), quad, quad + 6);
+        }
+    }
+    size_t triangle_count = grid_indices.size() / 3;
+    vector<uint32_t> indices;
+    for (size_t t = 0; t < triangle_count; t++) {
+        size_t from = (t * 97) % triangle_count;
+        indices.insert(indices.end(), grid_indices.begin() + from * 3, grid_indices.begin() + from * 3 + 3);
+    }
+    auto original_triangles = canonical_triangles(vertices, indices);
+
+    // the cache ordering has to beat welding alone, not only the unwelded input.
+    vector<vertex> welded_vertices = vertices;
+    vector<uint32_t> welded_indices = indices;
+    weld_vertices(welded_vertices, welded_indices);
+    float welded_acmr = analyze_vertex_cache(welded_indices, welded_vertices.size()).acmr;
+
+    vector<vertex> first_vertices = vertices, second_vertices = vertices;
+    vector<uint32_t> first_indices = indices, second_indices = indices;
+    mesh_optimization_report report = optimize(first_vertices, first_indices);
+    optimize(second_vertices, second_indices);
+
+    size_t expected_vertices = (size + 1) * (size + 1);
+    expect_optimized(first_vertices.size() == expected_vertices, "welding left " + std::to_string(first_vertices.size()) + " vertices instead of " + std::to_string(expected_vertices));
+    expect_optimized(report.welded == vertices.size() - expected_vertices, "the report counts the wrong number of welded vertices");
+    expect_optimized(report.after.acmr <= report.before.acmr && report.after.acmr <= welded_acmr, "the optimized ACMR is higher than the input's");
+    expect_optimized(first_indices.size() == indices.size(), "triangles were added or dropped");
+    expect_optimized(canonical_triangles(first_vertices, first_indices) == original_triangles, "the reordered triangles differ from the input's");
+    expect_optimized(
+        first_indices == second_indices && first_vertices.size() == second_vertices.size()
+            && std::memcmp(first_vertices.data(), second_vertices.data(), first_vertices.size() * sizeof(vertex)) == 0,
+        "two runs on the same input gave different buffers"
+    );
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include "VertexLayout.h"
+
+using std::vector;
+
+// How an index buffer does on a simulated FIFO post transform cache.
+struct vertex_cache_stats {
+    size_t triangles = 0;
+    size_t vertices = 0;
+    size_t transformed = 0;
+    // average cache miss ratio, vertex shader runs per triangle.  3 is the worst, around 0.5 the best for large meshes.
+    float acmr = 0.0f;
+    // average transformed vertex ratio, vertex shader runs per vertex.  1 is ideal.
+    float atvr = 0.0f;
+};
+
+struct mesh_optimization_report {
+    vertex_cache_stats before, after;
+    size_t welded = 0;
+};
+
+// Import time reordering of vertex and index buffers, so meshes transform fewer vertices,
+// shade fewer hidden fragments and fetch vertices in memory order.
+// Everything here works on CPU data only and gives the same output for the same input.
+class mesh_optimizer {
+public:
+    // entries of the cache the reordering aims at.
+    static constexpr size_t cache_size = 32;
+    // entries of the FIFO cache the stats simulate, a conservative guess for current GPUs.
+    static constexpr size_t stats_cache_size = 16;
+
+    // merges bitwise identical vertices and rewrites the indices, returns how many were removed.
+    static size_t weld_vertices(vector<vertex>& vertices, vector<uint32_t>& indices);
+    // orders triangles to reuse the post transform cache, Forsyth's linear speed algorithm.
+    static void optimize_vertex_cache(vector<uint32_t>& indices, size_t vertex_count);
+    // splits the cache ordered triangles where the cache starts over and draws the clusters
+    // facing away from the mesh's center first, they tend to hide the rest.
+    static void optimize_overdraw(vector<uint32_t>& indices, const vector<vertex>& vertices);
+    // orders vertices by first use and drops unused ones.
+    static void optimize_vertex_fetch(vector<vertex>& vertices, vector<uint32_t>& indices);
+    static vertex_cache_stats analyze_vertex_cache(const vector<uint32_t>& indices, size_t vertex_count, size_t cache_entries = stats_cache_size);
+
+    // all of the above in order.
+    static mesh_optimization_report optimize(vector<vertex>& vertices, vector<uint32_t>& indices);
+
+    // optimizes a shuffled, unwelded grid and checks the welded vertex count, that the cache does no
+    // worse, that every triangle survives with its winding and that a second run is byte identical.
+    // Throws describing the first mismatch.
+    static void self_test();
+
+    // imports run optimize on every mesh while enabled, and print the reports while logging.
+    static inline void set_import_optimization(bool enable, bool log) {
+        enabled = enable;
+        logging = log;
+    }
+    static inline bool get_import_optimization() {
+        return enabled;
+    }
+    // read from the import thread.
+    static inline std::atomic<bool> enabled = true;
+    static inline std::atomic<bool> logging = false;
+};
@@ -0,0 +1,252 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// Sum of squared distances to a set of planes, the symmetric 4x4 matrix of Garland and Heckbert.
+struct quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0;
+    double b2 = 0, bc = 0, bd = 0;
+    double c2 = 0, cd = 0;
+    double d2 = 0;
+
+    inline void add_plane(const glm::vec3& n, float d) {
+        a2 += n.x * n.x; ab += n.x * n.y; ac += n.x * n.z; ad += n.x * d;
+        b2 += n.y * n.y; bc += n.y * n.z; bd += n.y * d;
+        c2 += n.z * n.z; cd += n.z * d;
+        d2 += static_cast<double>(d) * d;
+    }
+    inline void operator+=(const quadric& rhs) {
+        a2 += rhs.a2; ab += rhs.ab; ac += rhs.ac; ad += rhs.ad;
+        b2 += rhs.b2; bc += rhs.bc; bd += rhs.bd;
+        c2 += rhs.c2; cd += rhs.cd;
+        d2 += rhs.d2;
+    }
+    inline float error(const glm::vec3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        double e = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+            + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+            + c2 * z * z + 2 * cd * z
+            + d2;
+        return static_cast<float>(std::max(e, 0.0));
+    }
+};
+
+struct edge_collapse {
+    uint32_t from, to;
+    float error;
+};
+
+static inline uint64_t edge_key(uint32_t a, uint32_t b) {
+    return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+vector<uint32_t> mesh_simplifier::simplify(const vector<vertex>& vertices, const vector<uint32_t>& source, size_t target_index_count, float max_error, float* out_error) {
+    if (out_error)
+        *out_error = 0.0f;
+    size_t vertex_count = vertices.size();
+    if (source.size() <= target_index_count || vertex_count == 0)
+        return source;
+
+    // positions scaled into the unit cube so errors do not depend on the mesh's size.
+    glm::vec3 low = vertices[0].position, high = vertices[0].position;
+    for (const vertex& v : vertices) {
+        low = glm::min(low, v.position);
+        high = glm::max(high, v.position);
+    }
+    float extent = std::max({high.x - low.x, high.y - low.y, high.z - low.z});
+    if (extent <= 0.0f)
+        return source;
+    vector<glm::vec3> positions(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++)
+        positions[v] = (vertices[v].position - low) / extent;
+
+    // vertices sharing a position split the surface's attributes, moving one would tear it open.
+    vector<uint8_t> locked(vertex_count, 0);
+    vector<uint32_t> canonical(vertex_count);
+    {
+        struct position_hash {
+            size_t operator()(const glm::vec3& p) const {
+                uint32_t bits[3];
+                std::memcpy(bits, &p, sizeof(bits));
+                return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+            }
+        };
+        struct position_equal {
+            bool operator()(const glm::vec3& a, const glm::vec3& b) const {
+                return std::memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+            }
+        };
+        std::unordered_map<glm::vec3, uint32_t, position_hash, position_equal> first;
+        first.reserve(vertex_count);
+        for (size_t v = 0; v < vertex_count; v++) {
+            auto [it, inserted] = first.try_emplace(vertices[v].position, static_cast<uint32_t>(v));
+            canonical[v] = it->second;
+            if (!inserted)
+                locked[v] = locked[it->second] = 1;
+        }
+    }
+    // edges with a single triangle are open borders, measured over positions so seams are not borders.
+    {
+        std::unordered_map<uint64_t, uint32_t> edge_uses;
+        edge_uses.reserve(source.size());
+        for (size_t i = 0; i < source.size(); i += 3)
+            for (size_t e = 0; e < 3; e++)
+                edge_uses[edge_key(canonical[source[i + e]], canonical[source[i + (e + 1) % 3]])]++;
+        for (const auto& [key, uses] : edge_uses) {
+            if (uses == 1) {
+                locked[key >> 32] = 1;
+                locked[key & 0xffffffffu] = 1;
+            }
+        }
+        for (size_t v = 0; v < vertex_count; v++)
+            locked[v] |= locked[canonical[v]];
+    }
+
+    vector<quadric> quadrics(vertex_count);
+    for (size_t i = 0; i < source.size(); i += 3) {
+        const glm::vec3& a = positions[source[i]];
+        glm::vec3 normal = glm::cross(positions[source[i + 1]] - a, positions[source[i + 2]] - a);
+        float length = glm::length(normal);
+        if (length <= 0.0f)
+            continue;
+        normal /= length;
+        float d = -glm::dot(normal, a);
+        for (size_t c = 0; c < 3; c++)
+            quadrics[source[i + c]].add_plane(normal, d);
+    }
+
+    float max_error_squared = max_error * max_error;
+    float result_error = 0.0f;
+    vector<uint32_t> indices = source;
+    vector<uint32_t> adjacency_offsets, adjacency, remap(vertex_count);
+    vector<uint8_t> touched(vertex_count);
+    vector<edge_collapse> collapses;
+
+    while (indices.size() > target_index_count) {
+        size_t face_count = indices.size() / 3;
+        adjacency_offsets.assign(vertex_count + 1, 0);
+        for (uint32_t index : indices)
+            adjacency_offsets[index + 1]++;
+        for (size_t v = 0; v < vertex_count; v++)
+            adjacency_offsets[v + 1] += adjacency_offsets[v];
+        adjacency.resize(indices.size());
+        {
+            vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+            for (size_t f = 0; f < face_count; f++)
+                for (size_t c = 0; c < 3; c++)
+                    adjacency[fill[indices[f * 3 + c]]++] = static_cast<uint32_t>(f);
+        }
+
+        // every edge of every triangle, moving the unlocked end that costs less onto the other.
+        collapses.clear();
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (size_t e = 0; e < 3; e++) {
+                uint32_t a = indices[i + e], b = indices[i + (e + 1) % 3];
+                if (a > b)
+                    std::swap(a, b);
+                if (a == b || (locked[a] && locked[b]))
+                    continue;
+                float a_to_b = locked[a] ? INFINITY : quadrics[a].error(positions[b]);
+                float b_to_a = locked[b] ? INFINITY : quadrics[b].error(positions[a]);
+                if (a_to_b <= b_to_a)
+                    collapses.push_back({a, b, a_to_b});
+                else
+                    collapses.push_back({b, a, b_to_a});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const edge_collapse& l, const edge_collapse& r) {
+            if (l.error != r.error)
+                return l.error < r.error;
+            return edge_key(l.from, l.to) < edge_key(r.from, r.to);
+        });
+
+        for (size_t v = 0; v < vertex_count; v++)
+            remap[v] = static_cast<uint32_t>(v);
+        std::fill(touched.begin(), touched.end(), 0);
+        size_t triangles_needed = (indices.size() - target_index_count + 2) / 3;
+        size_t triangles_removed = 0;
+        for (const edge_collapse& collapse : collapses) {
+            if (collapse.error > max_error_squared || triangles_removed >= triangles_needed)
+                break;
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+            // triangles around from that stay must not turn over once from sits on to.
+            bool flips = false;
+            size_t shared = 0;
+            for (uint32_t t = adjacency_offsets[collapse.from]; t < adjacency_offsets[collapse.from + 1] && !flips; t++) {
+                const uint32_t* face = &indices[adjacency[t] * 3];
+                uint32_t corners[3] = {remap[face[0]], remap[face[1]], remap[face[2]]};
+                if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to) {
+                    shared++;
+                    continue;
+                }
+                glm::vec3 before[3], after[3];
+                for (size_t c = 0; c < 3; c++) {
+                    before[c] = positions[corners[c]];
+                    after[c] = corners[c] == collapse.from ? positions[collapse.to] : before[c];
+                }
+                glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::vec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+                // turning by more than about 75 degrees counts too, slivers tend to flip in the next pass.
+                flips = glm::dot(normal_before, normal_after) <= 0.25f * glm::length(normal_before) * glm::length(normal_after);
+            }
+            if (flips)
+                continue;
+            remap[collapse.from] = collapse.to;
+            touched[collapse.from] = touched[collapse.to] = 1;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            result_error = std::max(result_error, collapse.error);
+            triangles_removed += shared;
+        }
+        if (triangles_removed == 0)
+            break;
+
+        size_t kept = 0;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            uint32_t a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            indices[kept++] = a;
+            indices[kept++] = b;
+            indices[kept++] = c;
+        }
+        indices.resize(kept);
+    }
+
+    if (out_error)
+        *out_error = std::sqrt(result_error);
+    return indices;
+}
+
+vector<mesh_lod> mesh_simplifier::generate_lods(const vector<vertex>& vertices, const vector<uint32_t>& indices, vector<uint32_t>& lod_indices) {
+    vector<mesh_lod> ret;
+    size_t levels = lod_levels;
+    float reduction = std::clamp(static_cast<float>(lod_reduction), 0.0f, 1.0f);
+    float max_error = lod_max_error;
+    size_t previous_count = indices.size();
+    float target = static_cast<float>(indices.size() / 3);
+    for (size_t level = 0; level < levels; level++) {
+        target *= reduction;
+        size_t target_count = static_cast<size_t>(target) * 3;
+        // every level starts from full detail, chaining them would stack their errors.
+        float error = 0.0f;
+        vector<uint32_t> simplified = simplify(vertices, indices, target_count, max_error, &error);
+        // a level that gets less than half way to its target costs memory and saves little.
+        size_t halfway = target_count < previous_count ? previous_count - (previous_count - target_count) / 2 : target_count;
+        if (simplified.empty() || simplified.size() >= previous_count || simplified.size() > halfway)
+            break;
+        if (mesh_optimizer::enabled)
+            mesh_optimizer::optimize_vertex_cache(simplified, vertices.size());
+        ret.push_back({
+            static_cast<uint32_t>(indices.size() + lod_indices.size()),
+            static_cast<uint32_t>(simplified.size()),
+            error
+        });
+        lod_indices.insert(lod_indices.end(), simplified.begin(), simplified.end());
+        previous_count = simplified.size();
+    }
+    return ret;
+}
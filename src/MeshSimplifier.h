@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include "VertexLayout.h"
+
+using std::vector;
+
+// One level of detail, a range of the mesh's index allocation drawn over the same vertices.
+struct mesh_lod {
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+    // how far the simplified surface may be from the original, relative to the mesh's size.
+    float error = 0.0f;
+};
+
+// Quadric error edge collapse simplification.  Vertices only move onto other vertices, so every
+// level of detail is an index buffer over the vertices of the full detail mesh.
+class mesh_simplifier {
+public:
+    // collapses edges in order of their quadric error until indices has at most target_index_count
+    // indices or the next collapse would move the surface by more than max_error, relative to the
+    // mesh's extent.  Open borders and vertices that share a position with others (uv and normal
+    // seams) stay in place, so simplified meshes do not tear.  error gets the largest collapse error.
+    static vector<uint32_t> simplify(const vector<vertex>& vertices, const vector<uint32_t>& indices, size_t target_index_count, float max_error, float* error = nullptr);
+    // simplifies indices into levels that each have lod_reduction the triangles of the last.
+    // Their indices are appended to lod_indices, first_index counts on from the end of indices.
+    // Stops at the first level the error limit keeps from shrinking enough.
+    static vector<mesh_lod> generate_lods(const vector<vertex>& vertices, const vector<uint32_t>& indices, vector<uint32_t>& lod_indices);
+
+    // imports generate up to levels reduced levels per mesh, 0 turns generation off.
+    static inline void set_lod_generation(size_t levels, float reduction, float max_error) {
+        lod_levels = levels;
+        lod_reduction = reduction;
+        lod_max_error = max_error;
+    }
+    static inline size_t get_lod_generation() {
+        return lod_levels;
+    }
+    // read from the import thread.
+    static inline std::atomic<size_t> lod_levels = 0;
+    static inline std::atomic<float> lod_reduction = 0.5f;
+    static inline std::atomic<float> lod_max_error = 0.02f;
+};
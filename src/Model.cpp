@@ -1,10 +1,27 @@
 #include "Model.h"
 #include "Animation.h"
+#include <functional>
+#include <algorithm>
+#include <cmath>
 
-#define ATTENUATION_THRESHOLD 0.003
+static const uniform_id UNIFORM_MODEL = intern_uniform("model");
+static const uniform_id UNIFORM_VIEW = intern_uniform("view");
+static const uniform_id UNIFORM_PROJECTION = intern_uniform("projection");
+static const uniform_id UNIFORM_VIEW_POS = intern_uniform("viewPos");
+static const uniform_id UNIFORM_AMBIENT_LIGHT = intern_uniform("ambient_light");
+static const uniform_id UNIFORM_TOTAL_POINT_LIGHTS = intern_uniform("total_point_lights");
+static const uniform_id UNIFORM_TOTAL_DIRECTIONAL_LIGHTS = intern_uniform("total_directional_lights");
+static const uniform_id UNIFORM_TOTAL_SPOT_LIGHTS = intern_uniform("total_spot_lights");
 
 void model::play_animation(const string& animation) {
-    animation_player->play(animations[animation]);
+    animation_player->play(get_animation(animation));
+}
+
+animation* model::get_animation(const string& name) {
+    auto it = animations.find(name);
+    if (it == animations.end())
+        throw std::runtime_error("Model has no animation named: " + name);
+    return it->second;
 }
 
 model::~model() {
@@ -15,91 +32,237 @@ model::~model() {
 
 model::model(RC<mesh_dict*>* mesh_data, bool animated) : mesh_data(mesh_data), animated(animated), animation_player(new animator(nullptr)) {}
 
-void model::render_meshdict(RC<mesh_dict*>* _mesh_data, object3d* obj, camera& camera, window* window) {
-    for (auto [_mesh_name, _mesh_variant] : *_mesh_data->data) {
-        if (std::holds_alternative<rc_mesh>(_mesh_variant)) {
-            auto _mesh = std::get<rc_mesh>(_mesh_variant);
+void model::build_draw_list() {
+    this->draw_list.clear();
+    this->draw_list_sources.clear();
+    std::function<void(mesh_dict*)> visit = [&](mesh_dict* _mesh_data) {
+        this->draw_list_sources.push_back({_mesh_data, _mesh_data->version});
+        for (const auto& [_mesh_name, _mesh_variant] : _mesh_data->data) {
+            if (auto _mesh = std::get_if<rc_mesh>(&_mesh_variant)) {
+                if (!*_mesh)
+                    continue;
+                mesh* msh = (*_mesh)->data;
+                this->draw_list.push_back({
+                    msh,
+                    msh->gl_VAO,
+                    static_cast<GLsizei>(msh->indicies_size),
+                    msh->index_type,
+                    msh->geometry,
+                    msh->mesh_material->data,
+                    msh->aabb_min.axis,
+                    msh->aabb_max.axis
+                });
+            } else if (auto _mesh_dict = std::get_if<rc_mesh_dict>(&_mesh_variant)) {
+                if (*_mesh_dict)
+                    visit((*_mesh_dict)->data);
+            }
+        }
+    };
+    visit(this->mesh_data->data);
 
+    this->radius = 0.0f;
+    this->lod_count = 1;
+    for (const mesh_draw_record& record : this->draw_list) {
+        this->radius = std::max(this->radius, record.msh->radius);
+        this->lod_count = std::max(this->lod_count, record.msh->lods.size() + 1);
+    }
 
-            // set mvp
-            obj->mat->data->use_material();
+    this->aabb_min = vec3(0.0f, 0.0f, 0.0f);
+    this->aabb_max = vec3(0.0f, 0.0f, 0.0f);
+    if (!this->draw_list.empty()) {
+        this->aabb_min.axis = this->draw_list[0].aabb_min;
+        this->aabb_max.axis = this->draw_list[0].aabb_max;
+        for (const mesh_draw_record& record : this->draw_list) {
+            this->aabb_min.axis = glm::min(this->aabb_min.axis, record.aabb_min);
+            this->aabb_max.axis = glm::max(this->aabb_max.axis, record.aabb_max);
+        }
+    }
+}
 
-            obj->mat->data->set_uniform("model", obj->model_matrix);
-            obj->mat->data->set_uniform("view", camera.view);
-            obj->mat->data->set_uniform("projection", camera.projection);
+vector<vec3> model::gather_mesh_verticies() {
+    vector<vec3> ret;
+    for (const mesh_draw_record& record : this->get_draw_list()) {
+        auto positions = record.msh->get_positions();
+        vec_extend(ret, positions);
+    }
+    return ret;
+}
 
-            // camera view pos
-            obj->mat->data->set_uniform("viewPos", *camera.position);
+uint8_t model::select_lod(const object3d* obj, const camera& camera) {
+    size_t max_level = std::min({this->lod_count - 1, lod_screen_sizes.size(), size_t(UINT8_MAX)});
+    if (max_level == 0)
+        return 0;
+    const glm::mat4& world = obj->model_matrix.mat;
+    float scale = std::max({glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))});
+    float radius = this->radius * scale;
+    float distance = glm::distance(glm::vec3(world[3]), camera.position->axis);
+    // the sphere's projected diameter over the screen height.
+    float size = distance > radius ? radius / (distance * std::tan(camera.fov * 0.5f)) : 1.0f;
 
-            // ambient light
-            obj->mat->data->set_uniform("ambient_light", *window->ambient_light);
+    size_t level = std::min<size_t>(obj->lod_level, max_level);
+    while (level < max_level && size < lod_screen_sizes[level] * (1.0f - lod_hysteresis))
+        level++;
+    while (level > 0 && size > lod_screen_sizes[level - 1] * (1.0f + lod_hysteresis))
+        level--;
+    return static_cast<uint8_t>(level);
+}
 
-            _mesh->data->mesh_material->data->set_material_fallback(
-                obj->mat,
-                obj->mat->data->diffuse_texture != nullptr,
-                obj->mat->data->specular_texture != nullptr,
-                obj->mat->data->normals_texture != nullptr,
-                use_default_material_properties
-            );
+// where a level's indices start in the mesh's index allocation.
+static inline const void* lod_index_pointer(const mesh_draw_record& record, const mesh_lod& lod) {
+    return static_cast<const char*>(record.geometry->index_pointer()) + lod.first_index * index_type_size(record.index_type);
+}
 
-            obj->mat->data->register_uniforms();
-            obj->register_uniforms(); // register object level uniforms
+void model::queue_draw_list(object3d* obj, const instance_batch* batch, float depth, bool cull_meshes, camera& camera, window* window) {
+    material* obj_mat = obj->mat->data;
+    GLuint program = batch ? obj_mat->get_instanced_variant()->data->shader_program : obj_mat->shader_program;
+    // refreshed before queueing started, a rebuild now would move records that queued packets point at.
+    for (const mesh_draw_record& record : this->draw_list) {
+        if (cull_meshes && camera.view_frustum.test_aabb(record.aabb_min, record.aabb_max, obj->model_matrix.mat) == FrustumTest::OUTSIDE) {
+            window->gl_state.stats.meshes_culled++;
+            continue;
+        }
 
-            // Point Lights:
+        // same texture choice as set_material_fallback
+        rc_texture diffuse = obj_mat->diffuse_texture ? obj_mat->diffuse_texture : record.mat->diffuse_texture;
+        rc_texture specular = obj_mat->specular_texture ? obj_mat->specular_texture : record.mat->specular_texture;
 
-            size_t i = 0;
-            for (point_light* pl : window->render_list_point_lights) {
-                // calculate when to remove light by having an attenuation threshhold.
-                float l_distance = pl->position->distance(*obj->position);
-                float attenuation = 1.0 / (pl->constant + pl->linear * l_distance + (1/(pl->radius*pl->radius)) * (l_distance * l_distance));
-                if (attenuation > ATTENUATION_THRESHOLD) {
-                    pl->set_uniforms(obj->mat->data->shader_program, i);
-                    i++;
-                }
-            }
-            
-            obj->mat->data->set_uniform("total_point_lights", static_cast<int>(i));
-
-            // Directional Lights:
-            
-            i = 0;
-            for (directional_light* dl : window->render_list_directional_lights) {
-                dl->set_uniforms(obj->mat->data->shader_program, i);
+        window->queue.push(make_render_key(
+            RenderPass::GEOMETRY,
+            program,
+            diffuse ? diffuse->data->gl_texture : 0,
+            specular ? specular->data->gl_texture : 0,
+            record.vao,
+            depth,
+            camera.focal_length
+        ), obj, &record, batch);
+    }
+}
+
+void model::render_mesh(const mesh_draw_record& record, object3d* obj, camera& camera, window* window, gl_state_tracker& state) {
+    material* mat = obj->mat->data;
+
+    // set mvp
+    state.use_program(mat->shader_program);
+
+    mat->set_uniform(UNIFORM_MODEL, obj->model_matrix);
+
+    // shaders without the FrameData block still get the camera and ambient values per draw.
+    if (!mat->has_frame_block) {
+        mat->set_uniform(UNIFORM_VIEW, camera.view);
+        mat->set_uniform(UNIFORM_PROJECTION, camera.projection);
+
+        // camera view pos
+        mat->set_uniform(UNIFORM_VIEW_POS, *camera.position);
+
+        // ambient light
+        mat->set_uniform(UNIFORM_AMBIENT_LIGHT, *window->ambient_light);
+    }
+
+    record.mat->set_material_fallback(
+        obj->mat,
+        mat->diffuse_texture != nullptr,
+        mat->specular_texture != nullptr,
+        mat->normals_texture != nullptr,
+        use_default_material_properties,
+        state
+    );
+
+    // lights come from the LightData block when the shader declares it.
+    if (!mat->has_light_block) {
+        // Point Lights:
+
+        size_t i = 0;
+        for (point_light* pl : window->render_list_point_lights) {
+            // calculate when to remove light by having an attenuation threshhold.
+            float l_distance = pl->position->distance(*obj->position);
+            float attenuation = 1.0 / (pl->constant + pl->linear * l_distance + (1/(pl->radius*pl->radius)) * (l_distance * l_distance));
+            if (attenuation > ATTENUATION_THRESHOLD) {
+                pl->set_uniforms(mat, i);
                 i++;
             }
+        }
 
-            obj->mat->data->set_uniform("total_directional_lights", static_cast<int>(i));
+        mat->set_uniform(UNIFORM_TOTAL_POINT_LIGHTS, static_cast<int>(i));
 
-            // Spot Lights:
+        // Directional Lights:
 
-            i = 0; 
-            for (spot_light* sl : window->render_list_spot_lights) {
-                // calculate when to remove light by having an attenuation threshhold.
-                float l_distance = sl->position->distance(*obj->position);
-                float attenuation = 1.0 / (sl->constant + sl->linear * l_distance + (1/(sl->reach*sl->reach)) * (l_distance * l_distance));
-                if (attenuation > ATTENUATION_THRESHOLD) {
-                    sl->set_uniforms(obj->mat->data->shader_program, i);
-                    i++;
-                }
-            }
+        i = 0;
+        for (directional_light* dl : window->render_list_directional_lights) {
+            dl->set_uniforms(mat, i);
+            i++;
+        }
 
-            obj->mat->data->set_uniform("total_spot_lights", static_cast<int>(i));
-
-            // update animations
-            if (obj->model_data->data->animated)
-                obj->model_data->data->animation_player->set_uniforms(obj->mat);
-            
-            obj->mat->data->register_uniforms();
-
-            
-            glBindVertexArray(_mesh->data->gl_VAO);
-            
-            glDrawElements(GL_TRIANGLES, _mesh->data->indicies_size, GL_UNSIGNED_INT, 0);
-            
-            glBindVertexArray(0);
-        } else if (std::holds_alternative<rc_mesh_dict>(_mesh_variant)) {
-            auto _mesh_dict = std::get<rc_mesh_dict>(_mesh_variant);
-            this->render_meshdict(_mesh_dict, obj, camera, window);
+        mat->set_uniform(UNIFORM_TOTAL_DIRECTIONAL_LIGHTS, static_cast<int>(i));
+
+        // Spot Lights:
+
+        i = 0;
+        for (spot_light* sl : window->render_list_spot_lights) {
+            // calculate when to remove light by having an attenuation threshhold.
+            float l_distance = sl->position->distance(*obj->position);
+            float attenuation = 1.0 / (sl->constant + sl->linear * l_distance + (1/(sl->reach*sl->reach)) * (l_distance * l_distance));
+            if (attenuation > ATTENUATION_THRESHOLD) {
+                sl->set_uniforms(mat, i);
+                i++;
+            }
         }
+
+        mat->set_uniform(UNIFORM_TOTAL_SPOT_LIGHTS, static_cast<int>(i));
     }
-}
\ No newline at end of file
+
+    mat->register_uniforms();
+
+    // after the material's own uniforms so a stale value set by name cannot overwrite the pose.
+    if (this->animated)
+        obj->get_animator()->upload_palette(mat, state);
+
+    obj->register_uniforms(); // register object level uniforms
+
+    state.bind_vertex_array(record.vao);
+
+    mesh_lod lod = record.msh->get_lod(obj->lod_level);
+    glDrawElementsBaseVertex(GL_TRIANGLES, lod.index_count, record.index_type, lod_index_pointer(record, lod), record.geometry->base_vertex());
+    state.stats.draw_calls++;
+    state.stats.triangles += lod.index_count / 3;
+    state.stats.full_detail_triangles += record.index_count / 3;
+}
+
+void model::render_mesh_instanced(const mesh_draw_record& record, const instance_batch& batch, camera& camera, window* window, gl_state_tracker& state) {
+    // batches are only formed for objects without object level uniforms whose shaders read the light block.
+    auto variant = batch.first->mat->data->get_instanced_variant();
+    material* mat = variant->data;
+
+    state.use_program(mat->shader_program);
+
+    batch.first->mat->data->forward_uniforms(mat);
+
+    if (!mat->has_frame_block) {
+        mat->set_uniform(UNIFORM_VIEW, camera.view);
+        mat->set_uniform(UNIFORM_PROJECTION, camera.projection);
+        mat->set_uniform(UNIFORM_VIEW_POS, *camera.position);
+        mat->set_uniform(UNIFORM_AMBIENT_LIGHT, *window->ambient_light);
+    }
+
+    record.mat->set_material_fallback(
+        variant,
+        mat->diffuse_texture != nullptr,
+        mat->specular_texture != nullptr,
+        mat->normals_texture != nullptr,
+        use_default_material_properties,
+        state
+    );
+
+    mat->register_uniforms();
+
+    state.bind_vertex_array(record.vao);
+    window->instance_matrices->bind_attributes(batch.first_instance);
+
+    // batches only hold objects at the same level.
+    mesh_lod lod = record.msh->get_lod(batch.first->lod_level);
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, lod.index_count, record.index_type, lod_index_pointer(record, lod), batch.instance_count, record.geometry->base_vertex());
+    state.stats.draw_calls++;
+    state.stats.triangles += lod.index_count / 3 * batch.instance_count;
+    state.stats.full_detail_triangles += record.index_count / 3 * batch.instance_count;
+    state.stats.instanced_draw_calls++;
+    state.stats.instances += batch.instance_count;
+}
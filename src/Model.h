@@ -24,10 +24,19 @@ class model {
 public:
     model(){}
     model(RC<mesh_dict*>* mesh_data, bool animated);
-    inline void render(object3d* obj, camera& camera, window* window) {
-        render_meshdict(mesh_data, obj, camera, window);
+    // queues one draw per mesh, the window sorts and submits them.
+    // cull_meshes tests every mesh against the view frustum, for objects that straddle it.
+    inline void render(object3d* obj, camera& camera, window* window, bool cull_meshes = false) {
+        queue_draw_list(obj, nullptr, obj->position->distance(*camera.position), cull_meshes, camera, window);
     }
 
+    inline void render_instanced(const instance_batch& batch, camera& camera, window* window) {
+        queue_draw_list(batch.first, &batch, batch.depth, false, camera, window);
+    }
+
+    void render_mesh(const mesh_draw_record& record, object3d* obj, camera& camera, window* window, gl_state_tracker& state);
+    void render_mesh_instanced(const mesh_draw_record& record, const instance_batch& batch, camera& camera, window* window, gl_state_tracker& state);
+
     ~model();
     RC<mesh_dict*>* mesh_data = nullptr;
     bool use_default_material_properties = false;
@@ -37,11 +46,78 @@ public:
     vector<bone_info> bone_info_list;
     int bone_counter = 0;
     std::map<string, animation*> animations;
+    // skeletons and clips above are shared read only, playback state lives in animators.
     animator* animation_player = nullptr;
     object3d * owner = nullptr;
     //
 
+    vec3 aabb_min = vec3(0.0f, 0.0f, 0.0f);
+    vec3 aabb_max = vec3(0.0f, 0.0f, 0.0f);
+
+    // fractions of the screen height, objects whose bounding sphere projects smaller than
+    // lod_screen_sizes[i] draw at level of detail i + 1.
+    static inline vector<float> lod_screen_sizes = {0.5f, 0.25f, 0.125f, 0.0625f};
+    // how far past a threshold an object has to get before its level changes, so objects sitting
+    // on one do not switch back and forth.
+    static inline float lod_hysteresis = 0.1f;
+    static inline void set_lod_selection(const vector<float>& screen_sizes, float hysteresis) {
+        lod_screen_sizes = screen_sizes;
+        lod_hysteresis = hysteresis;
+    }
+    static inline vector<float> get_lod_screen_sizes() {
+        return lod_screen_sizes;
+    }
+    // the level obj should draw at from its projected size and the level it is at now.
+    // Reads the draw list as of the last refresh_draw_list, it runs while the frame is queued.
+    uint8_t select_lod(const object3d* obj, const camera& camera);
+
+    // plays animation on the animator shared by every object3d that has not played one of its own.
     void play_animation(const string& animation);
+    // throws when the model has no animation called name.
+    animation* get_animation(const string& name);
+
+    // whether mesh_data was replaced or one of this model's own dicts edited since the draw list was built.
+    inline bool draw_list_stale() const {
+        if (draw_list_sources.empty() || draw_list_sources[0].first != mesh_data->data)
+            return true;
+        // parents come before their children, so a dict cut out of the tree is never reached.
+        for (const auto& [dict, version] : draw_list_sources)
+            if (dict->version != version)
+                return true;
+        return false;
+    }
+
+    // render packets point into the draw list, so the window refreshes every model before it queues a
+    // frame and nothing rebuilds the list until the queue is submitted.
+    inline void refresh_draw_list() {
+        if (draw_list_stale())
+            build_draw_list();
+    }
+
+    // every mesh in mesh_data as one flat array, rebuilt only after one of this model's dicts was edited.
+    inline const vector<mesh_draw_record>& get_draw_list() {
+        refresh_draw_list();
+        return draw_list;
+    }
+
+    // the largest mesh radius, a bounding sphere around the model's origin.
+    inline float get_radius() {
+        get_draw_list();
+        return radius;
+    }
+
+    // union of the mesh bounds in model space, kept with the draw list.
+    inline const vec3& get_aabb_min() {
+        get_draw_list();
+        return aabb_min;
+    }
+
+    inline const vec3& get_aabb_max() {
+        get_draw_list();
+        return aabb_max;
+    }
+
+    vector<vec3> gather_mesh_verticies();
 
     inline RC<model*>* from_file(string file_path, bool animated) {
         return mesh::from_file(file_path, animated);
@@ -131,7 +207,14 @@ public:
 		}
     }
 private:
-    void render_meshdict(RC<mesh_dict*>* _mesh_data, object3d* obj, camera& camera, window* window);
+    void queue_draw_list(object3d* obj, const instance_batch* batch, float depth, bool cull_meshes, camera& camera, window* window);
+    void build_draw_list();
+    vector<mesh_draw_record> draw_list;
+    // every dict the draw list was flattened from, in visiting order, with its version at the time.
+    vector<std::pair<const mesh_dict*, size_t>> draw_list_sources;
+    float radius = 0.0f;
+    // 1 + the most reduced levels any mesh has.
+    size_t lod_count = 1;
 };
 
 typedef RC<model*>* rc_model;
\ No newline at end of file
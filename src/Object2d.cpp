@@ -8,6 +8,9 @@
 #include "Camera.h"
 #include "Window.h"
 
+static const uniform_id UNIFORM_PROJECTION = intern_uniform("projection");
+static const uniform_id UNIFORM_TRANSFORM2D = intern_uniform("transform2D");
+
 object2d::object2d(sprite* spr, camera * cam, vec2* position, float rotation, vec2* scale, rc_material mat, float depth)
 :
     spr(spr),
@@ -39,8 +42,9 @@ vec2 object2d::get_scaled_dimensions() {
 }
 
 void object2d::set_uniform(string name, uniform_type value) {
-    int loc = glGetUniformLocation(this->mat->data->shader_program, name.c_str());
-    this->inner_set_uniform(loc, value);
+    GLint loc = this->mat->data->get_uniform_location(name);
+    if (loc != -1)
+        this->inner_set_uniform(loc, value);
 }
 
 void object2d::render(camera& camera) {
@@ -50,13 +54,13 @@ void object2d::render(camera& camera) {
     this->mat->data->use_material(); // Use your shader program
 
     // Set uniforms like text color
-    this->mat->data->set_uniform("projection", matrix4x4::from_ortho(0.0f, (float)camera.view_width, 0.0f, (float)camera.view_height, -999999.0f, 999999.0f));
+    this->mat->data->set_uniform(UNIFORM_PROJECTION, matrix4x4::from_ortho(0.0f, (float)camera.view_width, 0.0f, (float)camera.view_height, -999999.0f, 999999.0f));
 
     transform2D = transform2D.translate(vec3(*this->position,0.0f));
     transform2D = transform2D.rotate(this->rotation, vec3(0.0f, 0.0f, 1.0f));
     transform2D = transform2D.scale(vec3(this->scale->axis, 1.0f));
 
-    this->mat->data->set_uniform("transform2D", transform2D);
+    this->mat->data->set_uniform(UNIFORM_TRANSFORM2D, transform2D);
 
     this->mat->data->register_uniforms();
     this->register_uniforms(); // register object level uniforms
@@ -13,12 +13,11 @@
 #include "Model.h"
 #include "Animation.h"
 
-#define ATTENUATION_THRESHOLD 0.003
-
 object3d::object3d(rc_model model_data, vec3* position, quaternion* rotation, vec3* scale, rc_material mat, RC<collider*>* collider) : model_data(model_data), position(position), rotation(rotation), scale(scale), mat(mat) {
     if (collider) {
         this->colliders.push_back(collider);
     }
+    this->update_transform();
 }
 
 std::ostream& operator<<(std::ostream& os, const object3d& self){
@@ -26,15 +25,93 @@ std::ostream& operator<<(std::ostream& os, const object3d& self){
     return os;
 }
   
-void object3d::render(camera& camera, window* window) {
-    // opengl renderer
-    this->get_model_matrix();
-
+void object3d::render(camera& camera, window* window, bool cull_meshes) {
+    // model_matrix is kept current by update_transform each frame.
     // render mesh tree
-    this->model_data->data->render(this, camera, window);
+    this->model_data->data->render(this, camera, window, cull_meshes);
+}
+
+object3d::~object3d() {
+    delete this->animation_player;
+    this->set_parent(nullptr);
+    for (object3d* child : this->children) {
+        child->parent = nullptr;
+        child->transform_cached = false;
+    }
+    if (!this->children.empty())
+        hierarchy_generation++;
+}
+
+void object3d::play_animation(const string& name, float speed, float start_time) {
+    animation* anim = this->model_data->data->get_animation(name);
+    if (!this->animation_player)
+        this->animation_player = new animator();
+    this->animation_player->speed = speed;
+    this->animation_player->play(anim, start_time * anim->ticks_per_second);
+}
+
+animator* object3d::get_animator() {
+    return this->animation_player ? this->animation_player : this->model_data->data->animation_player;
+}
+
+void object3d::set_parent(object3d* new_parent) {
+    if (new_parent == this->parent)
+        return;
+    for (object3d* ancestor = new_parent; ancestor; ancestor = ancestor->parent)
+        if (ancestor == this)
+            throw std::runtime_error("An object3d can not be parented to itself or one of its children.");
+
+    if (this->parent)
+        std::erase(this->parent->children, this);
+    this->parent = new_parent;
+    if (new_parent)
+        new_parent->children.push_back(this);
+    // forces the world matrix to be rebuilt against the new parent.
+    this->transform_cached = false;
+    hierarchy_generation++;
+}
+
+bool object3d::update_local_transform() {
+    glm::vec3 pos = this->position ? this->position->axis : glm::vec3(0.0f);
+    glm::quat rot = this->rotation ? this->rotation->quat : glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scl = this->scale ? this->scale->axis : glm::vec3(1.0f);
+    if (this->transform_cached && pos == this->last_position && rot == this->last_rotation && scl == this->last_scale)
+        return false;
+    this->last_position = pos;
+    this->last_rotation = rot;
+    this->last_scale = scl;
+    this->transform_cached = true;
+    this->local_matrix = glm::scale(glm::translate(glm::mat4(1.0f), pos) * glm::toMat4(rot), scl);
+    return true;
+}
+
+bool object3d::update_world_matrix() {
+    bool local_changed = this->update_local_transform();
+    if (!local_changed && (!this->parent || this->parent->transform_version == this->parent_version_seen))
+        return false;
+    if (this->parent) {
+        this->model_matrix = this->parent->model_matrix * this->local_matrix;
+        this->parent_version_seen = this->parent->transform_version;
+    } else {
+        this->model_matrix = this->local_matrix;
+    }
+    this->transform_version++;
+    return true;
+}
+
+bool object3d::update_transform() {
+    if (this->parent)
+        this->parent->update_transform();
+    return this->update_world_matrix();
+}
+
+aabb object3d::get_world_aabb() {
+    model* mdl = this->model_data->data;
+    return aabb{mdl->get_aabb_min().axis, mdl->get_aabb_max().axis}.transformed(this->model_matrix.mat);
 }
 
 void object3d::set_uniform(string name, uniform_type value) {
-    int loc = glGetUniformLocation(this->mat->data->shader_program, name.c_str());
-    this->inner_set_uniform(loc, value);
+    GLint loc = this->mat->data->get_uniform_location(name);
+    if (loc != -1)
+        this->inner_set_uniform(loc, value);
 }
@@ -8,6 +8,7 @@
 #include "Octree.h"
 #include "Colliders.h"
 #include "Matrix.h"
+#include "BVH.h"
 
 
 using std::vector;
@@ -16,6 +17,7 @@ class camera;
 class mesh_dict;
 class window;
 class model;
+class animator;
 
 typedef RC<model*>* rc_model;
 
@@ -25,7 +27,7 @@ public:
     object3d(){};
     object3d(rc_model model_data, vec3* position, quaternion* rotation, vec3* scale, rc_material mat = nullptr, RC<collider*>* collider = nullptr);
     
-    ~object3d(){}
+    ~object3d();
 
     rc_model model_data;
     vec3* position = nullptr;
@@ -35,26 +37,50 @@ public:
     map<int, uniform_type> uniforms;
     vector<RC<collider*>*> colliders;
     octree<RC<collider*>*>* all_colliders;
-    matrix4x4 model_matrix = get_model_matrix();
+    // world transform, parent's model_matrix * local_matrix.
+    matrix4x4 model_matrix = matrix4x4(1.0f);
+    matrix4x4 local_matrix = matrix4x4(1.0f);
+    // bumped every time model_matrix changes, children and colliders compare against it.
+    size_t transform_version = 0;
+
+    // the level of detail the model is drawn at, the window picks it every frame.
+    uint8_t lod_level = 0;
+
+    // this object's own playback of its model's animations, nullptr until it plays one.
+    animator* animation_player = nullptr;
+    // plays the model's animation at speed times its rate, start_time seconds in.
+    void play_animation(const string& name, float speed = 1.0f, float start_time = 0.0f);
+    // the animator this object is drawn with, the model's shared one when it has none of its own.
+    animator* get_animator();
+
+    object3d* parent = nullptr;
+    vector<object3d*> children;
+    // bumped by every set_parent, the window rebuilds its parent before child order when it moves.
+    static inline size_t hierarchy_generation = 0;
+    // nullptr detaches, throws when new_parent is this object or one of its descendants.
+    void set_parent(object3d* new_parent);
 
     void set_uniform(string name, uniform_type value);
 
-    void render(camera& camera, window* window);
+    void render(camera& camera, window* window, bool cull_meshes = false);
 
     friend std::ostream& operator<<(std::ostream& os, const object3d& self);
 
     inline matrix4x4 get_model_matrix() {
-        matrix4x4 model = matrix4x4(1.0f);
-        if (this->position)
-            model = model.translate(this->position);
-        if (this->rotation)
-            model = model * matrix4x4(this->rotation);
-        if (this->scale)
-            model = model.scale(this->scale);
-        this->model_matrix = model;
-        return model;
+        this->update_transform();
+        return this->model_matrix;
     }
 
+    // rebuilds local_matrix when position, rotation or scale changed since the last call.
+    // Python edits the vectors in place, so changes are found by comparing against a cached copy.
+    bool update_local_transform();
+    // recomputes model_matrix when the local transform or the parent's world transform changed.
+    // Expects the parent to be up to date already, the window calls it parents first.
+    bool update_world_matrix();
+    // brings the ancestors and then this object up to date, returns true when model_matrix changed.
+    bool update_transform();
+    // bounds of the model after model_matrix.
+    aabb get_world_aabb();
 
 
     inline bool check_collision_point(vec3 point) {
@@ -74,4 +100,11 @@ public:
         }
         return false;
     }
+
+private:
+    glm::vec3 last_position = glm::vec3(0.0f);
+    glm::quat last_rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 last_scale = glm::vec3(1.0f);
+    bool transform_cached = false;
+    size_t parent_version_seen = 0;
 };
\ No newline at end of file
@@ -1,29 +1,54 @@
 #include "PointLight.h"
 #include <sstream>
 
-void point_light::set_uniforms(GLuint shader_prog, size_t index) {
-    std::stringstream ss;
-    ss << "point_lights[" << index << "].";
-    auto prefix = ss.str();
+struct point_light_uniform_ids {
+    uniform_id position, color, radius, constant, linear, quadratic, intensity;
+};
+
+// names for point_lights[index] are built once and reused every frame.
+static const point_light_uniform_ids& get_uniform_ids(size_t index) {
+    static vector<point_light_uniform_ids> ids;
+    while (ids.size() <= index) {
+        std::stringstream ss;
+        ss << "point_lights[" << ids.size() << "].";
+        auto prefix = ss.str();
+        ids.push_back({
+            intern_uniform(prefix + "position"),
+            intern_uniform(prefix + "color"),
+            intern_uniform(prefix + "radius"),
+            intern_uniform(prefix + "constant"),
+            intern_uniform(prefix + "linear"),
+            intern_uniform(prefix + "quadratic"),
+            intern_uniform(prefix + "intensity")
+        });
+    }
+    return ids[index];
+}
+
+void point_light::set_uniforms(material* mat, size_t index) {
+    const auto& ids = get_uniform_ids(index);
     // set struct parameters
-    GLuint position_loc = glGetUniformLocation(shader_prog, (prefix + "position").c_str());
-    glUniform3fv(position_loc, 1, glm::value_ptr(this->position->axis));
+    glUniform3fv(mat->get_uniform_location(ids.position), 1, glm::value_ptr(this->position->axis));
+
+    glUniform3fv(mat->get_uniform_location(ids.color), 1, glm::value_ptr(this->color->axis));
+
+    glUniform1f(mat->get_uniform_location(ids.radius), this->radius);
 
-    GLuint color_loc = glGetUniformLocation(shader_prog, (prefix + "color").c_str());
-    glUniform3fv(color_loc, 1, glm::value_ptr(this->color->axis));
+    glUniform1f(mat->get_uniform_location(ids.constant), this->constant);
 
-    GLuint radius_loc = glGetUniformLocation(shader_prog, (prefix + "radius").c_str());
-    glUniform1f(radius_loc, this->radius);
+    glUniform1f(mat->get_uniform_location(ids.linear), this->linear);
 
-    GLuint constant_loc = glGetUniformLocation(shader_prog, (prefix + "constant").c_str());
-    glUniform1f(constant_loc, this->constant);
+    glUniform1f(mat->get_uniform_location(ids.quadratic), 1/(this->radius*this->radius));
 
-    GLuint linear_loc = glGetUniformLocation(shader_prog, (prefix + "linear").c_str());
-    glUniform1f(linear_loc, this->linear);
+    glUniform1f(mat->get_uniform_location(ids.intensity), this->intensity);
+}
 
-    GLuint quadratic_loc = glGetUniformLocation(shader_prog, (prefix + "quadratic").c_str());
-    glUniform1f(quadratic_loc, 1/(this->radius*this->radius));
+void point_light::pack(std140_point_light& out) const {
+    out.position = glm::vec4(this->position->axis, this->radius);
+    out.color = glm::vec4(this->color->axis, this->intensity);
+    out.attenuation = glm::vec4(this->constant, this->linear, 1/(this->radius*this->radius), 0.0f);
+}
 
-    GLuint intensity_loc = glGetUniformLocation(shader_prog, (prefix + "intensity").c_str());
-    glUniform1f(intensity_loc, this->intensity);
-}
\ No newline at end of file
+float point_light::influence_radius() const {
+    return light_clusters::attenuation_range(this->constant, this->linear, 1/(this->radius*this->radius));
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include "glad/gl.h"
 #include "Object3d.h"
+#include "UniformBuffer.h"
+#include "LightClusters.h"
 #include "Vec3.h"
 
 class point_light {
@@ -15,7 +17,11 @@ public:
     float constant = 1.0f;
     float linear = 0.09f;
     float quadratic = 0.032f;
-    void set_uniforms(GLuint shader_prog, size_t index);
+    void set_uniforms(material* mat, size_t index);
+    // writes the light into its slot of the per-frame light uniform buffer.
+    void pack(std140_point_light& out) const;
+    // distance past which the light is culled.
+    float influence_radius() const;
     friend inline std::ostream& operator<<(std::ostream& os, const point_light& self){
         os << "point_light{ position: " << *self.position << ", radius: " << self.radius << ", color: " << *self.color << " }";
         return os;
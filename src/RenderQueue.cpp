@@ -0,0 +1,127 @@
+#include "RenderQueue.h"
+#include "Model.h"
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+
+uint64_t make_render_key(RenderPass pass, GLuint program, GLuint diffuse_texture, GLuint specular_texture, GLuint vao, float depth, float max_depth) {
+    // ids are truncated, a collision only costs a redundant bind.
+    uint64_t textures = ((diffuse_texture & 0xFF) << 8) | (specular_texture & 0xFF);
+    float normalized = max_depth > 0.0f ? std::clamp(depth / max_depth, 0.0f, 1.0f) : 0.0f;
+    uint64_t depth_bits = static_cast<uint64_t>(normalized * 0xFFFF);
+    if (pass == RenderPass::TRANSLUCENT)
+        depth_bits = 0xFFFF - depth_bits;
+    return (static_cast<uint64_t>(pass) & 0x3) << 62
+        | (static_cast<uint64_t>(program) & 0x3FFF) << 48
+        | textures << 32
+        | (static_cast<uint64_t>(vao) & 0xFFFF) << 16
+        | depth_bits;
+}
+
+void gl_state_tracker::invalidate() {
+    this->program = 0xFFFFFFFF;
+    this->vao = 0xFFFFFFFF;
+    this->active_unit = 0xFFFFFFFF;
+    std::fill(std::begin(this->textures), std::end(this->textures), 0xFFFFFFFF);
+    this->palette_program = 0xFFFFFFFF;
+    this->palette = nullptr;
+}
+
+void gl_state_tracker::use_program(GLuint program) {
+    if (this->program == program) {
+        this->stats.program_binds_skipped++;
+        return;
+    }
+    glUseProgram(program);
+    this->program = program;
+    this->stats.program_binds++;
+}
+
+void gl_state_tracker::bind_texture(GLuint unit, GLuint texture) {
+    if (unit < TRACKED_TEXTURE_UNITS && this->textures[unit] == texture) {
+        this->stats.texture_binds_skipped++;
+        return;
+    }
+    if (this->active_unit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        this->active_unit = unit;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (unit < TRACKED_TEXTURE_UNITS)
+        this->textures[unit] = texture;
+    this->stats.texture_binds++;
+}
+
+void gl_state_tracker::bind_vertex_array(GLuint vao) {
+    if (this->vao == vao) {
+        this->stats.vao_binds_skipped++;
+        return;
+    }
+    glBindVertexArray(vao);
+    this->vao = vao;
+    this->stats.vao_binds++;
+}
+
+void gl_state_tracker::upload_bone_palette(GLint location, const glm::mat4* palette, size_t count) {
+    if (location < 0 || count == 0)
+        return;
+    if (this->palette_program == this->program && this->palette == palette) {
+        this->stats.bone_palette_uploads_skipped++;
+        return;
+    }
+    glUniformMatrix4fv(location, static_cast<GLsizei>(count), GL_FALSE, glm::value_ptr(*palette));
+    this->palette_program = this->program;
+    this->palette = palette;
+    this->stats.bone_palette_uploads++;
+}
+
+instance_buffer::~instance_buffer() {
+    if (this->gl_VBO)
+        glDeleteBuffers(1, &this->gl_VBO);
+}
+
+void instance_buffer::update(const vector<glm::mat4>& matrices) {
+    if (!this->gl_VBO)
+        glGenBuffers(1, &this->gl_VBO);
+    size_t size = matrices.size() * sizeof(glm::mat4);
+    glBindBuffer(GL_ARRAY_BUFFER, this->gl_VBO);
+    if (size > this->capacity || this->capacity == 0)
+        this->capacity = std::max({size, this->capacity * 2, sizeof(glm::mat4) * 64});
+    // orphan the old storage so the driver does not stall on the previous frame.
+    glBufferData(GL_ARRAY_BUFFER, this->capacity, nullptr, GL_STREAM_DRAW);
+    if (size)
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, matrices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void instance_buffer::bind_attributes(size_t first_instance) {
+    glBindBuffer(GL_ARRAY_BUFFER, this->gl_VBO);
+    size_t offset = first_instance * sizeof(glm::mat4);
+    // a mat4 attribute takes one location per column.
+    for (GLuint column = 0; column < 4; column++) {
+        GLuint location = MODEL_MATRIX_LOCATION + column;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void render_queue::submit(camera& cam, window* win, gl_state_tracker& state) {
+    std::sort(this->packets.begin(), this->packets.end(), [](const render_packet& a, const render_packet& b) {
+        return a.key < b.key;
+    });
+
+    state.invalidate();
+    for (const render_packet& packet : this->packets) {
+        if (packet.batch)
+            packet.obj->model_data->data->render_mesh_instanced(*packet.record, *packet.batch, cam, win, state);
+        else
+            packet.obj->model_data->data->render_mesh(*packet.record, packet.obj, cam, win, state);
+    }
+
+    // the rest of the frame binds without the tracker and expects these defaults.
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+    state.invalidate();
+    this->packets.clear();
+}
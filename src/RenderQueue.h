@@ -0,0 +1,114 @@
+#pragma once
+#include "glad/gl.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using std::vector;
+
+class object3d;
+struct mesh_draw_record;
+class camera;
+class window;
+
+// Draws are ordered by this key, most significant field first:
+// | pass 2 | program 14 | textures 16 | vao 16 | depth 16 |
+enum class RenderPass : uint8_t {
+    GEOMETRY = 0, // front to back
+    TRANSLUCENT = 1 // back to front
+};
+
+uint64_t make_render_key(RenderPass pass, GLuint program, GLuint diffuse_texture, GLuint specular_texture, GLuint vao, float depth, float max_depth);
+
+// Objects sharing a model and material drawn with one instanced call per mesh.
+// Their model matrices sit in the frame's instance_buffer starting at first_instance.
+struct instance_batch {
+    object3d* first; // supplies the model and material
+    size_t first_instance;
+    size_t instance_count;
+    float depth; // of the nearest instance
+};
+
+struct render_packet {
+    uint64_t key;
+    object3d* obj;
+    const mesh_draw_record* record; // points into the model's draw list
+    const instance_batch* batch; // nullptr for single draws
+};
+
+// Counters for one frame, reset at the start of window::update.
+struct render_stats {
+    size_t draw_calls = 0;
+    size_t program_binds = 0;
+    size_t program_binds_skipped = 0;
+    size_t texture_binds = 0;
+    size_t texture_binds_skipped = 0;
+    size_t vao_binds = 0;
+    size_t vao_binds_skipped = 0;
+    size_t instanced_draw_calls = 0;
+    size_t instances = 0;
+    size_t objects_culled = 0;
+    size_t meshes_culled = 0;
+    size_t emitters_culled = 0;
+    // triangles drawn at the selected levels of detail, and what full detail would have drawn.
+    size_t triangles = 0;
+    size_t full_detail_triangles = 0;
+    // bone palettes uploaded with one call each, and submeshes that found theirs already in the program.
+    size_t bone_palette_uploads = 0;
+    size_t bone_palette_uploads_skipped = 0;
+    // skeletons posed this frame, and animators that drew with another's identical pose.
+    size_t poses = 0;
+    size_t poses_shared = 0;
+};
+
+// Remembers the bound GL objects so repeated binds can be skipped.
+// Code outside the queue binds without it, so call invalidate() before relying on the cache.
+class gl_state_tracker {
+public:
+    static constexpr size_t TRACKED_TEXTURE_UNITS = 16;
+
+    void invalidate();
+    void use_program(GLuint program);
+    void bind_texture(GLuint unit, GLuint texture);
+    void bind_vertex_array(GLuint vao);
+    // uploads count matrices to the array at location of the bound program, unless this palette
+    // was the last one uploaded to it.  Palettes must not change while the cache is valid.
+    void upload_bone_palette(GLint location, const glm::mat4* palette, size_t count);
+
+    render_stats stats;
+private:
+    // 0xFFFFFFFF marks unknown state.
+    GLuint program = 0xFFFFFFFF;
+    GLuint vao = 0xFFFFFFFF;
+    GLuint active_unit = 0xFFFFFFFF;
+    GLuint textures[TRACKED_TEXTURE_UNITS];
+    GLuint palette_program = 0xFFFFFFFF;
+    const glm::mat4* palette = nullptr;
+};
+
+// Model matrices of every instanced batch in the frame, read at attribute locations 5-8.
+class instance_buffer {
+public:
+    static constexpr GLuint MODEL_MATRIX_LOCATION = 5;
+
+    instance_buffer(){}
+    ~instance_buffer();
+    void update(const vector<glm::mat4>& matrices);
+    // points the bound VAO's instance attributes at a batch.
+    void bind_attributes(size_t first_instance);
+
+    GLuint gl_VBO = 0;
+    size_t capacity = 0;
+};
+
+class render_queue {
+public:
+    inline void push(uint64_t key, object3d* obj, const mesh_draw_record* record, const instance_batch* batch = nullptr) {
+        packets.push_back({key, obj, record, batch});
+    }
+    // sorts and draws every packet then clears the queue.
+    void submit(camera& cam, window* win, gl_state_tracker& state);
+
+    vector<render_packet> packets;
+};
@@ -1,6 +1,11 @@
 #include "Shader.h"
 #include <fstream>
 #include <sstream>
+#include <unordered_map>
+#include <map>
+#include <mutex>
+
+static std::mutex shared_mutex;
 
 shader::shader(string source, ShaderType type) : source(source), type(type) {
     this->compile();
@@ -18,6 +23,75 @@ shader* shader::from_file(string filepath, ShaderType type) {
     return new shader(buffer.str(), type);
 }
 
+RC<shader*>* shader::shared(const string& source, ShaderType type) {
+    static std::unordered_map<uint64_t, RC<shader*>*> by_key;
+    shader* candidate = new shader();
+    candidate->source = source;
+    candidate->type = type;
+
+    std::lock_guard<std::mutex> lock(shared_mutex);
+    auto [it, inserted] = by_key.try_emplace(candidate->cache_key(), nullptr);
+    if (inserted) {
+        it->second = new RC(candidate); // the cache keeps the first reference.
+    } else {
+        delete candidate;
+    }
+    it->second->inc();
+    return it->second;
+}
+
+RC<shader*>* shader::shared_from_file(const string& filepath, ShaderType type) {
+    static std::map<std::pair<string, ShaderType>, RC<shader*>*> by_path;
+    {
+        std::lock_guard<std::mutex> lock(shared_mutex);
+        auto it = by_path.find({filepath, type});
+        if (it != by_path.end()) {
+            it->second->inc();
+            return it->second;
+        }
+    }
+    std::ifstream fileStream(filepath);
+    if (!fileStream.is_open()) {
+        throw std::runtime_error("Could not open file: " + filepath);
+    }
+    std::stringstream buffer;
+    buffer << fileStream.rdbuf() << std::endl;
+    fileStream.close();
+
+    RC<shader*>* ret = shared(buffer.str(), type);
+    std::lock_guard<std::mutex> lock(shared_mutex);
+    auto [it, inserted] = by_path.try_emplace({filepath, type}, ret);
+    if (inserted)
+        ret->inc(); // held by the path cache.
+    return ret;
+}
+
+uint64_t shader::cache_key() const {
+    // FNV-1a over the source, seeded with the stage type.
+    uint64_t hash = 14695981039346656037ull ^ static_cast<uint64_t>(this->type);
+    for (unsigned char c : this->source) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+shader* shader::with_define(const string& name) const {
+    string src = this->source;
+    size_t insert_at = 0;
+    size_t version = src.find("#version");
+    if (version != string::npos) {
+        size_t line_end = src.find('\n', version);
+        insert_at = line_end == string::npos ? src.size() : line_end + 1;
+    }
+    src.insert(insert_at, "#define " + name + "\n");
+
+    shader* ret = new shader();
+    ret->source = src;
+    ret->type = this->type;
+    return ret;
+}
+
 void shader::compile() {
     switch (this->type)
     {
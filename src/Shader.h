@@ -1,9 +1,11 @@
 #pragma once
 #include <string>
 #include <iostream>
+#include <cstdint>
 #include "glad/gl.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_opengl.h>
+#include "RC.h"
 
 using std::string;
 
@@ -41,9 +43,21 @@ public:
     shader(){};
     shader(string source, ShaderType type);
     static shader* from_file(string filepath, ShaderType type);
+    // Process wide, uncompiled shader for this stage and source, shared with every other caller asking for it.
+    // The returned reference belongs to the caller.
+    static RC<shader*>* shared(const string& source, ShaderType type);
+    // shared() with the source read from filepath, every path is read once.
+    static RC<shader*>* shared_from_file(const string& filepath, ShaderType type);
+    // uncompiled copy with "#define name" inserted after the #version line.
+    shader* with_define(const string& name) const;
     void compile();
+    // stage type and source hash, equal keys mean the compiled shaders are interchangeable.
+    uint64_t cache_key() const;
     string source;
     ShaderType type;
-    GLuint shader_handle;
+    // 0 while not compiled, programs delete it once they are linked.
+    GLuint shader_handle = 0;
 };
 
+typedef RC<shader*>* rc_shader;
+
@@ -0,0 +1,95 @@
+#include "Skeleton.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <unordered_map>
+
+skeleton::skeleton(const assimp_node_data& root, const vector<bone>& channels, const vector<bone_info>& bone_infos) {
+    // first match wins, like the name searches this replaces.
+    std::unordered_map<string, int> channel_ids;
+    for (size_t i = 0; i < channels.size(); i++)
+        channel_ids.try_emplace(channels[i].name, static_cast<int>(i));
+    std::unordered_map<string, size_t> bone_info_ids;
+    for (size_t i = 0; i < bone_infos.size(); i++) {
+        bone_info_ids.try_emplace(bone_infos[i].name, i);
+        if (bone_infos[i].id >= 0)
+            this->palette_size = std::max(this->palette_size, static_cast<size_t>(bone_infos[i].id) + 1);
+    }
+    this->palette_size = std::min(this->palette_size, MAX_BONES);
+
+    vector<std::pair<const assimp_node_data*, int>> stack = {{&root, -1}};
+    while (!stack.empty()) {
+        auto [node, parent] = stack.back();
+        stack.pop_back();
+        skeleton_joint joint;
+        joint.parent = parent;
+        joint.transformation = node->transformation.mat;
+        if (auto it = channel_ids.find(node->name); it != channel_ids.end())
+            joint.channel = it->second;
+        if (auto it = bone_info_ids.find(node->name); it != bone_info_ids.end()) {
+            joint.bone = bone_infos[it->second].id;
+            joint.offset = bone_infos[it->second].offset.mat;
+        }
+        int index = static_cast<int>(this->joints.size());
+        this->joints.push_back(joint);
+        // reversed so children come out in their original order.
+        for (int c = node->children_size - 1; c >= 0; c--)
+            stack.push_back({&node->children[c], index});
+    }
+}
+
+void skeleton::evaluate(const vector<bone>& channels, vector<bone_cursor>& cursors, float time, vector<glm::mat4>& globals, glm::mat4* palette) const {
+    globals.resize(this->joints.size());
+    cursors.resize(channels.size());
+    for (size_t j = 0; j < this->joints.size(); j++) {
+        const skeleton_joint& joint = this->joints[j];
+        glm::mat4 local = joint.channel >= 0 ? channels[joint.channel].sample(time, cursors[joint.channel]) : joint.transformation;
+        globals[j] = joint.parent >= 0 ? globals[joint.parent] * local : local;
+        if (joint.bone >= 0 && static_cast<size_t>(joint.bone) < this->palette_size)
+            palette[joint.bone] = globals[j] * joint.offset;
+    }
+}
+
+void skeleton::synthetic_chain(size_t joint_count, size_t key_count, assimp_node_data& root, vector<bone>& channels, vector<bone_info>& bone_infos) {
+    assimp_node_data* node = &root;
+    for (size_t j = 0; j < joint_count; j++) {
+        string name = "joint" + std::to_string(j);
+        vector<key_position> positions;
+        vector<key_rotation> rotations;
+        vector<key_scale> scales;
+        for (size_t k = 0; k < key_count; k++) {
+            float t = static_cast<float>(k);
+            positions.push_back({vec3(0.0f, 1.0f, 0.01f * t), t});
+            rotations.push_back({quaternion(glm::angleAxis(0.02f * t, glm::vec3(0.0f, 0.0f, 1.0f))), t});
+            scales.push_back({vec3(1.0f), t});
+        }
+        channels.push_back(bone(name, static_cast<int>(j), std::move(positions), std::move(rotations), std::move(scales)));
+        bone_infos.push_back({name, static_cast<int>(j), matrix4x4(1.0f)});
+        node->name = name;
+        if (j + 1 < joint_count) {
+            node->children.emplace_back();
+            node->children_size = 1;
+            node = &node->children.back();
+        }
+    }
+}
+
+double skeleton::benchmark(size_t joint_count, size_t iterations) {
+    // a chain of joints, each with a second of keys at 30 per second on every channel, played forward
+    // and looping like a clip would.
+    const size_t key_count = 30;
+    vector<bone> channels;
+    vector<bone_info> bone_infos;
+    assimp_node_data root;
+    synthetic_chain(joint_count, key_count, root, channels, bone_infos);
+
+    skeleton flat(root, channels, bone_infos);
+    vector<glm::mat4> globals;
+    vector<bone_cursor> cursors;
+    vector<glm::mat4> palette(flat.palette_size, glm::mat4(1.0f));
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++)
+        flat.evaluate(channels, cursors, std::fmod(i * 0.37f, static_cast<float>(key_count - 1)), globals, palette.data());
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return iterations ? static_cast<double>(elapsed) / iterations : 0.0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+#include <string>
+#include "Matrix.h"
+#include "Bone.h"
+#include "Model.h"
+
+using std::vector;
+using std::string;
+
+// Tree of assimp data to help decouple our animations from assimp
+struct assimp_node_data {
+    matrix4x4 transformation = matrix4x4(1.0f);
+    string name = "";
+    int children_size = 0;
+    vector<assimp_node_data> children;
+};
+
+// A node of the animation tree with its names already resolved.
+struct skeleton_joint {
+    // index into skeleton::joints, -1 for the root.  Parents always come before their children.
+    int parent = -1;
+    // index into the animation's bones, -1 when no channel animates this node.
+    int channel = -1;
+    // slot in the bone palette, -1 when no mesh is skinned to this node.
+    int bone = -1;
+    // the node's own transform, used when there is no channel.
+    glm::mat4 transformation = glm::mat4(1.0f);
+    glm::mat4 offset = glm::mat4(1.0f);
+};
+
+// The animation tree flattened depth first, so a pose is one pass over an array with no name
+// lookups, recursion or allocations.
+class skeleton {
+public:
+    // length of final_bones_matrices in the default animated vertex shader.
+    static constexpr size_t MAX_BONES = 100;
+
+    skeleton() = default;
+    // matches channels and bone infos to nodes by name, once.
+    skeleton(const assimp_node_data& root, const vector<bone>& channels, const vector<bone_info>& bone_infos);
+
+    // samples channels at time and writes global transform * offset of every skinned joint into
+    // palette[bone], which holds palette_size matrices.  cursors holds one per channel and belongs
+    // to the caller like globals, which is scratch resized to the joint count.
+    void evaluate(const vector<bone>& channels, vector<bone_cursor>& cursors, float time, vector<glm::mat4>& globals, glm::mat4* palette) const;
+
+    // average nanoseconds of evaluate on a synthetic chain of joint_count animated joints.
+    static double benchmark(size_t joint_count, size_t iterations);
+    // the chain benchmarks pose, every joint animated by key_count keys one tick apart.
+    static void synthetic_chain(size_t joint_count, size_t key_count, assimp_node_data& root, vector<bone>& channels, vector<bone_info>& bone_infos);
+
+    vector<skeleton_joint> joints;
+    // bone ids the meshes can reference, the highest plus one capped at MAX_BONES.  Only this many
+    // palette matrices are posed and uploaded.
+    size_t palette_size = 0;
+};
@@ -1,10 +1,34 @@
 #include "SpotLight.h"
 #include <sstream>
 
-void spot_light::set_uniforms(GLuint shader_prog, size_t index) {
-    std::stringstream ss;
-    ss << "spot_lights[" << index << "].";
-    auto prefix = ss.str();
+struct spot_light_uniform_ids {
+    uniform_id position, rotation, color, cutOff, outerCutOff, constant, linear, quadratic, intensity;
+};
+
+// names for spot_lights[index] are built once and reused every frame.
+static const spot_light_uniform_ids& get_uniform_ids(size_t index) {
+    static vector<spot_light_uniform_ids> ids;
+    while (ids.size() <= index) {
+        std::stringstream ss;
+        ss << "spot_lights[" << ids.size() << "].";
+        auto prefix = ss.str();
+        ids.push_back({
+            intern_uniform(prefix + "position"),
+            intern_uniform(prefix + "rotation"),
+            intern_uniform(prefix + "color"),
+            intern_uniform(prefix + "cutOff"),
+            intern_uniform(prefix + "outerCutOff"),
+            intern_uniform(prefix + "constant"),
+            intern_uniform(prefix + "linear"),
+            intern_uniform(prefix + "quadratic"),
+            intern_uniform(prefix + "intensity")
+        });
+    }
+    return ids[index];
+}
+
+void spot_light::set_uniforms(material* mat, size_t index) {
+    const auto& ids = get_uniform_ids(index);
     // set struct parameters
 
     // if (this->use_cookie) {
@@ -12,33 +36,34 @@ void spot_light::set_uniforms(GLuint shader_prog, size_t index) {
     //     this->cookie->data->bind();
     // }
 
-    GLuint position_loc = glGetUniformLocation(shader_prog, (prefix + "position").c_str());
-    glUniform3fv(position_loc, 1, glm::value_ptr(this->position->axis));
+    glUniform3fv(mat->get_uniform_location(ids.position), 1, glm::value_ptr(this->position->axis));
+
+    glUniformMatrix4fv(mat->get_uniform_location(ids.rotation), 1, GL_FALSE, glm::value_ptr(glm::toMat4(this->rotation->quat)));
 
-    GLuint rotation_loc = glGetUniformLocation(shader_prog, (prefix + "rotation").c_str());
-    glUniformMatrix4fv(rotation_loc, 1, GL_FALSE, glm::value_ptr(glm::toMat4(this->rotation->quat)));
+    glUniform3fv(mat->get_uniform_location(ids.color), 1, glm::value_ptr(this->color->axis));
 
-    GLuint color_loc = glGetUniformLocation(shader_prog, (prefix + "color").c_str());
-    glUniform3fv(color_loc, 1, glm::value_ptr(this->color->axis));
+    glUniform1f(mat->get_uniform_location(ids.cutOff), glm::cos(this->cutOff));
 
-    GLuint cutOff_loc = glGetUniformLocation(shader_prog, (prefix + "cutOff").c_str());
-    glUniform1f(cutOff_loc, glm::cos(this->cutOff));
+    glUniform1f(mat->get_uniform_location(ids.outerCutOff), glm::cos(this->outerCutOff));
 
-    GLuint outerCutOff_loc = glGetUniformLocation(shader_prog, (prefix + "outerCutOff").c_str());
-    glUniform1f(outerCutOff_loc, glm::cos(this->outerCutOff));
+    glUniform1f(mat->get_uniform_location(ids.constant), this->constant);
 
-    // GLuint use_cookie_loc = glGetUniformLocation(shader_prog, (prefix + "use_cookie").c_str());
-    // glUniform1i(use_cookie_loc, this->use_cookie);
+    glUniform1f(mat->get_uniform_location(ids.linear), this->linear);
 
-    GLuint constant_loc = glGetUniformLocation(shader_prog, (prefix + "constant").c_str());
-    glUniform1f(constant_loc, this->constant);
+    glUniform1f(mat->get_uniform_location(ids.quadratic), 1/(this->reach*this->reach));
 
-    GLuint linear_loc = glGetUniformLocation(shader_prog, (prefix + "linear").c_str());
-    glUniform1f(linear_loc, this->linear);
+    glUniform1f(mat->get_uniform_location(ids.intensity), this->intensity);
+}
 
-    GLuint quadratic_loc = glGetUniformLocation(shader_prog, (prefix + "quadratic").c_str());
-    glUniform1f(quadratic_loc, 1/(this->reach*this->reach));
+void spot_light::pack(std140_spot_light& out) const {
+    out.position = glm::vec4(this->position->axis, 0.0f);
+    // same axis the default fragment shader used to extract from the rotation matrix.
+    out.direction = glm::vec4(glm::normalize(glm::vec3(glm::toMat4(this->rotation->quat)[2])), 0.0f);
+    out.color = glm::vec4(this->color->axis, this->intensity);
+    out.cone = glm::vec4(glm::cos(this->cutOff), glm::cos(this->outerCutOff), 0.0f, 0.0f);
+    out.attenuation = glm::vec4(this->constant, this->linear, 1/(this->reach*this->reach), 0.0f);
+}
 
-    GLuint intensity_loc = glGetUniformLocation(shader_prog, (prefix + "intensity").c_str());
-    glUniform1f(intensity_loc, this->intensity);
-} 
\ No newline at end of file
+float spot_light::influence_radius() const {
+    return light_clusters::attenuation_range(this->constant, this->linear, 1/(this->reach*this->reach));
+}
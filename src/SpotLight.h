@@ -1,6 +1,8 @@
 #pragma once
 #include "glad/gl.h"
 #include "Object3d.h"
+#include "UniformBuffer.h"
+#include "LightClusters.h"
 #include "Vec3.h"
 #include "Quaternion.h"
 #include "Texture.h"
@@ -30,7 +32,11 @@ public:
     float quadratic = 0.032f;
     bool use_cookie;
     rc_texture cookie = nullptr;
-    void set_uniforms(GLuint shader_prog, size_t index);
+    void set_uniforms(material* mat, size_t index);
+    // writes the light into its slot of the per-frame light uniform buffer.
+    void pack(std140_spot_light& out) const;
+    // distance past which the light is culled.
+    float influence_radius() const;
     friend inline std::ostream& operator<<(std::ostream& os, const spot_light& self){
         os << "spot_light{ position: " << *self.position << ", direction: " << *self.rotation << ", color: " << *self.color << " }";
         return os;
@@ -1,5 +1,8 @@
 #include "Text.h"
 
+static const uniform_id UNIFORM_TEXT_COLOR = intern_uniform("text_color");
+static const uniform_id UNIFORM_PROJECTION = intern_uniform("projection");
+
 // FONT
 
 
@@ -87,8 +90,8 @@ void text::render(camera& camera) {
     mat->data->use_material(); // Use your shader program
 
     // Set uniforms like text color
-    mat->data->set_uniform("text_color", *color);
-    mat->data->set_uniform("projection", matrix4x4(glm::ortho(0.0f, (float)camera.view_width, 0.0f, (float)camera.view_height)));
+    mat->data->set_uniform(UNIFORM_TEXT_COLOR, *color);
+    mat->data->set_uniform(UNIFORM_PROJECTION, matrix4x4(glm::ortho(0.0f, (float)camera.view_width, 0.0f, (float)camera.view_height)));
     mat->data->register_uniforms();
     glActiveTexture(GL_TEXTURE0);
     glBindVertexArray(font_data->vao);
@@ -3,34 +3,150 @@
 #include <stb_image.h>
 #include <sstream>
 #include <iostream>
+#include <filesystem>
+#include <algorithm>
 
-texture::texture(string file_path, TextureWraping wrap, TextureFiltering filtering){
-    this->file_path = file_path;
-    unsigned char * tex = stbi_load(file_path.c_str(), &width, &height, &number_of_channels, 0);
-    if (tex) {
-        glGenTextures(1, &gl_texture);
-        glBindTexture(GL_TEXTURE_2D, gl_texture);
-        
-        // texture settings:
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, static_cast<GLint>(wrap));
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, static_cast<GLint>(wrap));
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, static_cast<GLint>(filtering));
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, static_cast<GLint>(filtering));
-
-        int col_format = number_of_channels > 3 ? GL_RGBA : GL_RGB;
-
-        // texture data:
-        glTexImage2D(GL_TEXTURE_2D, 0, col_format, width, height, 0, col_format,
-            GL_UNSIGNED_BYTE, tex);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        stbi_image_free(tex);
-    } else {
+decoded_image::~decoded_image() {
+    if (pixels)
+        stbi_image_free(pixels);
+}
+
+std::shared_ptr<decoded_image> decoded_image::from_file(const string& file_path) {
+    auto image = std::make_shared<decoded_image>();
+    image->pixels = stbi_load(file_path.c_str(), &image->width, &image->height, &image->number_of_channels, 0);
+    if (!image->pixels) {
         std::stringstream ss;
         ss << "Failed to load texture at \"" << file_path << "\"\nSTBI log: " << stbi_failure_reason() << "\n\n  HINT: Could be missing \"textures\" folder?";
         throw std::runtime_error(ss.str());
     }
+    return image;
+}
+
+texture::texture(string file_path, TextureWraping wrap, TextureFiltering filtering)
+    : texture(file_path, *decoded_image::from_file(file_path), wrap, filtering) {}
+
+texture::texture(string file_path, const decoded_image& image, TextureWraping wrap, TextureFiltering filtering){
+    this->file_path = file_path;
+    this->width = image.width;
+    this->height = image.height;
+    this->number_of_channels = image.number_of_channels;
+
+    glGenTextures(1, &gl_texture);
+    glBindTexture(GL_TEXTURE_2D, gl_texture);
+    
+    // texture settings:
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, static_cast<GLint>(wrap));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, static_cast<GLint>(wrap));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, static_cast<GLint>(filtering));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, static_cast<GLint>(filtering));
+
+    int col_format = number_of_channels > 3 ? GL_RGBA : GL_RGB;
+
+    // texture data:
+    glTexImage2D(GL_TEXTURE_2D, 0, col_format, width, height, 0, col_format,
+        GL_UNSIGNED_BYTE, image.pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    // 3 channel images are usually padded to 4 by the driver, mipmaps add a third.
+    this->memory_bytes = static_cast<size_t>(width) * height * (number_of_channels > 3 ? 4 : 3) * 4 / 3;
+}
+
+texture::~texture() {
+    if (gl_texture)
+        glDeleteTextures(1, &gl_texture);
 }
 
 void texture::bind() {
     glBindTexture(GL_TEXTURE_2D, gl_texture);
+}
+
+texture_cache::key texture_cache::make_key(const string& file_path, TextureWraping wrap, TextureFiltering filtering) {
+    std::error_code err;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(file_path, err);
+    return {err ? file_path : canonical.string(), wrap, filtering};
+}
+
+std::shared_ptr<decoded_image> texture_cache::prefetch(const string& file_path, TextureWraping wrap, TextureFiltering filtering) {
+    key k = make_key(file_path, wrap, filtering);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (textures.contains(k))
+            return nullptr;
+    }
+    return decoded_image::from_file(file_path);
+}
+
+rc_texture texture_cache::get(const string& file_path, TextureWraping wrap, TextureFiltering filtering, std::shared_ptr<decoded_image> decoded) {
+    key k = make_key(file_path, wrap, filtering);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = textures.find(k);
+    if (it != textures.end()) {
+        stats.hits++;
+        it->second.last_used = ++clock;
+        it->second.tex->inc();
+        return it->second.tex;
+    }
+    stats.misses++;
+    // the cache keeps the first reference.
+    rc_texture tex = new RC(decoded ? new texture(file_path, *decoded, wrap, filtering) : new texture(file_path, wrap, filtering));
+    tex->inc();
+    textures.emplace(k, cached{tex, ++clock});
+    stats.textures++;
+    stats.memory_bytes += tex->data->memory_bytes;
+    evict(budget);
+    return tex;
+}
+
+void texture_cache::evict(size_t target_bytes) {
+    if (stats.memory_bytes <= target_bytes)
+        return;
+    std::vector<std::map<key, cached>::iterator> idle;
+    for (auto it = textures.begin(); it != textures.end(); ++it)
+        if (it->second.tex->refcount == 1)
+            idle.push_back(it);
+    std::sort(idle.begin(), idle.end(), [](const auto& a, const auto& b) {
+        return a->second.last_used < b->second.last_used;
+    });
+    for (auto it : idle) {
+        if (stats.memory_bytes <= target_bytes)
+            break;
+        stats.memory_bytes -= it->second.tex->data->memory_bytes;
+        stats.textures--;
+        stats.evictions++;
+        RC_collect(it->second.tex);
+        textures.erase(it);
+    }
+}
+
+void texture_cache::set_budget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = bytes;
+    evict(budget);
+}
+
+size_t texture_cache::get_budget() {
+    return budget;
+}
+
+size_t texture_cache::collect_unused() {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t before = stats.evictions;
+    evict(0);
+    return stats.evictions - before;
+}
+
+texture_cache_stats texture_cache::get_stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+std::vector<texture_cache_entry> texture_cache::get_entries() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<texture_cache_entry> entries;
+    entries.reserve(textures.size());
+    for (const auto& [k, entry] : textures) {
+        texture* tex = entry.tex->data;
+        entries.push_back({tex->file_path, tex->width, tex->height, tex->number_of_channels, tex->memory_bytes, entry.tex->refcount - 1});
+    }
+    return entries;
 }
\ No newline at end of file
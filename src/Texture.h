@@ -2,7 +2,13 @@
 #include <string>
 #include "glad/gl.h"
 #include <stdexcept>
-
+#include <vector>
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <cstdint>
+#include <memory>
+#include "RC.h"
 
 using std::string;
 
@@ -18,16 +24,84 @@ enum class TextureWraping {
     CLAMP_TO_BORDER = GL_CLAMP_TO_BORDER
 };
 
+// Pixels of an image file, decoded away from the GL thread so only the upload is left.
+struct decoded_image {
+    decoded_image() {}
+    decoded_image(const decoded_image&) = delete;
+    decoded_image& operator=(const decoded_image&) = delete;
+    ~decoded_image();
+    // throws when the file can not be decoded.
+    static std::shared_ptr<decoded_image> from_file(const string& file_path);
+
+    int width = 0, height = 0, number_of_channels = 0;
+    unsigned char* pixels = nullptr;
+};
+
 class texture {
 public:
     texture(){}
     texture(string file_path, TextureWraping wrap, TextureFiltering filtering);
+    texture(string file_path, const decoded_image& image, TextureWraping wrap, TextureFiltering filtering);
+    ~texture();
 
     void bind();
 
     int width = 0, height = 0, number_of_channels = 0;
-    GLuint gl_texture;
+    GLuint gl_texture = 0;
+    string file_path;
+    // estimated VRAM use, the base level plus its mipmap chain.
+    size_t memory_bytes = 0;
+};
+
+typedef RC<texture*>* rc_texture;
+
+struct texture_cache_stats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t textures = 0;
+    size_t memory_bytes = 0;
+};
+
+struct texture_cache_entry {
     string file_path;
+    int width = 0, height = 0, number_of_channels = 0;
+    size_t memory_bytes = 0;
+    // references held outside the cache.
+    int users = 0;
+};
+
+// Shares loaded textures by canonical path, wrapping and filtering, so an image is decoded and
+// uploaded once however many materials use it.  Once the cached textures take more memory than
+// the budget, the least recently requested ones nothing else references are released.
+class texture_cache {
+public:
+    // The returned reference belongs to the caller.  decoded is used instead of reading the file
+    // again when the texture is not cached yet, see prefetch.
+    static rc_texture get(const string& file_path, TextureWraping wrap, TextureFiltering filtering, std::shared_ptr<decoded_image> decoded = nullptr);
+    // decodes the file unless it is cached already, in which case it returns nullptr.
+    // Does not touch GL, so loaders call it on their own thread and pass the result to get().
+    static std::shared_ptr<decoded_image> prefetch(const string& file_path, TextureWraping wrap, TextureFiltering filtering);
+    static void set_budget(size_t bytes);
+    static size_t get_budget();
+    // releases every cached texture nothing else references, returns how many went.
+    static size_t collect_unused();
+    static texture_cache_stats get_stats();
+    static std::vector<texture_cache_entry> get_entries();
+private:
+    typedef std::tuple<string, TextureWraping, TextureFiltering> key;
+    struct cached {
+        rc_texture tex;
+        uint64_t last_used;
+    };
+    static key make_key(const string& file_path, TextureWraping wrap, TextureFiltering filtering);
+    static void evict(size_t target_bytes);
+
+    static inline std::map<key, cached> textures;
+    static inline std::mutex mutex;
+    static inline texture_cache_stats stats;
+    static inline uint64_t clock = 0;
+    static inline size_t budget = size_t(512) << 20;
 };
 
 const int GL_TEX_N_ITTER[] = {
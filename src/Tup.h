@@ -7,7 +7,7 @@
 template<typename T, size_t N>
 class tup {
 public:
-    tup() : data{}, size(N) {}
+    tup() : data{} {}
     tup(T values[N]) {
         memcpy(data, values, sizeof(T)*N);
     }
@@ -21,7 +21,8 @@ public:
     }
 
     T data[N];
-    size_t size = N;
+    // not a member, so a vector of tups is one flat array of T.
+    static constexpr size_t size = N;
     friend inline std::ostream& operator<<(std::ostream& os, const tup<T, N>& self){
         os << '(';
         for (int i = 0; i < N; i++)
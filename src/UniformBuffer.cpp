@@ -0,0 +1,25 @@
+#include "UniformBuffer.h"
+#include <stdexcept>
+
+uniform_buffer::uniform_buffer(UniformBlockBinding binding, size_t size) : binding(binding), size(size) {
+    glGenBuffers(1, &this->gl_UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, this->gl_UBO);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, static_cast<GLuint>(binding), this->gl_UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+uniform_buffer::~uniform_buffer() {
+    if (this->gl_UBO)
+        glDeleteBuffers(1, &this->gl_UBO);
+}
+
+void uniform_buffer::update(const void* data, size_t size) {
+    if (size > this->size)
+        throw std::runtime_error("Uniform buffer update is larger than the buffer.");
+    glBindBuffer(GL_UNIFORM_BUFFER, this->gl_UBO);
+    // orphan the old storage so the driver does not stall on the previous frame.
+    glBufferData(GL_UNIFORM_BUFFER, this->size, nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
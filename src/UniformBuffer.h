@@ -0,0 +1,84 @@
+#pragma once
+#include "glad/gl.h"
+#include <glm/glm.hpp>
+#include <cstddef>
+
+// Must match MAX_LIGHTS in default_fragment.glsl, only directional lights are capped by it.
+#define MAX_LIGHTS 15
+
+// Binding points of the engine uniform blocks.  Programs that declare a block
+// with one of these names get it bound after linking (see material::link_shaders).
+enum class UniformBlockBinding : GLuint {
+    FRAME = 0,
+    LIGHTS = 1
+};
+
+#define FRAME_BLOCK_NAME "FrameData"
+#define LIGHT_BLOCK_NAME "LightData"
+
+// Texture units of the clustered light buffers, materials use the low units.
+enum class LightBufferUnit : GLuint {
+    POINT_LIGHTS = 12,
+    SPOT_LIGHTS = 13,
+    CLUSTER_GRID = 14,
+    CLUSTER_INDICES = 15
+};
+
+#define POINT_LIGHT_SAMPLER_NAME "point_light_data"
+#define SPOT_LIGHT_SAMPLER_NAME "spot_light_data"
+#define CLUSTER_GRID_SAMPLER_NAME "light_grid"
+#define CLUSTER_INDICES_SAMPLER_NAME "light_index_list"
+
+// std140 mirrors of the blocks declared in the default shaders.
+// Point and spot lights use the same layout as texels of their buffer textures.
+// Every member is a vec4/mat4 so the C++ layout matches std140 without padding rules.
+
+struct std140_frame_data {
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec4 view_position = glm::vec4(0.0f); // xyz
+    glm::vec4 ambient_light = glm::vec4(0.0f); // rgb
+};
+
+struct std140_point_light {
+    glm::vec4 position = glm::vec4(0.0f); // xyz position, w radius
+    glm::vec4 color = glm::vec4(0.0f); // rgb color, a intensity
+    glm::vec4 attenuation = glm::vec4(0.0f); // constant, linear, quadratic
+};
+
+struct std140_directional_light {
+    glm::vec4 direction = glm::vec4(0.0f); // xyz
+    glm::vec4 color = glm::vec4(0.0f); // rgb color, a intensity
+};
+
+struct std140_spot_light {
+    glm::vec4 position = glm::vec4(0.0f); // xyz
+    glm::vec4 direction = glm::vec4(0.0f); // xyz
+    glm::vec4 color = glm::vec4(0.0f); // rgb color, a intensity
+    glm::vec4 cone = glm::vec4(0.0f); // cos(cutOff), cos(outerCutOff)
+    glm::vec4 attenuation = glm::vec4(0.0f); // constant, linear, quadratic
+};
+
+struct std140_light_data {
+    std140_directional_light directional_lights[MAX_LIGHTS];
+    glm::ivec4 light_counts = glm::ivec4(0); // point, directional, spot
+    glm::ivec4 cluster_dims = glm::ivec4(0); // x, y, z
+    glm::vec4 cluster_params = glm::vec4(0.0f); // slice scale, slice bias, tile width, tile height in pixels
+};
+
+static_assert(sizeof(std140_frame_data) == 160, "std140_frame_data does not match the std140 layout.");
+static_assert(sizeof(std140_light_data) == MAX_LIGHTS * 32 + 48, "std140_light_data does not match the std140 layout.");
+
+class uniform_buffer {
+public:
+    uniform_buffer(){}
+    uniform_buffer(UniformBlockBinding binding, size_t size);
+    ~uniform_buffer();
+
+    // uploads the whole block, call once per frame.
+    void update(const void* data, size_t size);
+
+    GLuint gl_UBO = 0;
+    UniformBlockBinding binding = UniformBlockBinding::FRAME;
+    size_t size = 0;
+};
@@ -0,0 +1,168 @@
+#include "VertexLayout.h"
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+
+static_assert(sizeof(vertex) == 64);
+static_assert(sizeof(static_vertex) == 32);
+static_assert(sizeof(skinned_vertex) == 52);
+static_assert(sizeof(static_packed_vertex) == 20);
+static_assert(sizeof(skinned_packed_vertex) == 32);
+
+// NaN would survive the clamps of the packing functions, meshes without bones normalize zero weights into it.
+static inline float finite_or_zero(float value) {
+    return value == value ? value : 0.0f;
+}
+
+static inline uint32_t pack_normal(const glm::vec3& normal) {
+    return glm::packSnorm3x10_1x2(glm::vec4(finite_or_zero(normal.x), finite_or_zero(normal.y), finite_or_zero(normal.z), 0.0f));
+}
+
+static inline void pack_tex_coords(const glm::vec2& tex_coords, uint16_t* out) {
+    out[0] = glm::packHalf1x16(tex_coords.x);
+    out[1] = glm::packHalf1x16(tex_coords.y);
+}
+
+static inline void pack_bones(const vertex& v, int8_t* ids) {
+    for (int i = 0; i < 4; i++)
+        ids[i] = static_cast<int8_t>(v.bone_ids[i]);
+}
+
+static inline glm::vec4 finite_weights(const glm::vec4& weights) {
+    return glm::vec4(finite_or_zero(weights.x), finite_or_zero(weights.y), finite_or_zero(weights.z), finite_or_zero(weights.w));
+}
+
+size_t vertex_layout_stride(VertexLayout layout) {
+    switch (layout) {
+        case VertexLayout::STATIC:
+            return sizeof(static_vertex);
+        case VertexLayout::SKINNED:
+            return sizeof(skinned_vertex);
+        case VertexLayout::STATIC_PACKED:
+            return sizeof(static_packed_vertex);
+        case VertexLayout::SKINNED_PACKED:
+            return sizeof(skinned_packed_vertex);
+        default:
+            return sizeof(vertex);
+    }
+}
+
+VertexLayout choose_vertex_layout(const vertex* vertices, size_t count, bool skinned, bool quantize) {
+    if (!skinned)
+        return quantize ? VertexLayout::STATIC_PACKED : VertexLayout::STATIC;
+    for (size_t v = 0; v < count; v++)
+        for (int i = 0; i < 4; i++)
+            if (vertices[v].bone_ids[i] < -1 || vertices[v].bone_ids[i] > INT8_MAX)
+                return VertexLayout::FULL;
+    return quantize ? VertexLayout::SKINNED_PACKED : VertexLayout::SKINNED;
+}
+
+template<typename T, typename F>
+static vector<unsigned char> pack_as(const vertex* vertices, size_t count, F convert) {
+    vector<unsigned char> ret(count * sizeof(T));
+    for (size_t v = 0; v < count; v++) {
+        T packed = convert(vertices[v]);
+        std::memcpy(ret.data() + v * sizeof(T), &packed, sizeof(T));
+    }
+    return ret;
+}
+
+vector<unsigned char> pack_vertices(VertexLayout layout, const vertex* vertices, size_t count) {
+    switch (layout) {
+        case VertexLayout::STATIC:
+            return pack_as<static_vertex>(vertices, count, [](const vertex& v) {
+                return static_vertex{v.position, v.normal, v.tex_coords};
+            });
+        case VertexLayout::SKINNED:
+            return pack_as<skinned_vertex>(vertices, count, [](const vertex& v) {
+                skinned_vertex ret{v.position, v.normal, v.tex_coords, {}, finite_weights(v.weights)};
+                pack_bones(v, ret.bone_ids);
+                return ret;
+            });
+        case VertexLayout::STATIC_PACKED:
+            return pack_as<static_packed_vertex>(vertices, count, [](const vertex& v) {
+                static_packed_vertex ret{v.position, pack_normal(v.normal), {}};
+                pack_tex_coords(v.tex_coords, ret.tex_coords);
+                return ret;
+            });
+        case VertexLayout::SKINNED_PACKED:
+            return pack_as<skinned_packed_vertex>(vertices, count, [](const vertex& v) {
+                skinned_packed_vertex ret{v.position, pack_normal(v.normal), {}, {}, {}};
+                pack_tex_coords(v.tex_coords, ret.tex_coords);
+                pack_bones(v, ret.bone_ids);
+                glm::vec4 weights = finite_weights(v.weights);
+                for (int i = 0; i < 4; i++)
+                    ret.weights[i] = glm::packUnorm1x16(weights[i]);
+                return ret;
+            });
+        default: {
+            vector<unsigned char> ret(count * sizeof(vertex));
+            std::memcpy(ret.data(), vertices, ret.size());
+            return ret;
+        }
+    }
+}
+
+void set_vertex_attributes(VertexLayout layout) {
+    GLsizei stride = static_cast<GLsizei>(vertex_layout_stride(layout));
+    switch (layout) {
+        case VertexLayout::STATIC:
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(static_vertex, position));
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(static_vertex, normal));
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(static_vertex, tex_coords));
+            break;
+        case VertexLayout::SKINNED:
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(skinned_vertex, position));
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(skinned_vertex, normal));
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(skinned_vertex, tex_coords));
+            glVertexAttribIPointer(3, 4, GL_BYTE, stride, (void*)offsetof(skinned_vertex, bone_ids));
+            glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(skinned_vertex, weights));
+            break;
+        case VertexLayout::STATIC_PACKED:
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(static_packed_vertex, position));
+            glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(static_packed_vertex, normal));
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(static_packed_vertex, tex_coords));
+            break;
+        case VertexLayout::SKINNED_PACKED:
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(skinned_packed_vertex, position));
+            glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(skinned_packed_vertex, normal));
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(skinned_packed_vertex, tex_coords));
+            glVertexAttribIPointer(3, 4, GL_BYTE, stride, (void*)offsetof(skinned_packed_vertex, bone_ids));
+            glVertexAttribPointer(4, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(skinned_packed_vertex, weights));
+            break;
+        default:
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(vertex, position));
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(vertex, normal));
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(vertex, tex_coords));
+            glVertexAttribIPointer(3, 4, GL_INT, stride, (void*)offsetof(vertex, bone_ids));
+            glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(vertex, weights));
+            break;
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    if (layout != VertexLayout::STATIC && layout != VertexLayout::STATIC_PACKED) {
+        glEnableVertexAttribArray(3);
+        glEnableVertexAttribArray(4);
+    }
+}
+
+GLenum index_type_for(size_t vertex_count) {
+    return vertex_count <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+size_t index_type_size(GLenum index_type) {
+    return index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+vector<unsigned char> pack_indices(GLenum index_type, const uint32_t* indices, size_t count) {
+    vector<unsigned char> ret(count * index_type_size(index_type));
+    if (index_type == GL_UNSIGNED_SHORT) {
+        for (size_t i = 0; i < count; i++) {
+            uint16_t index = static_cast<uint16_t>(indices[i]);
+            std::memcpy(ret.data() + i * sizeof(uint16_t), &index, sizeof(uint16_t));
+        }
+    } else {
+        std::memcpy(ret.data(), indices, ret.size());
+    }
+    return ret;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "glad/gl.h"
+#include <glm/glm.hpp>
+
+using std::vector;
+
+struct vertex {
+    // position
+    glm::vec3 position = glm::vec3(0.0f,0.0f,0.0f);
+    // normal
+    glm::vec3 normal = glm::vec3(0.0f,0.0f,0.0f);
+    // texCoords
+    glm::vec2 tex_coords = glm::vec2(0.0f,0.0f);
+	//bone indexes which will influence this vertex
+	glm::ivec4 bone_ids = glm::ivec4(0,0,0,0);
+	//weights from each bone
+	glm::vec4 weights = glm::vec4(0.0f,0.0f,0.0f,0.0f);
+};
+
+// How a mesh's vertices are stored in its VBO.  The CPU side always keeps full vertex structs,
+// the shaders read every layout through the same attribute locations.
+enum class VertexLayout : uint8_t {
+    // the vertex struct as is, 64 bytes.  Used for skinned meshes with bone ids past 127.
+    FULL,
+    // position, normal and uv, 32 bytes.
+    STATIC,
+    // STATIC plus signed byte bone ids and float weights, 52 bytes.
+    SKINNED,
+    // float position, 10-10-10-2 normal and half float uv, 20 bytes.
+    STATIC_PACKED,
+    // STATIC_PACKED plus signed byte bone ids and unorm16 weights, 32 bytes.
+    SKINNED_PACKED
+};
+
+struct static_vertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 tex_coords;
+};
+
+struct skinned_vertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 tex_coords;
+    int8_t bone_ids[4];
+    glm::vec4 weights;
+};
+
+struct static_packed_vertex {
+    glm::vec3 position;
+    uint32_t normal;
+    uint16_t tex_coords[2];
+};
+
+struct skinned_packed_vertex {
+    glm::vec3 position;
+    uint32_t normal;
+    uint16_t tex_coords[2];
+    int8_t bone_ids[4];
+    uint16_t weights[4];
+};
+
+size_t vertex_layout_stride(VertexLayout layout);
+// the smallest layout that holds the vertices, quantize allows the packed ones.
+VertexLayout choose_vertex_layout(const vertex* vertices, size_t count, bool skinned, bool quantize);
+// the VBO contents for vertices stored in layout.
+vector<unsigned char> pack_vertices(VertexLayout layout, const vertex* vertices, size_t count);
+// points the attributes of the bound VAO at the bound VBO.
+void set_vertex_attributes(VertexLayout layout);
+
+// GL_UNSIGNED_SHORT when every index of a mesh with vertex_count vertices fits in 16 bits.
+GLenum index_type_for(size_t vertex_count);
+size_t index_type_size(GLenum index_type);
+// the EBO contents for indices stored as index_type.
+vector<unsigned char> pack_indices(GLenum index_type, const uint32_t* indices, size_t count);
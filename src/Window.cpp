@@ -1,5 +1,10 @@
 #include "Window.h"
 #include <functional>
+#include <unordered_set>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
 #include "Camera.h"
 #include <iostream>
 #include <mutex>
@@ -10,16 +15,35 @@
 #include "Mesh.h"
 #include "Model.h"
 #include "Animation.h"
+#include "AsyncLoader.h"
+#include "GeometryArena.h"
 
 #define in_set(the_set, item) the_set.find(item) != the_set.end()
 
+// whether ob may be drawn in an instance_batch, defined next to queue_instanced_objects.
+static bool can_instance(object3d* ob);
+
 window::~window(){
-    SDL_GL_DeleteContext(this->gl_context);
-    SDL_DestroyWindow(this->app_window);
+    delete frame_ubo;
+    delete light_ubo;
+    delete point_light_buffer;
+    delete spot_light_buffer;
+    delete cluster_grid_buffer;
+    delete cluster_index_buffer;
+    delete instance_matrices;
+    // a headless window never started SDL, so it must not shut it down under a real one.
+    bool started_sdl = this->app_window != nullptr;
+    if (started_sdl) {
+        SDL_GL_DeleteContext(this->gl_context);
+        SDL_DestroyWindow(this->app_window);
+    }
     delete sound_mixer;
-    SDL_Quit();
+    if (started_sdl)
+        SDL_Quit();
 }
 
+window::window(headless) {}
+
 window::window() {
     this->title = "Default Window Title";
     this->create_window();
@@ -105,11 +129,72 @@ void window::create_window() {
 
     sound_mixer = new audio_mixer();
 
+    frame_ubo = new uniform_buffer(UniformBlockBinding::FRAME, sizeof(std140_frame_data));
+    light_ubo = new uniform_buffer(UniformBlockBinding::LIGHTS, sizeof(std140_light_data));
+    point_light_buffer = new buffer_texture(GL_RGBA32F);
+    spot_light_buffer = new buffer_texture(GL_RGBA32F);
+    cluster_grid_buffer = new buffer_texture(GL_RG32UI);
+    cluster_index_buffer = new buffer_texture(GL_R16UI);
+    instance_matrices = new instance_buffer();
+
+    GLint max_texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    clusters.max_light_indices = max_texels;
+
     return;
 } 
 
 
 
+void window::simulate(double dt) {
+    this->deltatime = dt;
+    job_system& jobs = job_system::get();
+    this->emitter_list.assign(render_list_emitter.begin(), render_list_emitter.end());
+    this->emitter_job = std::make_unique<job>([this, &jobs]() {
+        jobs.parallel_for(this->emitter_list.size(), 1, [this](size_t begin, size_t end) {
+            // culled emitters keep simulating so they are in the right state when they come back into view.
+            for (size_t i = begin; i < end; i++)
+                this->emitter_list[i]->update(*this->cam);
+        });
+    });
+    jobs.submit(*this->emitter_job);
+
+    this->animated_objects.clear();
+    this->animators.clear();
+    for (auto& [ob, proxy] : this->object_proxies) {
+        // draw lists only change here, before anything of the frame is queued.
+        ob->model_data->data->refresh_draw_list();
+        if (ob->model_data->data->animated) {
+            this->animated_objects.push_back(ob);
+            this->animators.push_back(ob->get_animator());
+        }
+    }
+    // objects that did not play their own animation share their model's animator, advanced once per frame.
+    std::sort(this->animators.begin(), this->animators.end());
+    this->animators.erase(std::unique(this->animators.begin(), this->animators.end()), this->animators.end());
+    this->animation_job = std::make_unique<job>([this, &jobs]() {
+        this->animation.run(this->animators, this->deltatime, jobs);
+    });
+    jobs.submit(*this->animation_job);
+
+    // parents first, so a moved parent's children see its new world matrix in the same pass.
+    // Every root's subtree is independent and updated as one piece of work.
+    if (this->transform_order_generation != object3d::hierarchy_generation)
+        this->build_transform_order();
+    this->transform_moved.assign(this->transform_order.size(), 0);
+    jobs.parallel_for(this->transform_roots.size(), 16, [&](size_t begin, size_t end) {
+        size_t first = this->transform_roots[begin];
+        size_t last = end < this->transform_roots.size() ? this->transform_roots[end] : this->transform_order.size();
+        for (size_t i = first; i < last; i++)
+            this->transform_moved[i] = this->transform_order[i].object->update_world_matrix();
+    });
+    for (size_t i = 0; i < this->transform_order.size(); i++) {
+        const transform_entry& entry = this->transform_order[i];
+        if (this->transform_moved[i] && entry.proxy != aabb_tree<object3d*>::NULL_NODE)
+            this->scene_tree.move(entry.proxy, entry.object->get_world_aabb());
+    }
+}
+
 void window::update() {
     this->new_time = std::chrono::steady_clock::now();
     this->time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(this->starttime - this->old_time).count();
@@ -118,16 +203,49 @@ void window::update() {
     this->old_time = this->new_time;
     this->current_event.handle_events(this);
 
+    // GL work left by background model loads, bounded so streaming never causes a hitch.
+    async_loader::get().pump();
+    // compacts geometry arenas that freed meshes left mostly empty.
+    geometry_arena::maintain();
+
     this->cam->recalculate_pv();
-    
-    for (object3d* ob : render_list) {
-        // update animations
-        if (ob->model_data->data->animated) {
-            ob->model_data->data->animation_player->update(deltatime);
-        }
 
+    // simulation runs on the job_system while this thread culls and submits, GL calls stay here.
+    job_system& jobs = job_system::get();
+    this->simulate(this->deltatime);
+
+    this->update_frame_uniforms();
+
+    this->gl_state.stats = render_stats();
+    this->instance_candidates.clear();
+
+    // skinned vertices can leave the bind pose bounds, so animated models are never culled.
+    for (object3d* ob : this->animated_objects) {
+        ob->lod_level = ob->model_data->data->select_lod(ob, *this->cam);
         ob->render(*this->cam, this);
-        
+    }
+
+    size_t visible = this->animated_objects.size();
+    this->scene_tree.query_frustum(this->cam->view_frustum, [&](object3d* ob, FrustumTest visibility) {
+        if (ob->model_data->data->animated)
+            return;
+        visible++;
+        ob->lod_level = ob->model_data->data->select_lod(ob, *this->cam);
+        if (can_instance(ob))
+            this->instance_candidates.push_back(ob);
+        else
+            ob->render(*this->cam, this, visibility == FrustumTest::INTERSECTS);
+    });
+    this->gl_state.stats.objects_culled = this->object_proxies.size() - visible;
+    this->queue_instanced_objects();
+
+    // bone matrices are read while the queue draws.
+    jobs.wait(*this->animation_job);
+    this->gl_state.stats.poses = this->animation.poses;
+    this->gl_state.stats.poses_shared = this->animation.poses_shared;
+    this->queue.submit(*this->cam, this, this->gl_state);
+
+    for (auto& [ob, proxy] : this->object_proxies) {
         for (auto col : ob->colliders) {
             if (auto convex = dynamic_cast<collider_convex*>(col->data)) {
                 convex->dbg_render(*this->cam);
@@ -137,12 +255,19 @@ void window::update() {
         }
 
         if (ob->model_data->data->animated)
-            ob->model_data->data->animation_player->render_debug(this->cam, ob->model_matrix);
+            ob->get_animator()->render_debug(this->cam, ob->model_matrix);
     }
     
     glDepthMask(GL_FALSE);// TODO Make this per sprite based on wether the sprite is marked as translucent
-    for (emitter* ob : render_list_emitter) {
-        ob->render(*this->cam);
+    jobs.wait(*this->emitter_job);
+    for (emitter* ob : this->emitter_list) {
+        if (!ob->emitting)
+            continue;
+        if (this->cam->view_frustum.test_aabb((ob->bounds_min.axis + ob->bounds_max.axis) * 0.5f, (ob->bounds_max.axis - ob->bounds_min.axis) * 0.5f) == FrustumTest::OUTSIDE) {
+            this->gl_state.stats.emitters_culled++;
+            continue;
+        }
+        ob->draw(*this->cam);
     }
 
     vector<object2d*> sorted_sprites(render_list2d.begin(), render_list2d.end());
@@ -169,28 +294,374 @@ void window::update() {
     glDepthMask(GL_TRUE);
 } 
 
+namespace {
+    // what the simulated frames of self_test_frame leave behind, compared byte for byte between runs.
+    struct frame_result {
+        vector<float> particles;
+        vector<float> animator_times;
+        vector<glm::mat4> palettes;
+        vector<glm::mat4> world_matrices;
+    };
+
+    template<typename T>
+    bool same_bytes(const vector<T>& a, const vector<T>& b) {
+        return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+    }
+
+    void expect_same_frame(const frame_result& a, const frame_result& b, const string& runs) {
+        const char* differs = nullptr;
+        if (!same_bytes(a.particles, b.particles))
+            differs = "particles";
+        else if (!same_bytes(a.animator_times, b.animator_times))
+            differs = "animator times";
+        else if (!same_bytes(a.palettes, b.palettes))
+            differs = "bone palettes";
+        else if (!same_bytes(a.world_matrices, b.world_matrices))
+            differs = "world matrices";
+        if (differs)
+            throw std::runtime_error(string("frame self test failed: ") + differs + " differ between " + runs);
+    }
+}
+
+void window::self_test_frame() {
+    job_system& jobs = job_system::get();
+    size_t workers = jobs.get_worker_count();
+    // long enough for particles to die and respawn from their emitter's generator.
+    const size_t frames = 90;
+    // steps a fresh headless window holding emitters, animated objects and a hierarchy through simulate().
+    auto run = [&]() {
+        window scene{headless{}};
+        camera cam;
+        cam.deltatime = &scene.deltatime;
+        scene.cam = &cam;
+
+        // emitters made without the GL buffers of the full constructor, seeded so every run draws the same particles.
+        vec3 emitter_position(0.0f, 1.0f, 0.0f);
+        quaternion emitter_direction = quaternion::from_euler(vec3(0.3f, 0.0f, 0.1f));
+        vec2 scale_min(0.1f, 0.1f), scale_max(0.4f, 0.3f);
+        vec4 color_min(0.2f, 0.2f, 0.2f, 0.5f), color_max(1.0f, 0.8f, 0.6f, 1.0f);
+        vector<std::unique_ptr<emitter>> emitters;
+        for (size_t i = 0; i < 12; i++) {
+            emitters.emplace_back(new emitter());
+            emitter* em = emitters.back().get();
+            em->position = &emitter_position;
+            em->direction = &emitter_direction;
+            em->scale_min = &scale_min;
+            em->scale_max = &scale_max;
+            em->color_min = &color_min;
+            em->color_max = &color_max;
+            em->rate = 20 + static_cast<int>(i);
+            em->decay_rate = 0.5f;
+            em->spread = 0.4f;
+            em->velocity_decay = 0.05f;
+            em->start_velocity_min = 1.0f;
+            em->start_velocity_max = 3.0f;
+            em->start_lifetime_min = 0.2f;
+            em->start_lifetime_max = 1.0f;
+            em->rng.seed(static_cast<unsigned int>(i + 1));
+            em->start();
+            scene.add_emitter(em);
+        }
+
+        // a skinned and a rigid model without meshes, the skinned one on a synthetic clip.
+        mesh_dict no_meshes;
+        RC<mesh_dict*> no_meshes_rc(&no_meshes);
+        model skinned(&no_meshes_rc, true), rigid(&no_meshes_rc, false);
+        RC<model*> skinned_rc(&skinned), rigid_rc(&rigid);
+        assimp_node_data root;
+        vector<bone> channels;
+        vector<bone_info> bone_infos;
+        skeleton::synthetic_chain(24, 30, root, channels, bone_infos);
+        skinned.animations["clip"] = new animation(29.0f, 30.0f, std::move(root), std::move(channels), std::move(bone_infos));
+        skinned.play_animation("clip");
+
+        // chains of depth objects alternating between the models.  Every fourth chain's root plays its own
+        // animator, in pairs at the same time so the stage shares poses, the rest share the model's.
+        const size_t roots = 40, depth = 4, count = roots * depth;
+        vector<vec3> positions, scales(count, vec3(1.0f));
+        vector<quaternion> rotations;
+        vector<std::unique_ptr<object3d>> objects;
+        for (size_t i = 0; i < count; i++) {
+            positions.emplace_back(static_cast<float>(i % depth), 0.5f * i, 0.0f);
+            rotations.push_back(quaternion::from_euler(vec3(0.01f * i, 0.0f, 0.0f)));
+        }
+        for (size_t i = 0; i < count; i++) {
+            size_t chain = i / depth;
+            objects.emplace_back(new object3d(chain % 2 ? &rigid_rc : &skinned_rc, &positions[i], &rotations[i], &scales[i]));
+            if (i % depth)
+                objects[i]->set_parent(objects[i - 1].get());
+            else if (chain % 4 == 0)
+                objects[i]->play_animation("clip", 1.0f, (chain / 8) * 0.37f);
+            scene.add_object(objects[i].get());
+        }
+
+        for (size_t f = 0; f < frames; f++) {
+            for (size_t i = 0; i < count; i++) {
+                positions[i].axis.x += 0.01f * std::sin(0.1f * f + i);
+                rotations[i].rotate(vec3(0.0f, 1.0f, 0.0f), 0.02f);
+            }
+            scene.simulate(1.0 / 60.0);
+            jobs.wait(*scene.animation_job);
+            jobs.wait(*scene.emitter_job);
+        }
+
+        frame_result ret;
+        for (auto& em : emitters) {
+            for (const particle& p : em->particles) {
+                const float values[] = {
+                    p.position.axis.x, p.position.axis.y, p.position.axis.z,
+                    p.velocity.axis.x, p.velocity.axis.y, p.velocity.axis.z,
+                    p.color.axis.x, p.color.axis.y, p.color.axis.z, p.color.axis.w,
+                    p.scale.axis.x, p.scale.axis.y, p.life, p.starting_life
+                };
+                ret.particles.insert(ret.particles.end(), std::begin(values), std::end(values));
+            }
+            const float bounds[] = {
+                em->bounds_min.axis.x, em->bounds_min.axis.y, em->bounds_min.axis.z,
+                em->bounds_max.axis.x, em->bounds_max.axis.y, em->bounds_max.axis.z
+            };
+            ret.particles.insert(ret.particles.end(), std::begin(bounds), std::end(bounds));
+        }
+        for (auto& ob : objects) {
+            ret.animator_times.push_back(ob->get_animator()->current_time);
+            ret.world_matrices.push_back(ob->model_matrix.mat);
+        }
+        ret.palettes = scene.animation.palettes;
+        return ret;
+    };
+
+    try {
+        jobs.set_worker_count(0);
+        frame_result first = run();
+        if (first.particles.empty() || first.palettes.empty() || first.world_matrices.empty())
+            throw std::runtime_error("frame self test failed: the simulated frames produced nothing to compare");
+        expect_same_frame(first, run(), "two runs with 0 workers");
+        jobs.set_worker_count(3);
+        expect_same_frame(first, run(), "runs with 0 and 3 workers");
+    } catch (...) {
+        jobs.set_worker_count(workers);
+        throw;
+    }
+    jobs.set_worker_count(workers);
+}
+
+// Instanced objects share everything but their model matrix: no skinning, no object level uniforms,
+// and a vertex shader with an instanced path whose lights come from the light block.
+static bool can_instance(object3d* ob) {
+    material* mat = ob->mat->data;
+    return !ob->model_data->data->animated
+        && ob->TRAIT_has_uniform::uniforms.empty()
+        && mat->supports_instancing
+        && mat->has_light_block;
+}
+
+void window::queue_instanced_objects() {
+    auto group_key = [](const object3d* ob) {
+        return std::make_tuple(ob->model_data->data, ob->mat->data, ob->lod_level);
+    };
+    std::sort(this->instance_candidates.begin(), this->instance_candidates.end(), [&](const object3d* a, const object3d* b) {
+        return group_key(a) < group_key(b);
+    });
+
+    this->instance_batches.clear();
+    this->instance_matrix_data.clear();
+    size_t run_start = 0;
+    for (size_t i = 1; i <= this->instance_candidates.size(); i++) {
+        if (i < this->instance_candidates.size() && group_key(this->instance_candidates[i]) == group_key(this->instance_candidates[run_start]))
+            continue;
+        size_t run_length = i - run_start;
+        if (run_length < MIN_INSTANCE_BATCH) {
+            for (size_t j = run_start; j < i; j++)
+                this->instance_candidates[j]->render(*this->cam, this);
+        } else {
+            instance_batch batch = {this->instance_candidates[run_start], this->instance_matrix_data.size(), run_length, INFINITY};
+            for (size_t j = run_start; j < i; j++) {
+                object3d* ob = this->instance_candidates[j];
+                this->instance_matrix_data.push_back(ob->model_matrix.mat);
+                batch.depth = std::min(batch.depth, ob->position->distance(*this->cam->position));
+            }
+            this->instance_batches.push_back(batch);
+        }
+        run_start = i;
+    }
+
+    if (this->instance_batches.empty())
+        return;
+    this->instance_matrices->update(this->instance_matrix_data);
+    // queued only after instance_batches stops growing, packets point into it.
+    for (const instance_batch& batch : this->instance_batches)
+        batch.first->model_data->data->render_instanced(batch, *this->cam, this);
+}
+
+void window::update_frame_uniforms() {
+    std140_frame_data frame;
+    frame.view = this->cam->view.mat;
+    frame.projection = this->cam->projection.mat;
+    frame.view_position = glm::vec4(this->cam->position->axis, 1.0f);
+    frame.ambient_light = glm::vec4(this->ambient_light->axis, 1.0f);
+    this->frame_ubo->update(&frame, sizeof(frame));
+
+    std140_light_data lights;
+    const glm::mat4& view = this->cam->view.mat;
+
+    // Point and spot lights are binned into view space clusters, every fragment only loops over its cluster's lights.
+    this->packed_point_lights.resize(render_list_point_lights.size());
+    this->cluster_point_lights.resize(render_list_point_lights.size());
+    size_t i = 0;
+    for (point_light* pl : render_list_point_lights) {
+        pl->pack(this->packed_point_lights[i]);
+        glm::vec3 view_pos = glm::vec3(view * glm::vec4(pl->position->axis, 1.0f));
+        this->cluster_point_lights[i] = {view_pos.x, view_pos.y, view_pos.z, pl->influence_radius()};
+        i++;
+    }
+
+    this->packed_spot_lights.resize(render_list_spot_lights.size());
+    this->cluster_spot_lights.resize(render_list_spot_lights.size());
+    i = 0;
+    for (spot_light* sl : render_list_spot_lights) {
+        std140_spot_light& packed = this->packed_spot_lights[i];
+        sl->pack(packed);
+        glm::vec3 view_pos = glm::vec3(view * glm::vec4(sl->position->axis, 1.0f));
+        // the shader compares against the direction towards the light, so the light shines along -direction.
+        glm::vec3 view_axis = glm::normalize(glm::mat3(view) * -glm::vec3(packed.direction));
+        float outer = std::min(std::abs(sl->outerCutOff), glm::half_pi<float>());
+        this->cluster_spot_lights[i] = {
+            view_pos.x, view_pos.y, view_pos.z, sl->influence_radius(),
+            view_axis.x, view_axis.y, view_axis.z,
+            glm::cos(outer), glm::sin(outer)
+        };
+        i++;
+    }
+
+    this->clusters.set_projection(this->cam->fov, static_cast<float>(this->cam->view_width)/static_cast<float>(this->cam->view_height), this->cam->near_plane, this->cam->focal_length);
+    this->clusters.build(this->cluster_point_lights, this->cluster_spot_lights);
+
+    this->point_light_buffer->update(this->packed_point_lights.data(), this->packed_point_lights.size() * sizeof(std140_point_light));
+    this->spot_light_buffer->update(this->packed_spot_lights.data(), this->packed_spot_lights.size() * sizeof(std140_spot_light));
+    this->cluster_grid_buffer->update(this->clusters.grid.data(), this->clusters.grid.size() * sizeof(uint32_t));
+    this->cluster_index_buffer->update(this->clusters.light_indices.data(), this->clusters.light_indices.size() * sizeof(uint16_t));
+
+    this->point_light_buffer->bind(GL_TEXTURE0 + static_cast<GLenum>(LightBufferUnit::POINT_LIGHTS));
+    this->spot_light_buffer->bind(GL_TEXTURE0 + static_cast<GLenum>(LightBufferUnit::SPOT_LIGHTS));
+    this->cluster_grid_buffer->bind(GL_TEXTURE0 + static_cast<GLenum>(LightBufferUnit::CLUSTER_GRID));
+    this->cluster_index_buffer->bind(GL_TEXTURE0 + static_cast<GLenum>(LightBufferUnit::CLUSTER_INDICES));
+    glActiveTexture(GL_TEXTURE0);
+
+    size_t directional_count = 0;
+    for (directional_light* dl : render_list_directional_lights) {
+        if (directional_count == MAX_LIGHTS) break;
+        dl->pack(lights.directional_lights[directional_count++]);
+    }
+
+    lights.light_counts = glm::ivec4(
+        std::min(this->packed_point_lights.size(), light_clusters::MAX_LIGHTS_PER_TYPE),
+        directional_count,
+        std::min(this->packed_spot_lights.size(), light_clusters::MAX_LIGHTS_PER_TYPE),
+        0
+    );
+    lights.cluster_dims = glm::ivec4(light_clusters::DIM_X, light_clusters::DIM_Y, light_clusters::DIM_Z, 0);
+    lights.cluster_params = glm::vec4(
+        this->clusters.slice_scale,
+        this->clusters.slice_bias,
+        static_cast<float>(this->width) / light_clusters::DIM_X,
+        static_cast<float>(this->height) / light_clusters::DIM_Y
+    );
+    this->light_ubo->update(&lights, sizeof(lights));
+}
+
 void window::add_object(object3d* obj) {
-    this->render_list.insert(obj);
+    if (in_set(this->object_proxies, obj))
+        return;
+    obj->update_transform();
+    this->object_proxies[obj] = this->scene_tree.insert(obj->get_world_aabb(), obj);
+    this->transform_order_generation = SIZE_MAX;
 }
 
 void window::remove_object(object3d* obj) {
-    if(in_set(this->render_list, obj))
-        this->render_list.erase(obj);
+    auto it = this->object_proxies.find(obj);
+    if (it == this->object_proxies.end())
+        return;
+    this->scene_tree.remove(it->second);
+    this->object_proxies.erase(it);
+    this->transform_order_generation = SIZE_MAX;
 }
 
 void window::add_object_list(vector<object3d*> objs) {
     for (object3d * obj : objs) {
-        this->render_list.insert(obj);
+        this->add_object(obj);
     }
 }
 
 void window::remove_object_list(vector<object3d*> objs) {
     for (object3d * obj : objs) {
-        if(in_set(this->render_list, obj))
-            this->render_list.erase(obj);
+        this->remove_object(obj);
     }
 }
 
+void window::refit_object(object3d* obj) {
+    auto it = this->object_proxies.find(obj);
+    if (it != this->object_proxies.end() && obj->update_transform())
+        this->scene_tree.move(it->second, obj->get_world_aabb());
+}
+
+void window::build_transform_order() {
+    this->transform_order.clear();
+    this->transform_roots.clear();
+    std::unordered_set<object3d*> visited_roots;
+    std::function<void(object3d*)> visit = [&](object3d* ob) {
+        auto it = this->object_proxies.find(ob);
+        this->transform_order.push_back({ob, it == this->object_proxies.end() ? aabb_tree<object3d*>::NULL_NODE : it->second});
+        for (object3d* child : ob->children)
+            visit(child);
+    };
+    for (auto& [ob, proxy] : this->object_proxies) {
+        object3d* root = ob;
+        while (root->parent)
+            root = root->parent;
+        if (visited_roots.insert(root).second) {
+            this->transform_roots.push_back(this->transform_order.size());
+            visit(root);
+        }
+    }
+    this->transform_order_generation = object3d::hierarchy_generation;
+}
+
+vector<object3d*> window::query_aabb(const vec3& min, const vec3& max) const {
+    vector<object3d*> result;
+    this->scene_tree.query_aabb(aabb{min.axis, max.axis}, [&](object3d* ob) {
+        result.push_back(ob);
+    });
+    return result;
+}
+
+vector<object3d*> window::query_sphere(const vec3& center, float radius) const {
+    vector<object3d*> result;
+    this->scene_tree.query_sphere(center.axis, radius, [&](object3d* ob) {
+        result.push_back(ob);
+    });
+    return result;
+}
+
+vector<object3d*> window::query_frustum(const frustum& view) const {
+    vector<object3d*> result;
+    this->scene_tree.query_frustum(view, [&](object3d* ob, FrustumTest) {
+        result.push_back(ob);
+    });
+    return result;
+}
+
+vector<scene_ray_hit> window::raycast(const vec3& origin, const vec3& direction, float max_distance) const {
+    vector<scene_ray_hit> result;
+    this->scene_tree.raycast(origin.axis, direction.axis, max_distance, [&](object3d* ob, float distance) {
+        result.push_back({ob, distance});
+        return max_distance;
+    });
+    std::sort(result.begin(), result.end(), [](const scene_ray_hit& a, const scene_ray_hit& b) {
+        return a.distance < b.distance;
+    });
+    return result;
+}
+
 void window::add_object2d(object2d* obj) {
     this->render_list2d.insert(obj);
 }
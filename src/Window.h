@@ -18,6 +18,15 @@
 #include "CubeMap.h"
 #include "Emitter.h"
 #include "Sound.h"
+#include "UniformBuffer.h"
+#include "BufferTexture.h"
+#include "LightClusters.h"
+#include "RenderQueue.h"
+#include "BVH.h"
+#include "JobSystem.h"
+#include "AnimationStage.h"
+#include <unordered_map>
+#include <memory>
 
 #define SDLBOOL(b) b ? SDL_TRUE : SDL_FALSE
 
@@ -26,6 +35,12 @@ using std::vector;
 class camera;
 class object3d;
 class object2d;
+class model;
+
+struct scene_ray_hit {
+    object3d* object;
+    float distance;
+};
 
 class window {
 public:
@@ -55,6 +70,15 @@ public:
     void remove_object(object3d* obj);
     void add_object_list(vector<object3d*> objs);
     void remove_object_list(vector<object3d*> objs);
+    // moves the object's leaf in the scene tree if its transform changed, done for every object in update().
+    void refit_object(object3d* obj);
+
+    // Scene queries against the world bounds of every added object as of its last refit.
+    vector<object3d*> query_aabb(const vec3& min, const vec3& max) const;
+    vector<object3d*> query_sphere(const vec3& center, float radius) const;
+    vector<object3d*> query_frustum(const frustum& view) const;
+    // objects whose bounds the ray enters, nearest first.
+    vector<scene_ray_hit> raycast(const vec3& origin, const vec3& direction, float max_distance) const;
 
     void add_object2d(object2d* obj);
     void remove_object2d(object2d* obj);
@@ -93,14 +117,76 @@ public:
     std::set<emitter*> render_list_emitter;
     vec3* ambient_light = nullptr;
     skybox* sky_box = nullptr;
-    audio_mixer* sound_mixer;
+    audio_mixer* sound_mixer = nullptr;
+
+    // 3D draws of the current frame, sorted by render key before submitting.
+    render_queue queue;
+    gl_state_tracker gl_state;
+    instance_buffer* instance_matrices = nullptr;
+    // objects sharing a model and material are instanced once there are this many of them.
+    static constexpr size_t MIN_INSTANCE_BATCH = 2;
+    inline render_stats get_render_stats() const {
+        return gl_state.stats;
+    }
+    // runs simulate() over emitters, animated objects and a transform hierarchy on a window without SDL or GL,
+    // and checks that two runs with 0 workers and one with 3 end byte identical.
+    // Restores the worker count, throws describing the first mismatch.
+    static void self_test_frame();
 private:
+    // a window that never starts SDL or GL, only simulate() works on it.
+    struct headless {};
+    explicit window(headless);
     void create_window();
+    // the part of update() that needs no GL context: starts this frame's emitter and animation jobs and
+    // sweeps the transforms.  The jobs run on while update() culls and queues, it waits on them after.
+    void simulate(double dt);
+    // this frame's simulation jobs, made anew by every simulate() since jobs can not be reused.
+    std::unique_ptr<job> emitter_job, animation_job;
+    // fills the camera and light uniform buffers once for the whole frame.
+    void update_frame_uniforms();
+    // groups instance_candidates into batches and queues them.
+    void queue_instanced_objects();
+    vector<object3d*> instance_candidates;
+    vector<instance_batch> instance_batches;
+    vector<glm::mat4> instance_matrix_data;
+    uniform_buffer* frame_ubo = nullptr;
+    uniform_buffer* light_ubo = nullptr;
+    // clustered point and spot lights, rebuilt every frame.
+    light_clusters clusters;
+    buffer_texture* point_light_buffer = nullptr;
+    buffer_texture* spot_light_buffer = nullptr;
+    buffer_texture* cluster_grid_buffer = nullptr;
+    buffer_texture* cluster_index_buffer = nullptr;
+    vector<std140_point_light> packed_point_lights;
+    vector<std140_spot_light> packed_spot_lights;
+    vector<cluster_light_sphere> cluster_point_lights;
+    vector<cluster_light_cone> cluster_spot_lights;
     SDL_Window* app_window = nullptr;
     SDL_Renderer* renderer = nullptr;
     SDL_Texture* texture = nullptr;
     SDL_GLContext gl_context = nullptr;
     std::chrono::steady_clock::time_point old_time, new_time, starttime;
-    std::set<object3d*> render_list;
+    // every 3D object by world bounds, object_proxies maps each one to its leaf.
+    aabb_tree<object3d*> scene_tree;
+    std::unordered_map<object3d*, int> object_proxies;
+    vector<object3d*> animated_objects;
+    // added objects and their ancestors with every parent before its children,
+    // proxy is aabb_tree::NULL_NODE for ancestors that were not added.
+    struct transform_entry {
+        object3d* object;
+        int proxy;
+    };
+    void build_transform_order();
+    vector<transform_entry> transform_order;
+    // where each root's subtree starts in transform_order.
+    vector<size_t> transform_roots;
+    // per transform_order entry, set by the parallel sweep when the world matrix changed.
+    vector<uint8_t> transform_moved;
+    size_t transform_order_generation = SIZE_MAX;
+    // per frame copies the job_system stages index into.
+    vector<emitter*> emitter_list;
+    // every animator drawn this frame once.
+    vector<animator*> animators;
+    animation_stage animation;
     std::set<object2d*> render_list2d;
 };
\ No newline at end of file
@@ -56,6 +56,12 @@ inline float rand_range(float low, float high) {
     return low + r;
 }
 
+// same as above from a caller owned engine, for code that may run on a job_system worker.
+template<typename Engine>
+inline float rand_range(Engine& engine, float low, float high) {
+    return low + std::uniform_real_distribution<float>(0.0f, 1.0f)(engine) * (high - low);
+}
+
 static std::string MOD_PATH;
 
 void c_set_mod_path(std::string path);
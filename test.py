@@ -5,7 +5,9 @@ from Loxoc import (
     Texture, Sprite, Object2D, Vec2, PointLight, MeshDict, 
     DirectionalLight, SpotLight, BoxCollider, Matrix4x4 as Mat4,
     Vec4, Font, Text, CubeMap, SkyBox, Emitter, ConvexCollider,
-    Model, Sound, RayCollider
+    Model, Sound, RayCollider, get_program_cache_stats, benchmark_skeleton,
+    self_test_light_clusters, self_test_mesh_optimizer, self_test_job_system,
+    self_test_frustum
 )
 import math
 from copy import copy
@@ -15,6 +17,9 @@ def lerp(a: float, b: float, t: float) -> float:
 
 p = print
 
+# run twice to compare a cold startup with one served from the shader program cache.
+startup_start = time.perf_counter()
+
 # The meshes used in this testfile are not provided with the library or source files.
 
 dim = (1280, 720)
@@ -191,6 +196,12 @@ accel = 5
 cam_dist = 300.0
 magic_turn_dampener = 4
 mouse_sensitivity = 10
+print(f"Startup took {time.perf_counter() - startup_start:.3f}s, shader programs: {get_program_cache_stats()}")
+print(f"Posing a 100 bone skeleton takes {benchmark_skeleton(100) / 1000:.1f}us")
+self_test_light_clusters()
+self_test_mesh_optimizer()
+self_test_job_system()
+self_test_frustum()
 print("Start gameloop")
 while not window.event.check_flag(EVENT_FLAG.QUIT) and window.event.get_flag(EVENT_FLAG.KEY_ESCAPE) != EVENT_STATE.PRESSED:
     # if window.dt > 0: